@@ -1,7 +1,9 @@
 #pragma once
 
 #include <QtCore/QFileSystemWatcher>
+#include <QtCore/QSet>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 
 #include "Rendering/RenderObjectManager.h"
 #include "Rendering/Renderer.h"
@@ -30,15 +32,43 @@ class MainWindow : public QMainWindow {
   // --- Menu actions  ---
   // File menu
   void on_actionLoad_triggered();
+  void on_actionLoadVideo_triggered();
+  void on_actionLoadImageSequence_triggered();
+  // Rendering menu
+  void on_actionDynamicResolution_triggered(bool checked);
+  // Benchmark menu
+  void on_actionBenchmarkShaderVariants_triggered();
+  void on_actionBenchmarkOpaquePass_triggered();
+  void on_actionBenchmarkMaskBlur_triggered();
+  void on_actionBenchmarkBatchedDraws_triggered();
+  void on_actionBenchmarkAntiAliasing_triggered();
+  void on_actionBenchmarkObjectStateContention_triggered();
+  void on_actionBenchmarkTransformGraph_triggered();
+  void on_actionBenchmarkSpatialIndex_triggered();
 
   // --- Callback from OpenGL window once initialized
   void onOpenGlWidgetInitialized() const;
 
+  // --- Watched image files
+  void onImageLoaded(const QString& path);
+  void onWatchedFileChanged(const QString& path);
+  void onFileChangesSettled();
+
+  // --- Resolution scale of the dynamic resolution
+  void onResolutionScaleChanged(float scale);
+
  private:
   void connectSignalsAndSlots();
 
   Ui::MainWindow mUI;
   std::shared_ptr<Renderer> mRenderer;
+
+  // watches the loaded image files to refresh them when overwritten
+  QFileSystemWatcher mFileWatcher;
+  // editors write files in several steps: collect the changes until they settle
+  QTimer mFileChangeTimer;
+  QSet<QString> mChangedFiles;
+  static constexpr int kFileChangeSettleTimeMs = 250;
 };
 
 }  // namespace nimagna
@@ -27,6 +27,9 @@ class OpenGlWidget : public QOpenGLWidget, protected QOpenGLFunctions_4_0_Core {
 
  signals:
   void initialized();
+  // the render object clicked on (the front-most under the cursor), empty if none. Weak such that
+  // receivers do not keep objects alive that the render object manager dropped.
+  void renderObjectClicked(std::weak_ptr<RenderObject> renderObject);
 
  protected:
   // initialize
@@ -49,6 +52,10 @@ class OpenGlWidget : public QOpenGLWidget, protected QOpenGLFunctions_4_0_Core {
   void updateRendering();
 
  private:
+  // the position in the widget in normalized device coordinates of the rendered frame, false if
+  // outside of the viewport
+  bool normalizedDevicePosition(const QPointF& position, QPointF* normalizedPosition) const;
+
   // the core app and render object manager
   std::shared_ptr<Renderer> mRenderer = nullptr;
 
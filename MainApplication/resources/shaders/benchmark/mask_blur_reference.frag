@@ -0,0 +1,50 @@
+#version 400 core
+
+// fragment shader
+// blurs the mask around each texel into a target of the mask's size
+//
+// benchmark reference: the former blur of texture_2d.frag sampling all (2*radius+1)^2 texels
+// around the fragment (and filtering each) instead of two separable passes (see mask_blur.frag)
+
+// outputs
+out vec4 finalColor;							// output: the blurred value in the red channel
+
+// static input: textures
+uniform sampler2D maskTexture;			        // the mask texture (key)
+
+// post processing
+uniform bool isPostProcessingEnabled;           // use post processing
+uniform int blurKernelSize;                     // the blurring kernel size
+uniform float sharpnessValue;                   // sharpness of the sigmoid filter
+
+// get a sigmoid function value
+float sigmoidFilter(float value) {
+  float sigSlope = sharpnessValue;
+  float sig = exp(sigSlope * (value - 0.5f));
+  return sig / (1.0f + sig);
+}
+
+// calculate average blur around pixel using 2D texture
+float averageBlur(vec2 maskTextureCoordinates, int radius) {
+  int diameter = 2*radius + 1;
+  float sampleBlurred = 0.0f;
+  ivec2 textureSize = textureSize(maskTexture,0);
+  float stepSizeX = 1.0f/float(textureSize.x);
+  float stepSizeY = 1.0f/float(textureSize.y);
+  for(int i = -radius; i <= radius; i++) {
+    for(int j = -radius; j <= radius; j++) {
+      float value = texture(maskTexture, maskTextureCoordinates + vec2(i * stepSizeX, j * stepSizeY)).r;
+      if (isPostProcessingEnabled) {
+        value = sigmoidFilter(value);
+      }
+      sampleBlurred += value;
+    }
+  }
+  return sampleBlurred / (diameter * diameter * 1.0f);
+}
+
+void main() {
+  // the texel's center
+  vec2 maskTextureCoordinates = gl_FragCoord.xy / vec2(textureSize(maskTexture, 0));
+  finalColor = vec4(averageBlur(maskTextureCoordinates, blurKernelSize), 0.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,12 @@
+#version 400
+// GLSL version 4.0
+
+// vertex shader
+// maps the unit quad to the whole target, e.g. for passes computing one texel per pixel
+
+// input data
+layout(location = 0) in vec2 unitPosition;				// 0: corner of the unit quad in [0,1]x[0,1] (see UnitQuad)
+
+void main() {
+  gl_Position = vec4(2.0f * unitPosition - 1.0f, 0.0f, 1.0f);
+}
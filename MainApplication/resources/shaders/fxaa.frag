@@ -0,0 +1,75 @@
+#version 400 core
+
+// fragment shader
+// fast approximate anti-aliasing (FXAA) of a frame (see FxaaEffect): pixels whose neighbourhood
+// has a high luma contrast are blended along the edge with bilinear samples, the others are
+// passed through
+//
+// the variant is selected by the defines injected after the version line:
+// RECTANGLE_TEXTURE: the frame is a rectangle texture
+
+// outputs
+out vec4 finalColor;							// output: the anti-aliased color
+
+// static input: textures
+#ifdef RECTANGLE_TEXTURE
+uniform sampler2DRect frameTexture;		        // the rectangular frame texture
+#else
+uniform sampler2D frameTexture;			        // the frame texture
+#endif
+
+// the contrast below which a pixel is not on an edge: relative to the brightest neighbour, and
+// absolute in dark regions
+const float kEdgeThreshold = 1.0f / 8.0f;
+const float kEdgeThresholdMin = 1.0f / 16.0f;
+// keeps the direction of nearly axis aligned edges from growing without bounds
+const float kDirectionReduceMultiplier = 1.0f / 8.0f;
+const float kDirectionReduceMin = 1.0f / 128.0f;
+// the maximum distance of the samples along the edge in pixels
+const float kSpanMax = 8.0f;
+
+// the bilinearly filtered frame at a position in pixels
+vec4 frameAt(vec2 position) {
+#ifdef RECTANGLE_TEXTURE
+  return texture(frameTexture, position);
+#else
+  return texture(frameTexture, position / vec2(textureSize(frameTexture, 0)));
+#endif
+}
+
+float luma(vec3 color) {
+  return dot(color, vec3(0.299f, 0.587f, 0.114f));
+}
+
+void main() {
+  // the pixel's center, y up
+  vec2 position = gl_FragCoord.xy;
+  vec4 colorM = frameAt(position);
+  float lumaM = luma(colorM.rgb);
+  float lumaNW = luma(frameAt(position + vec2(-1.0f, 1.0f)).rgb);
+  float lumaNE = luma(frameAt(position + vec2(1.0f, 1.0f)).rgb);
+  float lumaSW = luma(frameAt(position + vec2(-1.0f, -1.0f)).rgb);
+  float lumaSE = luma(frameAt(position + vec2(1.0f, -1.0f)).rgb);
+  float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+  float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+  if (lumaMax - lumaMin < max(kEdgeThresholdMin, lumaMax * kEdgeThreshold)) {
+    finalColor = colorM;
+    return;
+  }
+
+  // along the edge: perpendicular to the luma gradient
+  vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)),
+                        (lumaNE + lumaSE) - (lumaNW + lumaSW));
+  float directionReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25f *
+                                  kDirectionReduceMultiplier, kDirectionReduceMin);
+  float inverseDirectionMin = 1.0f / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+  direction = clamp(direction * inverseDirectionMin, vec2(-kSpanMax), vec2(kSpanMax));
+
+  // two samples close to the pixel, and two more further along the edge unless they cross it
+  vec4 colorA = 0.5f * (frameAt(position + direction * (1.0f / 3.0f - 0.5f)) +
+                        frameAt(position + direction * (2.0f / 3.0f - 0.5f)));
+  vec4 colorB = 0.5f * colorA + 0.25f * (frameAt(position - 0.5f * direction) +
+                                         frameAt(position + 0.5f * direction));
+  float lumaB = luma(colorB.rgb);
+  finalColor = (lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB;
+}
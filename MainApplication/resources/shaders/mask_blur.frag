@@ -0,0 +1,69 @@
+#version 400 core
+
+// fragment shader
+// one direction of the separable box blur of a mask: averages the 2*radius+1 texels along the
+// direction around the pixel's texel (see MaskBlur). Blurring horizontally and then the result
+// vertically averages the (2*radius+1)^2 texels around each texel.
+// Texels outside the mask have the border value.
+//
+// the variant is selected by the defines injected after the version line:
+// RECTANGLE_TEXTURE: the mask is a rectangle texture
+// POST_PROCESSING: apply a sigmoid filter to each mask texel (the first pass only), looked up
+// in a table of the mask's 8 bit levels
+
+// outputs
+out vec4 finalColor;							// output: the blurred value in the red channel
+
+// static input: textures
+#ifdef RECTANGLE_TEXTURE
+uniform sampler2DRect maskTexture;		        // the rectangular mask texture (key)
+#else
+uniform sampler2D maskTexture;			        // the mask texture (key)
+#endif
+
+// blurring
+uniform vec2 blurDirection;                     // (1,0) or (0,1)
+uniform int blurKernelSize;                     // the blurring kernel size (radius)
+uniform float borderValue;                      // the value of texels outside the mask
+
+#ifdef POST_PROCESSING
+uniform vec4 sigmoidTable[64];                  // the sigmoid filter of the 256 mask levels
+
+// get the sigmoid function value of a mask level
+float sigmoidFilter(float value) {
+  int level = int(value * 255.0f + 0.5f);
+  return sigmoidTable[level / 4][level % 4];
+}
+#endif
+
+// the (filtered) value of a texel
+float maskValue(ivec2 texel, ivec2 size) {
+  if (any(lessThan(texel, ivec2(0))) || any(greaterThanEqual(texel, size))) {
+    return borderValue;
+  }
+#ifdef RECTANGLE_TEXTURE
+  float value = texelFetch(maskTexture, texel).r;
+#else
+  float value = texelFetch(maskTexture, texel, 0).r;
+#endif
+#ifdef POST_PROCESSING
+  value = sigmoidFilter(value);
+#endif
+  return value;
+}
+
+void main() {
+#ifdef RECTANGLE_TEXTURE
+  ivec2 size = textureSize(maskTexture);
+#else
+  ivec2 size = textureSize(maskTexture, 0);
+#endif
+  // the target has the mask's size: one pixel per texel
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  ivec2 direction = ivec2(blurDirection);
+  float sampleBlurred = 0.0f;
+  for (int i = -blurKernelSize; i <= blurKernelSize; i++) {
+    sampleBlurred += maskValue(texel + i * direction, size);
+  }
+  finalColor = vec4(sampleBlurred / float(2 * blurKernelSize + 1), 0.0f, 0.0f, 1.0f);
+}
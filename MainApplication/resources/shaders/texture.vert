@@ -2,25 +2,52 @@
 // GLSL version 4.0
 
 // vertex shader
-// transforms the vertex position using a camera matrix
-// and interpolates the texture coordinates
+// maps the unit quad to the object's rectangle, transforms the vertex position using a camera
+// matrix, and interpolates the texture coordinates
 
 // input data
-layout(location = 0) in vec3 position;					// 0: vertex position with 3 elements per vertex
-layout(location = 1) in vec2 imageTextureCoordinates;	// 1: image texture coordinates with 2 elements per vertex
-layout(location = 2) in vec2 maskTextureCoordinates;	// 2: mask texture coordinates with 2 elements per vertex
+layout(location = 0) in vec2 unitPosition;				// 0: corner of the unit quad in [0,1]x[0,1] (see UnitQuad)
 
 // output to fragment shader
 out vec2 interpolatedImageTextureCoordinates;			// output: computed texture coordinates
 out vec2 interpolatedMaskTextureCoordinates;			// output: computed mask texture coordinates
+flat out float instanceAlphaTransparency;				// output: the instance's alpha transparency
+flat out int instanceTextureSlot;						// output: the instance's texture slot
 
-// static
-uniform mat4 worldToView;								// parameter: the camera matrix
+// per frame, shared by all objects (see UniformBufferRing)
+layout(std140) uniform FrameUniforms {
+  mat4 viewProjection;									// parameter: the camera matrix
+  bool useDrawDepth;									// parameter: use the objects' draw depth
+};
+// per object, the rectangles are origin and extent (x, y, width, height)
+struct Object {
+  mat4 model;											// parameter: the model matrix
+  vec4 positionRect;									// parameter: the vertex positions
+  vec4 textureRect;										// parameter: the image texture coordinates
+  vec4 maskTextureRect;									// parameter: the mask texture coordinates
+  float alphaTransparency;								// alpha transparency multiplied on top
+  float drawDepth;										// depth from the draw order, smaller in front
+  int textureSlot;										// the batch's texture (and mask) unit offset
+};
+// one object per instance of a batch (UniformBufferRing::kMaxInstanceCount)
+layout(std140) uniform ObjectUniforms {
+  Object objects[128];
+};
 
 void main() {
+  Object object = objects[gl_InstanceID];
   // camera transformation of the vertex position
-  gl_Position = worldToView * vec4(position, 1.0);
+  vec2 position = object.positionRect.xy + unitPosition * object.positionRect.zw;
+  gl_Position = viewProjection * object.model * vec4(position, 0.0, 1.0);
+  if (useDrawDepth) {
+    // the depth test follows the draw order instead of the scene depth
+    gl_Position.z = object.drawDepth * gl_Position.w;
+  }
   // texture coordinate interpolation
-  interpolatedImageTextureCoordinates = imageTextureCoordinates;
-  interpolatedMaskTextureCoordinates = maskTextureCoordinates;
+  interpolatedImageTextureCoordinates =
+      object.textureRect.xy + unitPosition * object.textureRect.zw;
+  interpolatedMaskTextureCoordinates =
+      object.maskTextureRect.xy + unitPosition * object.maskTextureRect.zw;
+  instanceAlphaTransparency = object.alphaTransparency;
+  instanceTextureSlot = object.textureSlot;
 }
@@ -3,6 +3,12 @@
 // fragment shader
 // calculates the pixel color using a texture 
 // and the transparency using a mask texture with separate texture coordinates
+//
+// the variant is selected by the defines injected after the version line:
+// USE_MASK_TEXTURE: use the separate mask texture instead of the image's alpha channel
+// DO_BLURRING: the mask texture is blurred already (see mask_blur.frag), smooth its edges
+//              (requires USE_MASK_TEXTURE)
+// SWAP_RGB: swap RGB to BGR (or vice versa)
 
 // inputs
 in vec2 interpolatedImageTextureCoordinates;	// input: texture coordinate (xy-coordinates)
@@ -12,69 +18,63 @@ in vec2 interpolatedMaskTextureCoordinates;		// input: mask texture coordinate (
 out vec4 finalColor;							// output: final color value as rgba-value
 
 // static input: textures
-uniform sampler2DRect imageTextureRect;			// the rectangular image texture
-uniform sampler2DRect maskTextureRect;			// the rectangular mask texture (key)
+uniform sampler2DRect imageTexturesRect[6];			// the image textures of the batch's texture slots
+#ifdef USE_MASK_TEXTURE
+uniform sampler2DRect maskTexturesRect[6];			// the mask textures (key) of the texture slots
+#endif
 
-// general
-uniform bool useMaskTexture;                    // use the separate mask texture instead of the image's alpha channel
-uniform bool swapRGB;                           // swap RGB to BGR (or vice versa)
-uniform float alphaTransparency;                // alpha transparency multiplied on top
+// per object
+flat in float instanceAlphaTransparency;        // alpha transparency multiplied on top
+flat in int instanceTextureSlot;                // the texture slot of the instance (see RenderBatcher)
 
-// post processing
-uniform bool doBlurring;                        // apply blurring or not on the alpha channel
-uniform bool isPostProcessingEnabled;           // use post processing
-uniform int blurKernelSize;                     // the blurring kernel size
-uniform float sharpnessValue;                   // sharpness of the sigmoid filter
-
-// get a sigmoid function value
-float sigmoidFilter(float value) {
-  float sigSlope = sharpnessValue;
-  float sig = exp(sigSlope * (value - 0.5f));
-  return sig / (1.0f + sig);
+// sampler arrays may only be indexed with constants or dynamically uniform expressions: the slot
+// is the same for all fragments of an instance's primitive, the switch selects a constant index
+vec4 sampleImage(vec2 coordinates) {
+  switch (instanceTextureSlot) {
+    case 1: return texture(imageTexturesRect[1], coordinates);
+    case 2: return texture(imageTexturesRect[2], coordinates);
+    case 3: return texture(imageTexturesRect[3], coordinates);
+    case 4: return texture(imageTexturesRect[4], coordinates);
+    case 5: return texture(imageTexturesRect[5], coordinates);
+    default: return texture(imageTexturesRect[0], coordinates);
+  }
 }
-
-// calculate average blur around pixel using rectangular texture
-float averageBlurRect(int radius) {
-  int diameter = 2*radius + 1;
-  float sampleBlurred = 0.0f;
-  for(int i = -radius; i <= radius; i++) {
-    for(int j = -radius; j <= radius; j++) {
-      if (isPostProcessingEnabled) {
-        sampleBlurred += sigmoidFilter(texture(maskTextureRect, interpolatedMaskTextureCoordinates + vec2(i * 1.0f, j * 1.0f)).r);
-      } else {
-        sampleBlurred += texture(maskTextureRect, interpolatedMaskTextureCoordinates + vec2(i * 1.0f, j * 1.0f)).r;
-      }
-    }
+#ifdef USE_MASK_TEXTURE
+float sampleMask(vec2 coordinates) {
+  switch (instanceTextureSlot) {
+    case 1: return texture(maskTexturesRect[1], coordinates).r;
+    case 2: return texture(maskTexturesRect[2], coordinates).r;
+    case 3: return texture(maskTexturesRect[3], coordinates).r;
+    case 4: return texture(maskTexturesRect[4], coordinates).r;
+    case 5: return texture(maskTexturesRect[5], coordinates).r;
+    default: return texture(maskTexturesRect[0], coordinates).r;
   }
-  return sampleBlurred / (diameter * diameter * 1.0f);
 }
+#endif
 
 void main() {
-  // use a separate texture for the mask/alpha channel?
-  if (useMaskTexture) {
-    // Use RGB from image texture and separate Alpha texture for transparency
-    // use rectangular texture target!
-    finalColor.rgb = texture(imageTextureRect, interpolatedImageTextureCoordinates).rgb;
+#ifdef USE_MASK_TEXTURE
+  // Use RGB from image texture and separate Alpha texture for transparency
+  // use rectangular texture target!
+  finalColor.rgb = sampleImage(interpolatedImageTextureCoordinates).rgb;
+#ifdef DO_BLURRING
+  // the blurred alpha mask
+  float sampleBlurred = sampleMask(interpolatedMaskTextureCoordinates);
+  finalColor.a = smoothstep(0.0f, 1.0f, sampleBlurred);
+#else
+  // just use the mask texture
+  finalColor.a = sampleMask(interpolatedMaskTextureCoordinates);
+#endif
+#else
+  // no mask texture -> use RGBA from image texture
+  finalColor.rgba = sampleImage(interpolatedImageTextureCoordinates).rgba;
+#endif
 
-    // for the alpha channel, there are different options:
-    if (doBlurring) {
-    // blur the alpha mask
-    float sampleBlurred = averageBlurRect(blurKernelSize);
-    finalColor.a = smoothstep(0.0f, 1.0f, sampleBlurred);
-    } else {
-    // just use the mask texture
-    finalColor.a = texture(maskTextureRect, interpolatedMaskTextureCoordinates).r;
-    }
-  } else {
-    // no mask texture -> use RGBA from image texture
-    finalColor.rgba = texture(imageTextureRect, interpolatedImageTextureCoordinates).rgba;
-  }
-
-  if (swapRGB) {
-    // swap R and B channel
-    finalColor.rgba = finalColor.bgra;
-  }
+#ifdef SWAP_RGB
+  // swap R and B channel
+  finalColor.rgba = finalColor.bgra;
+#endif
 
   // apply alpha transparency
-  finalColor.a = finalColor.a * alphaTransparency;
+  finalColor.a = finalColor.a * instanceAlphaTransparency;
 }
@@ -2,10 +2,17 @@
 
 #include "MainWindow.h"
 
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QCollator>
+#include <QtCore/QFileInfo>
 #include <QtCore/QJsonObject>
+#include <QtGui/QActionGroup>
 #include <QtGui/QDesktopServices>
 #include <QtGui/QShortcut>
 #include <QtWidgets/QMessageBox>
+#include <QtWidgets/QStatusBar>
+
+#include "Rendering/RenderBenchmarks.h"
 
 namespace nimagna {
 
@@ -15,6 +22,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   // create renderer
   mRenderer = std::make_shared<Renderer>();
   mUI.openGLWidget->setRenderer(mRenderer);
+  mFileChangeTimer.setSingleShot(true);
+  mFileChangeTimer.setInterval(kFileChangeSettleTimeMs);
   connectSignalsAndSlots();
 }
 
@@ -30,19 +39,162 @@ void MainWindow::on_actionLoad_triggered() {
       QFileDialog::getOpenFileName(this, tr("Open Show"), "", tr("Image Files (*.png;*.jpg)"));
   if (!fileName.isNull()) {
     // not canceled
+    // watched once loaded (see onImageLoaded)
     mRenderer->loadImage(fileName);
   }
 }
 
+void MainWindow::on_actionLoadVideo_triggered() {
+  SPDLOG_INFO("User action: load video");
+  const QString fileName = QFileDialog::getOpenFileName(this, tr("Open Video"), "",
+                                                        tr("Video Files (*.mp4;*.mov;*.mkv)"));
+  if (!fileName.isNull()) {
+    // not canceled
+    mRenderer->loadVideo(fileName);
+  }
+}
+
+void MainWindow::on_actionLoadImageSequence_triggered() {
+  SPDLOG_INFO("User action: load image sequence");
+  QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Open Image Sequence"), "",
+                                                        tr("Image Files (*.png;*.jpg)"));
+  if (!fileNames.isEmpty()) {
+    // not canceled: order frames naturally, i.e. "frame_2" before "frame_10"
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(fileNames.begin(), fileNames.end(), collator);
+    mRenderer->loadImageSequence(fileNames);
+  }
+}
+
+void MainWindow::on_actionDynamicResolution_triggered(bool checked) {
+  SPDLOG_INFO("User action: dynamic resolution {}", checked ? "on" : "off");
+  mRenderer->setDynamicResolutionEnabled(checked);
+}
+
+void MainWindow::on_actionBenchmarkShaderVariants_triggered() {
+  SPDLOG_INFO("User action: benchmark shader variants");
+  // needs the render context, runs on the render thread between two frames
+  mRenderer->runShaderVariantBenchmark();
+}
+
+void MainWindow::on_actionBenchmarkOpaquePass_triggered() {
+  SPDLOG_INFO("User action: benchmark opaque pass");
+  const QStringList fileNames = QFileDialog::getOpenFileNames(
+      this, tr("Open Layer Images"), "", tr("Image Files (*.png;*.jpg;*.jpeg)"));
+  if (!fileNames.isEmpty()) {
+    // not canceled: needs the render context, runs on the render thread between two frames
+    mRenderer->runOpaquePassBenchmark(fileNames);
+  }
+}
+
+void MainWindow::on_actionBenchmarkMaskBlur_triggered() {
+  SPDLOG_INFO("User action: benchmark mask blur");
+  // needs the render context, runs on the render thread between two frames
+  mRenderer->runMaskBlurBenchmark();
+}
+
+void MainWindow::on_actionBenchmarkBatchedDraws_triggered() {
+  SPDLOG_INFO("User action: benchmark batched draws");
+  // needs the render context, runs on the render thread between two frames
+  mRenderer->runBatchedDrawsBenchmark();
+}
+
+void MainWindow::on_actionBenchmarkAntiAliasing_triggered() {
+  SPDLOG_INFO("User action: benchmark anti-aliasing modes");
+  // renders the current scene, runs on the render thread between two frames
+  mRenderer->runAntiAliasingBenchmark();
+}
+
+void MainWindow::on_actionBenchmarkObjectStateContention_triggered() {
+  SPDLOG_INFO("User action: benchmark object state contention");
+  // no render context needed, keep the UI responsive
+  std::ignore = QtConcurrent::run(&RenderBenchmarks::objectStateContention);
+}
+
+void MainWindow::on_actionBenchmarkTransformGraph_triggered() {
+  SPDLOG_INFO("User action: benchmark transform graph update");
+  // no render context needed, keep the UI responsive
+  std::ignore = QtConcurrent::run(&RenderBenchmarks::transformGraphUpdate);
+}
+
+void MainWindow::on_actionBenchmarkSpatialIndex_triggered() {
+  SPDLOG_INFO("User action: benchmark spatial index queries");
+  // no render context needed, keep the UI responsive
+  std::ignore = QtConcurrent::run(&RenderBenchmarks::spatialIndexQueries);
+}
+
 void MainWindow::onOpenGlWidgetInitialized() const {
   mRenderer->start(mUI.openGLWidget->context());
   mUI.openGLWidget->update();
 }
 
+void MainWindow::onImageLoaded(const QString& path) {
+  // files that failed to load are not refreshed
+  if (!mFileWatcher.files().contains(path)) {
+    mFileWatcher.addPath(path);
+  }
+}
+
+void MainWindow::onWatchedFileChanged(const QString& path) {
+  mChangedFiles.insert(path);
+  mFileChangeTimer.start();
+}
+
+void MainWindow::onFileChangesSettled() {
+  for (const auto& path : std::as_const(mChangedFiles)) {
+    if (!QFileInfo::exists(path)) {
+      // deleted: the watcher dropped it and the texture keeps the last content
+      SPDLOG_WARN("Watched file {} disappeared", path);
+      continue;
+    }
+    // files replaced by rename drop out of the watcher: watch them again
+    if (!mFileWatcher.files().contains(path)) {
+      mFileWatcher.addPath(path);
+    }
+    SPDLOG_INFO("Watched file changed: {}", path);
+    mRenderer->refreshImage(path);
+  }
+  mChangedFiles.clear();
+}
+
+void MainWindow::onResolutionScaleChanged(float scale) {
+  // visible while quality is traded for frame rate
+  if (scale < 1.f) {
+    statusBar()->showMessage(tr("Render resolution %1%").arg(qRound(100.f * scale)));
+  } else {
+    statusBar()->clearMessage();
+  }
+}
+
 void MainWindow::connectSignalsAndSlots() {
   // OpenGL Widget: initialized/trackball disabled
   connect(mUI.openGLWidget, &OpenGlWidget::initialized, this,
           &MainWindow::onOpenGlWidgetInitialized);
+  // watched files
+  connect(&mFileWatcher, &QFileSystemWatcher::fileChanged, this,
+          &MainWindow::onWatchedFileChanged);
+  connect(&mFileChangeTimer, &QTimer::timeout, this, &MainWindow::onFileChangesSettled);
+  // renderer
+  connect(mRenderer.get(), &Renderer::resolutionScaleChanged, this,
+          &MainWindow::onResolutionScaleChanged);
+  connect(mRenderer.get(), &Renderer::imageLoaded, this, &MainWindow::onImageLoaded);
+  // rendering menu: one anti-aliasing mode at a time
+  using AntiAliasing = RenderObjectManager::AntiAliasing;
+  auto* antiAliasingGroup = new QActionGroup(this);
+  for (const auto& [action, antiAliasing] :
+       {std::pair{mUI.actionAntiAliasingOff, AntiAliasing::Off},
+        std::pair{mUI.actionAntiAliasingMsaa2x, AntiAliasing::Msaa2x},
+        std::pair{mUI.actionAntiAliasingMsaa4x, AntiAliasing::Msaa4x},
+        std::pair{mUI.actionAntiAliasingMsaa8x, AntiAliasing::Msaa8x},
+        std::pair{mUI.actionAntiAliasingFxaa, AntiAliasing::Fxaa}}) {
+    antiAliasingGroup->addAction(action);
+    action->setChecked(antiAliasing == RenderObjectManager::kDefaultAntiAliasing);
+    connect(action, &QAction::triggered, this, [this, antiAliasing = antiAliasing]() {
+      SPDLOG_INFO("User action: anti-aliasing {}", RenderObjectManager::name(antiAliasing));
+      mRenderer->setAntiAliasing(antiAliasing);
+    });
+  }
 }
 
 }  // namespace nimagna
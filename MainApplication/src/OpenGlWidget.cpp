@@ -7,6 +7,10 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMessageBox>
 
+#include "Rendering/ShaderProgramCache.h"
+#include "Rendering/UniformBufferRing.h"
+#include "Rendering/UnitQuad.h"
+
 namespace nimagna {
 
 OpenGlWidget::OpenGlWidget(QWidget* parent /*= nullptr*/, Qt::WindowFlags f /*= Qt::WindowFlags()*/)
@@ -26,6 +30,9 @@ OpenGlWidget::~OpenGlWidget() {
   // the texture render object needs a current context for destruction
   context()->makeCurrent(context()->surface());
   mTextureRenderObject.reset();
+  ShaderProgramCache::releasePrograms(context());
+  UniformBufferRing::release(context());
+  UnitQuad::release(context());
 }
 
 void OpenGlWidget::setRenderer(std::shared_ptr<Renderer> renderer) {
@@ -93,8 +100,11 @@ void OpenGlWidget::paintGL() {
         TextureRenderObject::glTarget(mRenderer->renderObjectManager()->renderFrameBufferType()),
         mRenderer->renderObjectManager()->renderFrameBuffer()->texture());
   }
-  // render texture object without using its texture
+  // render texture object without using its texture, the framebuffer fills the viewport
+  auto& uniformBufferRing = UniformBufferRing::forCurrentContext();
+  uniformBufferRing.beginFrame(QMatrix4x4());
   mTextureRenderObject->draw();
+  uniformBufferRing.endFrame();
   glActiveTexture(GL_TEXTURE0);
 
   if (!mFirstDrawOccurred) {
@@ -176,6 +186,16 @@ void OpenGlWidget::mousePressEvent(QMouseEvent* event) {
     mLeftButtonDown = true;
     mLastMousePosition = event->globalPosition().toPoint();
   }
+  QPointF position;
+  if (renderData && event->button() == Qt::LeftButton &&
+      normalizedDevicePosition(event->position(), &position)) {
+    // picked on the CPU from the objects' bounds of the last frame
+    const auto pickResult = rom->pick(renderData->projectionMatrix(), position);
+    SPDLOG_DEBUG("Clicked on {}", pickResult.renderObject
+                                      ? pickResult.renderObject->getDisplayName()
+                                      : QString("nothing"));
+    emit renderObjectClicked(std::weak_ptr<RenderObject>(pickResult.renderObject));
+  }
   if (!event->isAccepted()) {
     QOpenGLWidget::mousePressEvent(event);
   }
@@ -255,6 +275,23 @@ void OpenGlWidget::handleResolutionChange(QSize resolution) {
                                                    mTextureRenderObject->sourcePixelFormat());
 }
 
+bool OpenGlWidget::normalizedDevicePosition(const QPointF& position,
+                                            QPointF* normalizedPosition) const {
+  if (mViewPort.isEmpty()) {
+    return false;
+  }
+  // the viewport is in device pixels and centered vertically, i.e. the same from top and bottom
+  const QPointF devicePosition = position * devicePixelRatioF();
+  const double x = 2. * (devicePosition.x() - mViewPort.x()) / mViewPort.width() - 1.;
+  // the framebuffer is shown flipped vertically: the top of the widget is the bottom in the frame
+  const double y = 2. * (devicePosition.y() - mViewPort.y()) / mViewPort.height() - 1.;
+  if (x < -1. || x > 1. || y < -1. || y > 1.) {
+    return false;
+  }
+  *normalizedPosition = QPointF(x, y);
+  return true;
+}
+
 void OpenGlWidget::updateRendering() {
   update();
 }
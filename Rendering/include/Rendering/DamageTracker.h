@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QtCore/QRect>
+#include <QtCore/QSize>
+#include <QtGui/QMatrix4x4>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Rendering/RenderQueue.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// Finds the screen rectangles that changed since the last frame, to re-render only those
+//
+// Every frame, each render queue entry is compared to the last frame: its screen rectangle, its
+// position in the draw order, its visibility, and its content version. An entry that changed
+// damages its old and its new rectangle, an entry gone since damages its old rectangle. A changed
+// view/projection or viewport, and invalidate(), damage everything.
+class RENDERING_API DamageTracker {
+ public:
+  // the damaged objects and the damaged area relative to the viewport of the last frame
+  struct Statistics {
+    int damagedObjectCount = 0;
+    double damagedArea = 0.0;
+  };
+
+  // the damaged rectangles of the frame in pixels (origin bottom left, as glScissor), non
+  // overlapping. Up to kMaxDamageRectCount, else their bounding rectangle.
+  const std::vector<QRect>& update(const std::vector<RenderQueue::Entry>& entries,
+                                   const std::vector<unsigned char>& visible,
+                                   const QMatrix4x4& viewProjection, const QSize& viewportSize);
+  // damages everything in the next frame, e.g. after the framebuffer content was lost
+  void invalidate() { mIsInvalid = true; }
+  // the screen rectangle of each entry in the last update, empty if not visible
+  const QRect& screenRect(size_t index) const { return mScreenRects[index]; }
+  const Statistics& lastFrameStatistics() const { return mLastFrameStatistics; }
+
+ private:
+  // more rectangles are drawn as one, each rectangle is a draw of the render queue
+  static constexpr int kMaxDamageRectCount = 4;
+  // pixels added around objects for linear filtering and multisampling
+  static constexpr int kMargin = 2;
+
+  // the state an object was drawn with in the last frame
+  struct ObjectState {
+    QRect screenRect;
+    size_t position = 0;
+    uint64_t contentVersion = 0;
+    uint64_t frame = 0;
+  };
+  // by the sequence number of the object's render queue entry, unlike an address never reused by
+  // an object added later
+  std::unordered_map<uint64_t, ObjectState> mObjectStates;
+  std::vector<QRect> mScreenRects;
+  std::vector<QRect> mDamageRects;
+  QMatrix4x4 mViewProjection;
+  QSize mViewportSize;
+  uint64_t mFrame = 0;
+  bool mIsInvalid = true;
+  Statistics mLastFrameStatistics;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QUrl>
+#include <QtMultimedia/QMediaPlayer>
+#include <QtMultimedia/QVideoFrame>
+#include <QtMultimedia/QVideoSink>
+#include <atomic>
+#include <deque>
+
+#include "TextureRenderObject.h"
+
+namespace nimagna {
+
+// a texture render object playing a local video file through QMediaPlayer/QVideoSink
+//
+// Decoded frames arrive on the media backend's thread and are queued in a small jitter buffer. On
+// every render tick, the frame due at the current render clock is uploaded through the streaming
+// upload path; frames that are already late are dropped instead of being rendered. Each object
+// owns its own player and sink, thus, several video objects can play concurrently.
+class RENDERING_API FrameSourceRenderObject : public TextureRenderObject {
+  Q_OBJECT
+
+ public:
+  FrameSourceRenderObject(TextureTarget type, const QUrl& source);
+  // not copyable or movable
+  FrameSourceRenderObject(const FrameSourceRenderObject& other) = delete;
+  FrameSourceRenderObject& operator=(const FrameSourceRenderObject& other) = delete;
+  FrameSourceRenderObject(FrameSourceRenderObject&&) = delete;
+  FrameSourceRenderObject& operator=(FrameSourceRenderObject&&) = delete;
+  virtual ~FrameSourceRenderObject();
+
+  // start/stop the playback
+  void play();
+  void stop();
+
+  // statistics: presented frames and frames dropped because they were late or the buffer was full
+  int presentedFrameCount() const { return mPresentedFrameCount; }
+  int droppedFrameCount() const { return mDroppedFrameCount; }
+
+ protected:
+  // takes the frame due at the current render clock and uploads it if requested, else keeps it
+  // for the next upload
+  virtual void updateTexture(bool upload) override;
+
+ private:
+  // called on the media backend's thread whenever the sink receives a new frame
+  void onVideoFrameChanged(const QVideoFrame& frame);
+  // takes the frame due at the current render clock from the jitter buffer (if any). Never blocks.
+  bool takeDueFrame(QVideoFrame& dueFrame);
+  // uploads a frame's pixels into the texture, RGBA/BGRA frames with a single copy into the upload
+  // buffer (instead of converting to an image first)
+  void uploadFrame(QVideoFrame& frame);
+
+  // the number of frames kept in the jitter buffer before the oldest is dropped
+  static constexpr int kJitterBufferSize = 4;
+  // if the due frame is further away from the render clock, the clock is resynchronized (e.g.
+  // after seeking or looping)
+  static constexpr qint64 kResyncThresholdUs = 500000;
+
+  std::unique_ptr<QMediaPlayer> mMediaPlayer;
+  std::unique_ptr<QVideoSink> mVideoSink;
+
+  // the jitter buffer, filled by the backend thread and emptied by the render thread
+  QMutex mFrameQueueMutex;
+  std::deque<QVideoFrame> mFrameQueue;
+  // the frame due but not uploaded yet since the object was not drawn (render thread only)
+  QVideoFrame mDueFrame;
+
+  // offset between the render clock and the stream's timestamps (render thread only)
+  bool mIsClockSynchronized = false;
+  qint64 mClockOffsetUs = 0;
+  // the last presented frame's start time to detect loops
+  qint64 mLastPresentedStartTimeUs = -1;
+
+  std::atomic_int mPresentedFrameCount = 0;
+  std::atomic_int mDroppedFrameCount = 0;
+  // log unsupported (converted) pixel formats only once
+  bool mConversionWarningLogged = false;
+};
+
+}  // namespace nimagna
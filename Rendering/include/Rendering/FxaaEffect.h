@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QOpenGLContext>
+#include <vector>
+
+#include "Rendering/PostProcessingEffect.h"
+#include "Rendering/Rendering.h"
+#include "Rendering/ShaderProgramCache.h"
+
+namespace nimagna {
+
+// Fast approximate anti-aliasing (FXAA) of the single-sampled frame, see
+// RenderObjectManager::AntiAliasing
+//
+// Pixels whose neighbourhood has a high luma contrast are blended along the edge with a few
+// bilinear samples. One full-frame pass replaces the multisampled scene and its resolve, at the
+// price of slightly softer texture detail.
+class RENDERING_API FxaaEffect final : public PostProcessingEffect {
+ public:
+  virtual QString name() const override { return "FXAA"; }
+  virtual void apply(const QOpenGLFramebufferObject& input) override;
+
+  // all shader program variants, e.g. to warm up the shader program cache
+  static std::vector<ShaderProgramCache::Key> shaderProgramKeys();
+
+ private:
+  static ShaderProgramCache::Key shaderProgramKey(GLenum textureTarget);
+
+  // the texture unit the frame is bound to
+  static constexpr GLint kTextureUnit = 0;
+  static const inline QString mVertexShaderFile = ":/resources/shaders/full_target.vert";
+  static const inline QString mFragmentShaderFile = ":/resources/shaders/fxaa.frag";
+};
+
+}  // namespace nimagna
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QImage>
+#include <optional>
+
+#include "Rendering/Rendering.h"
+#include "Rendering/TextureRenderObject.h"
+
+namespace nimagna {
+
+// Decodes image files into texture render objects
+//
+// If the decoder natively produces a format the texture can consume (e.g. RGB32 from JPEG or
+// ARGB32 from PNG), its scan lines are written straight into the render object's mapped streaming
+// upload buffer. This avoids the intermediate QImage, the format conversion and the driver's copy.
+// Other formats take the QImage path.
+class RENDERING_API ImageDecoder {
+ public:
+  // decodes the file into the render object's texture. OpenGL context must be current.
+  static bool decodeIntoTexture(const QString& filename, TextureRenderObject& renderObject);
+
+  // decodes the file into an image in the layout decodeIntoTexture uploads (i.e. the decoder's
+  // format if the texture can consume it, converted otherwise). Can be called on any thread.
+  static QImage decodeForUpload(const QString& filename,
+                                TextureRenderObject::SourcePixelFormat* sourcePixelFormat);
+
+  // the source pixel format to upload an image format without conversion (if any)
+  static std::optional<TextureRenderObject::SourcePixelFormat> directSourcePixelFormat(
+      QImage::Format format);
+
+ private:
+  // decodes into the mapped upload buffer, false if the fallback path must be used
+  static bool decodeIntoStagingBuffer(const QString& filename, TextureRenderObject& renderObject);
+};
+
+}  // namespace nimagna
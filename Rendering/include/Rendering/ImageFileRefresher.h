@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QRect>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtGui/QImage>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "Rendering/Rendering.h"
+#include "Rendering/TextureRenderObject.h"
+
+namespace nimagna {
+
+// Refreshes the textures of image files that changed on disk
+//
+// The changed file is decoded on a worker thread and compared tile by tile against the pixels
+// currently in the texture. Only the changed tiles are uploaded (glTexSubImage2D) on the next
+// render tick. The texture is rebuilt only if the image's size or pixel format changed. The
+// previous pixels are kept on the CPU after the first refresh of a file; the first refresh
+// rebuilds the textures from the decoded file instead of reading them back from the GPU.
+class RENDERING_API ImageFileRefresher {
+ public:
+  ImageFileRefresher();
+  // not copyable or movable
+  ImageFileRefresher(const ImageFileRefresher& other) = delete;
+  ImageFileRefresher& operator=(const ImageFileRefresher& other) = delete;
+  ImageFileRefresher(ImageFileRefresher&&) = delete;
+  ImageFileRefresher& operator=(ImageFileRefresher&&) = delete;
+  // waits for running refreshes
+  ~ImageFileRefresher();
+
+  // registers a render object showing the file
+  void watch(const QString& filename, std::shared_ptr<TextureRenderObject> renderObject);
+  // starts refreshing all render objects showing the file. OpenGL context must be current.
+  void refresh(const QString& filename);
+  // uploads the changed tiles of finished refreshes. OpenGL context must be current.
+  void uploadChangedTiles();
+  // forgets all files and render objects
+  void clear();
+
+ private:
+  struct WatchedFile {
+    std::vector<std::weak_ptr<TextureRenderObject>> renderObjects;
+    // the pixels currently in the textures (null until the first refresh)
+    QImage pixels;
+    TextureRenderObject::SourcePixelFormat sourcePixelFormat =
+        TextureRenderObject::SourcePixelFormat::RGB;
+  };
+  struct Refresh {
+    QString filename;
+    QImage pixels;
+    TextureRenderObject::SourcePixelFormat sourcePixelFormat =
+        TextureRenderObject::SourcePixelFormat::RGB;
+    // the changed regions (merged runs of tiles), empty if nothing changed
+    std::vector<QRect> changedRegions;
+    // set if size or format changed and the texture must be rebuilt
+    bool needsRebuild = false;
+    int tileCount = 0;
+    qint64 elapsedMs = 0;
+  };
+
+  // decodes the file and compares it to the previous pixels (worker thread)
+  void decodeAndCompare(const QString& filename, const QImage& previousPixels,
+                        TextureRenderObject::SourcePixelFormat previousSourcePixelFormat);
+  // applies a finished refresh to all render objects showing the file
+  void apply(const Refresh& refresh);
+  // the changed tiles between two images of equal size and depth, merged to horizontal runs
+  static std::vector<QRect> changedRegions(const QImage& previous, const QImage& current,
+                                           int* tileCount);
+
+  // square tiles compared and uploaded as a unit
+  static constexpr int kTileSize = 64;
+
+  // the watched files (render thread only)
+  std::map<QString, WatchedFile> mWatchedFiles;
+  // files being refreshed and files changing again meanwhile (render thread only)
+  std::set<QString> mRunningRefreshes;
+  std::set<QString> mRepeatedRefreshes;
+
+  QThreadPool mRefreshPool;
+  // finished refreshes shared with the workers
+  QMutex mFinishedMutex;
+  std::vector<Refresh> mFinishedRefreshes;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <atomic>
+#include <map>
+#include <set>
+
+#include "TextureRenderObject.h"
+
+namespace nimagna {
+
+// a texture render object playing back a sequence of image files (PNG/JPEG) at a fixed frame rate
+//
+// Frames are decoded ahead on worker threads into a bounded ring of ready frames. The ring covers a
+// fixed time span (kPrefetchDurationMs) rather than a fixed number of frames. On every render tick,
+// the frame due at the render clock is uploaded. If it is not decoded yet, the previous frame stays
+// visible and an underrun is reported; the render thread never waits for a decoder.
+class RENDERING_API ImageSequenceRenderObject : public TextureRenderObject {
+  Q_OBJECT
+
+ public:
+  // at the end of the sequence, either start over or hold the last frame
+  enum class PlaybackMode { Loop, Hold };
+
+  ImageSequenceRenderObject(TextureTarget type, const QStringList& filenames, int framesPerSecond,
+                            PlaybackMode playbackMode = PlaybackMode::Loop);
+  // not copyable or movable
+  ImageSequenceRenderObject(const ImageSequenceRenderObject& other) = delete;
+  ImageSequenceRenderObject& operator=(const ImageSequenceRenderObject& other) = delete;
+  ImageSequenceRenderObject(ImageSequenceRenderObject&&) = delete;
+  ImageSequenceRenderObject& operator=(ImageSequenceRenderObject&&) = delete;
+  virtual ~ImageSequenceRenderObject();
+
+
+  PlaybackMode playbackMode() const { return mPlaybackMode; }
+  void setPlaybackMode(PlaybackMode playbackMode) { mPlaybackMode = playbackMode; }
+  int frameCount() const { return static_cast<int>(mFilenames.size()); }
+  // the number of frames that were not decoded in time, each counted once and only after the
+  // first frame was shown
+  int underrunCount() const { return mUnderrunCount; }
+
+ signals:
+  // emitted (on the render thread) once per frame due that was not decoded in time
+  void underrun(int frameIndex);
+
+ protected:
+  // advances the prefetch window to the render clock and uploads the frame due if requested
+  virtual void updateTexture(bool upload) override;
+
+ private:
+  // the frame index of the sequence due at the given render timestamp
+  int frameIndexAt(qint64 renderTimestampUs) const;
+  // evicts frames outside the prefetch window and schedules decoding of missing frames
+  void updatePrefetchWindow(int currentFrameIndex);
+  // decodes a frame on a worker thread and stores it as ready frame
+  void decodeFrame(int frameIndex);
+
+  // the time span covered by the ring of decoded frames
+  static constexpr int kPrefetchDurationMs = 500;
+
+  const QStringList mFilenames;
+  const int mFramesPerSecond;
+  PlaybackMode mPlaybackMode;
+  // the ring's capacity in frames derived from the prefetch duration and the frame rate
+  const int mRingCapacity;
+
+  // the worker threads decoding ahead
+  QThreadPool mDecodePool;
+  // decoded frames and frames being decoded, shared with the workers
+  QMutex mFramesMutex;
+  std::map<int, QImage> mReadyFrames;
+  std::set<int> mPendingFrames;
+  std::set<int> mFailedFrames;
+  // set on destruction to let pending decodes finish early
+  std::atomic_bool mIsStopping = false;
+
+  // playback state (render thread only)
+  bool mHasStarted = false;
+  qint64 mStartTimestampUs = 0;
+  int mCurrentFrameIndex = -1;
+  int mUnderrunCount = 0;
+  // the frame last counted as underrun, the render ticks while it is due are not counted again
+  int mUnderrunFrameIndex = -1;
+};
+
+}  // namespace nimagna
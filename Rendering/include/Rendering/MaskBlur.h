@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QtCore/QSize>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QVector4D>
+#include <QtOpenGL/QOpenGLFramebufferObject>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "Rendering/RenderGraph.h"
+#include "Rendering/Rendering.h"
+#include "Rendering/ShaderProgramCache.h"
+
+namespace nimagna {
+
+// Blurs masks with a box filter in two separable passes into R8 targets of the mask's size
+//
+// The first pass averages the 2r+1 texels of each row around a texel (optionally filtered by a
+// sigmoid first), the second pass the 2r+1 results of each column. This averages the same
+// (2r+1)^2 texels as sampling them all per pixel with 2(2r+1) fetches, and evaluates the sigmoid
+// once per texel and row instead of once per sample, looked up in a table of the 256 mask levels.
+// Texels outside the mask count as 0, as the mask texture's transparent border.
+class RENDERING_API MaskBlur {
+ public:
+  struct Parameters {
+    // the blurring kernel size: the box is 2*radius+1 texels wide and high
+    int radius = 0;
+    // the sharpness of the sigmoid filter applied to the texels before blurring, 0 for none
+    float sharpness = 0.f;
+
+    bool operator==(const Parameters& other) const {
+      return radius == other.radius && sharpness == other.sharpness;
+    }
+    bool operator!=(const Parameters& other) const { return !(*this == other); }
+  };
+  enum class Direction { Horizontal, Vertical };
+
+  MaskBlur() = delete;
+
+  // the description of the intermediate and blurred targets of a mask
+  static RenderTargetPool::Description targetDescription(const QSize& maskSize,
+                                                         GLenum textureTarget);
+  // a target of the description, e.g. to keep a blurred mask across frames
+  static std::unique_ptr<QOpenGLFramebufferObject> createTarget(const QSize& maskSize,
+                                                                GLenum textureTarget);
+  // declares the two passes blurring the mask texture of the size and texture target into the
+  // blurred mask target (see targetDescription), the intermediate rows are a pooled target
+  static void addPasses(RenderGraph& renderGraph, GLuint maskTexture, GLenum textureTarget,
+                        const QSize& maskSize, const Parameters& parameters,
+                        RenderGraph::TargetId blurredMask);
+  // draws one pass from the source texture into the destination of the same size (bound
+  // afterwards). The first pass is horizontal and applies the sigmoid filter.
+  static void drawPass(GLuint sourceTexture, GLenum textureTarget, const Parameters& parameters,
+                       Direction direction, QOpenGLFramebufferObject& destination);
+  // the sigmoid filter as in the shaders
+  static float sigmoid(float value, float sharpness);
+
+  // all shader program variants, e.g. to warm up the shader program cache
+  static std::vector<ShaderProgramCache::Key> shaderProgramKeys();
+
+ private:
+  static ShaderProgramCache::Key shaderProgramKey(GLenum textureTarget, bool postProcessing);
+  // the sigmoid of the 256 mask levels, packed four per element as the shader's table
+  static constexpr int kSigmoidTableSize = 256;
+  static std::array<QVector4D, kSigmoidTableSize / 4> sigmoidTable(float sharpness);
+
+  // the texture unit the source is bound to
+  static constexpr GLint kTextureUnit = 0;
+  static const inline QString mVertexShaderFile = ":/resources/shaders/full_target.vert";
+  static const inline QString mFragmentShaderFile = ":/resources/shaders/mask_blur.frag";
+};
+
+}  // namespace nimagna
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QtCore/QRect>
+#include <QtCore/QSize>
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QRegion>
+#include <vector>
+
+#include "Rendering/RenderQueue.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// Skips render objects that are completely covered by opaque objects drawn after them
+//
+// The render queue is walked front to back (reverse draw order). Opaque objects whose screen
+// rectangle is axis aligned add it to the covered region, objects whose screen bounds lie within
+// the covered region are occluded. The test is conservative: rotated or perspective occluders do
+// not occlude anything.
+class RENDERING_API OcclusionCuller {
+ public:
+  // the occlusion result of the last frame. Overdraw is the drawn area relative to the viewport,
+  // i.e. how many times each pixel is blended on average.
+  struct Statistics {
+    int occludedCount = 0;
+    double overdraw = 0.0;
+    double overdrawWithoutOcclusion = 0.0;
+  };
+
+  // clears the visibility of the occluded entries
+  void cull(const std::vector<RenderQueue::Entry>& entries, const QMatrix4x4& viewProjection,
+            const QSize& viewportSize, std::vector<unsigned char>* visible);
+  const Statistics& lastFrameStatistics() const { return mLastFrameStatistics; }
+
+  // the screen rectangle of the object in pixels: the bounds of the corners (outer) and, if the
+  // corners form an axis aligned rectangle completely within the depth range, its inner pixels.
+  // If a corner is at or behind the eye (w <= 0), the outer rectangle is the whole viewport and
+  // the inner one is empty. False if the object has no bounds.
+  static bool screenRects(const RenderObject& renderObject, const QMatrix4x4& viewProjection,
+                          const QSize& viewportSize, QRect* outer, QRect* inner);
+
+ private:
+  QRegion mCoveredRegion;
+  Statistics mLastFrameStatistics;
+};
+
+}  // namespace nimagna
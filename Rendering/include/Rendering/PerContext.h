@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QObject>
+#include <QtGui/QOpenGLContext>
+#include <cassert>
+#include <map>
+#include <memory>
+#include <set>
+
+namespace nimagna {
+
+// One instance of T per OpenGL context, e.g. the buffers and targets of a context, created on first
+// use with the context current
+//
+// An instance is destroyed by release or when its context is about to be destroyed without being
+// released. The handler is connected once per context: instances created again after a release
+// do not connect it again. Safe to use from the threads of different contexts.
+template <typename T>
+class PerContext {
+ public:
+  PerContext() = default;
+  // not copyable or movable
+  PerContext(const PerContext& other) = delete;
+  PerContext& operator=(const PerContext& other) = delete;
+  PerContext(PerContext&&) = delete;
+  PerContext& operator=(PerContext&&) = delete;
+
+  // the instance of the current context, created on first use
+  T& forCurrentContext() {
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    assert(context);
+    // thread critical section
+    QMutexLocker locker(&mMutex);
+    auto& instance = mInstances[context];
+    if (!instance) {
+      instance = std::make_unique<T>();
+      watchContext(context);
+    }
+    return *instance;
+  }
+
+  // releases the instance of the context (if any). Must be current.
+  void release(QOpenGLContext* context) {
+    std::unique_ptr<T> instance;
+    {
+      QMutexLocker locker(&mMutex);
+      const auto iter = mInstances.find(context);
+      if (iter == mInstances.end()) {
+        return;
+      }
+      instance = std::move(iter->second);
+      mInstances.erase(iter);
+    }
+    // destroyed outside the lock, the context is current
+  }
+
+ private:
+  // forgets the instance if the context gets destroyed without releasing it. The mutex must be
+  // locked.
+  void watchContext(QOpenGLContext* context) {
+    if (!mWatchedContexts.insert(context).second) {
+      return;
+    }
+    QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, context, [this, context]() {
+      release(context);
+      QMutexLocker locker(&mMutex);
+      mWatchedContexts.erase(context);
+    });
+  }
+
+  QMutex mMutex;
+  std::map<QOpenGLContext*, std::unique_ptr<T>> mInstances;
+  // the contexts connected to watchContext's handler
+  std::set<QOpenGLContext*> mWatchedContexts;
+};
+
+}  // namespace nimagna
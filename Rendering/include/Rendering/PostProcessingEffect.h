@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtOpenGL/QOpenGLFramebufferObject>
+
+namespace nimagna {
+
+// A full-frame effect applied to the rendered frame, see
+// RenderObjectManager::addPostProcessingEffect
+//
+// Effects are chained as passes of the frame's render graph: each reads the previous result and
+// draws into the next target, the last one straight into the output framebuffer.
+class PostProcessingEffect {
+ public:
+  virtual ~PostProcessingEffect() = default;
+
+  virtual QString name() const = 0;
+  // disabled effects are skipped without a pass
+  virtual bool isEnabled() const { return true; }
+  // draws the effect of the input's color texture into the bound framebuffer of the same size.
+  // Called on the render thread with blending and depth test disabled.
+  virtual void apply(const QOpenGLFramebufferObject& input) = 0;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QtOpenGL/QOpenGLShaderProgram>
+#include <array>
+#include <vector>
+
+#include "Rendering/Rendering.h"
+#include "Rendering/UniformBufferRing.h"
+
+namespace nimagna {
+
+// Collects the textured rectangles of a frame and draws consecutive compatible ones with a single
+// instanced draw call
+//
+// Rectangles are compatible if they use the same shader program variant and texture target.
+// Their textures are bound to consecutive texture units, one texture slot per distinct texture
+// and mask pair, and each instance selects its slot. A batch ends when the slots run out.
+// Blending is the same for all of them. Only consecutive rectangles are merged, such that the
+// draw order stays the submission order. The per-instance data is written to the uniform buffer
+// ring, so a frame must have been begun there.
+class RENDERING_API RenderBatcher {
+ public:
+  // the texture (and mask) units per batch, must match the sampler arrays of the texture shaders
+  static constexpr int kTextureSlotCount = 6;
+
+  // a textured rectangle to draw
+  struct Item {
+    QOpenGLShaderProgram* program = nullptr;
+    GLenum textureTarget = GL_TEXTURE_2D;
+    // the textures to bind, 0 if an external texture is bound already (to the first slot)
+    GLuint texture = 0;
+    GLuint maskTexture = 0;
+    UniformBufferRing::ObjectUniforms uniforms{};
+  };
+  // the draw calls of the last frame
+  struct Statistics {
+    int itemCount = 0;
+    int drawCallCount = 0;
+  };
+
+  // appends the item to the pending batch, draws the pending batch first if not compatible
+  void add(const Item& item);
+  // the draw depth of the items added next (see UniformBufferRing::ObjectUniforms)
+  void setDrawDepth(float drawDepth) { mDrawDepth = drawDepth; }
+  // draws the pending batch, e.g. before something else is drawn
+  void flush();
+  // draws the pending batch and starts the statistics of the next frame
+  void endFrame();
+  const Statistics& lastFrameStatistics() const { return mLastFrameStatistics; }
+
+ private:
+  static bool isCompatible(const Item& item, const Item& other);
+  // the pending batch's slot of the item's textures, -1 if they have none yet
+  int textureSlot(const Item& item) const;
+
+  // the state of the pending batch (the first item), the textures of its slots, and the uniforms
+  // of all its instances
+  Item mBatch;
+  std::array<GLuint, kTextureSlotCount> mTextures{};
+  std::array<GLuint, kTextureSlotCount> mMaskTextures{};
+  int mUsedTextureSlotCount = 0;
+  std::vector<UniformBufferRing::ObjectUniforms> mInstances;
+  float mDrawDepth = 0.f;
+  Statistics mStatistics;
+  Statistics mLastFrameStatistics;
+};
+
+}  // namespace nimagna
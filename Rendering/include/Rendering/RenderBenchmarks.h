@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+class RenderObjectManager;
+
+// Benchmarks of the rendering pipeline's hot paths. Results are written to the log.
+class RENDERING_API RenderBenchmarks {
+ public:
+  // draws full screen quads with the specialized texture shader variants and with the reference
+  // shader branching on uniforms, and compares the fill rates. OpenGL context must be current.
+  // Run with LIBGL_ALWAYS_SOFTWARE=1 to measure the fill rate under llvmpipe.
+  static void shaderVariantFillRate();
+  // loads the image files as texture objects like the scene does and stacks them as full screen
+  // layers, draws them once blended back to front and once with the render object manager's
+  // opaque pass (front to back with depth test) followed by the blended transparent pass, and
+  // compares frame times and results. Render thread, the render context must be current.
+  static void opaquePassFillRate(RenderObjectManager& renderObjectManager,
+                                 const QStringList& filenames);
+  // blurs a full HD mask with radii up to 10, with and without the sigmoid filter, once sampling
+  // the whole box per pixel as the texture shaders did and once in two separable passes, and
+  // compares the times and results. OpenGL context must be current.
+  static void maskBlurFillRate();
+  // draws a grid of small objects with distinct textures once with a draw call per texture and
+  // once batched through the texture slots, and compares the draw calls, frame times and results.
+  // OpenGL context must be current.
+  static void batchedDraws();
+  // renders the current scene completely with each anti-aliasing mode and compares the frame
+  // times and the memory of the framebuffers at full resolution. Render thread, the render context
+  // must be current. Restores the mode.
+  static void antiAliasingModes(RenderObjectManager& renderObjectManager);
+  // reads an object's draw state as the render thread does while another thread keeps changing it
+  // (e.g. a frame source changing its texture), once locking a mutex shared with the writer and
+  // once from a triple buffer, and compares the time the reads take. No OpenGL context required.
+  static void objectStateContention();
+  // animates one group of a transform graph with many groups of objects and all groups, and
+  // compares the world matrix update times. No OpenGL context required.
+  static void transformGraphUpdate();
+  // builds a spatial index over 10k and 100k random object bounds, moves a tenth of them per
+  // frame, and compares point, rectangle, pick ray, and frustum queries with a linear scan. No
+  // OpenGL context required.
+  static void spatialIndexQueries();
+};
+
+}  // namespace nimagna
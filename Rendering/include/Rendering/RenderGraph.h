@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtOpenGL/QOpenGLFramebufferObject>
+#include <functional>
+#include <vector>
+
+#include "Rendering/RenderTargetPool.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The passes of a frame declared with the targets they read and write, executed in the order
+// they were added
+//
+// Targets are either imported (e.g. the output framebuffer, considered read after the frame) or
+// transient. Passes whose outputs no live pass reads and that write no imported target are culled
+// with the passes only they depend on. Transient targets are acquired from the pool right before
+// the first pass writing them and recycled right after the last pass reading them, such that a
+// chain of passes ping-pongs between two targets instead of allocating one per pass.
+// The graph is rebuilt every frame, declaring passes allocates nothing on the GPU.
+class RENDERING_API RenderGraph {
+ public:
+  using TargetId = int;
+  // draws the pass into its outputs, see framebuffer() for the targets
+  using Execute = std::function<void(const RenderGraph& graph)>;
+
+  struct Statistics {
+    int passCount = 0;
+    int culledPassCount = 0;
+    // the transient targets declared and the pooled framebuffers they used
+    int transientTargetCount = 0;
+    int acquiredTargetCount = 0;
+  };
+
+  RenderGraph() = default;
+  // not copyable or movable
+  RenderGraph(const RenderGraph& other) = delete;
+  RenderGraph& operator=(const RenderGraph& other) = delete;
+  RenderGraph(RenderGraph&&) = delete;
+  RenderGraph& operator=(RenderGraph&&) = delete;
+
+  // removes all passes and targets
+  void reset();
+  // a target owned elsewhere, its content is kept after the frame
+  TargetId importTarget(const QString& name, QOpenGLFramebufferObject* framebuffer);
+  // a target from the pool, alive from the first pass writing it to the last pass reading it
+  TargetId createTarget(const QString& name, const RenderTargetPool::Description& description);
+  // a pass reading the inputs and writing the outputs. Each target is written by one pass.
+  void addPass(const QString& name, std::vector<TargetId> inputs, std::vector<TargetId> outputs,
+               Execute execute);
+  // culls the unused passes and executes the others with targets from the pool
+  void execute(RenderTargetPool& pool);
+
+  // the framebuffer of a target, valid in the passes using it
+  QOpenGLFramebufferObject* framebuffer(TargetId target) const;
+  const Statistics& lastFrameStatistics() const { return mStatistics; }
+
+ private:
+  static constexpr int kNoPass = -1;
+
+  struct Target {
+    QString name;
+    RenderTargetPool::Description description;
+    QOpenGLFramebufferObject* framebuffer = nullptr;
+    bool isImported = false;
+    int writer = kNoPass;
+    // the live passes reading the target, counted down while executing
+    int readerCount = 0;
+  };
+  struct Pass {
+    QString name;
+    std::vector<TargetId> inputs;
+    std::vector<TargetId> outputs;
+    Execute execute;
+    // the outputs read by live passes or imported, culled at 0
+    int referenceCount = 0;
+  };
+
+  // counts the references and culls the passes nothing depends on
+  void cull();
+  bool isValid(TargetId target) const;
+
+  std::vector<Target> mTargets;
+  std::vector<Pass> mPasses;
+  Statistics mStatistics;
+};
+
+}  // namespace nimagna
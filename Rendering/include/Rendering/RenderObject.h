@@ -1,16 +1,24 @@
 #pragma once
 
 #include <QtCore/QObject>
+#include <QtCore/QPointF>
 #include <QtCore/QString>
 #include <QtCore/QUuid>
 #include <QtGui/QMatrix4x4>
 #include <QtGui/QQuaternion>
 #include <algorithm>  // std::clamp
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
+#include "Rendering/RenderGraph.h"
 #include "Rendering/Rendering.h"
+#include "Rendering/TransformGraph.h"
 
 namespace nimagna {
 
+class RenderBatcher;
+
 /* The base class for all render objects (RO)
  *
  * Render objects relate 1:1 to a ShotComponent and are managed by the RenderObjectManager (ROM).
@@ -39,16 +47,51 @@ class RENDERING_API RenderObject : public QObject {
 
   // set/get connected and active flag
   bool allowUpdates() const { return mAllowUpdates; }
-  void setAllowUpdates(bool allow) { mAllowUpdates = allow; }
+  void setAllowUpdates(bool allow) {
+    mAllowUpdates = allow;
+    markContentChanged();
+  }
 
   // draw the object. OpenGL context is active.
   virtual void draw() = 0;
+  // draw the object as part of a frame: objects that can be batched add themselves to the batcher,
+  // all others draw the pending batch first and then themselves (default)
+  virtual void submit(RenderBatcher& batcher);
   float alpha() const;
   void setFallbackAlpha(float alphaValue);
   // get the model matrix
   const QMatrix4x4& getModelMatrix() const;
-  // prepare for rendering
-  void prepare(const QMatrix4x4& vp);
+  // set the model matrix, e.g. the world matrix of the object's transform node
+  void setModelMatrix(const QMatrix4x4& modelMatrix);
+  // the object's node in the render object manager's transform graph
+  TransformGraph::NodeId transformNode() const { return mTransformNode; }
+  void setTransformNode(TransformGraph::NodeId node) { mTransformNode = node; }
+  // the object's rectangle in model space (origin x, y and extent width, height) to cull it,
+  // false if it has no bounds
+  virtual bool localBounds(float (&rect)[4]) const { return false; }
+  // true if the object covers everything behind its bounds completely
+  virtual bool isOpaque() const { return false; }
+  // the opacity at the position in the bounds (normalized, origin bottom left) for picking, from
+  // a copy on the CPU such that the GPU is never read back. Safe to call from any thread.
+  virtual float alphaAt(const QPointF& boundsPosition) const { return 1.f; }
+  // prepare for rendering: the view/projection matrix and the render clock's timestamp of the frame
+  // about to be rendered (microseconds since the render object manager was initialized). If
+  // overwritten, must call the base class' prepare method!
+  virtual void prepare(const QMatrix4x4& vp, qint64 renderTimestampUs);
+  // advances the content to the frame (e.g. the video clock and decode queues) and uploads what is
+  // due if the object is visible. Called for all objects after prepare, before anything is drawn,
+  // such that hidden or culled objects are up to date when they appear.
+  virtual void updateContent(bool isVisible) {}
+  // declares the passes preparing what the object draws in the frame (e.g. a blurred mask) and
+  // adds the targets the object reads to the inputs of the scene pass. Called for the visible
+  // objects after updateContent, the passes of objects not drawn are culled unless they write a
+  // target kept across frames (imported).
+  virtual void addPasses(RenderGraph& renderGraph, std::vector<RenderGraph::TargetId>* inputs) {}
+  // counts the changes to what the object draws (content, size, flips, alpha, visibility), e.g. to
+  // find the screen regions to redraw
+  uint64_t contentVersion() const { return mContentVersion.load(std::memory_order_acquire); }
+  // the content version of the state the object draws in the current frame
+  uint64_t frameContentVersion() const { return mFrameContentVersion; }
 
   // the display name
   void setDisplayName(const QString& displayName);
@@ -68,6 +111,13 @@ class RENDERING_API RenderObject : public QObject {
   QMatrix4x4 mViewProjectionMatrix;
   // the model matrix
   QMatrix4x4 mModelMatrix;
+  // the render clock's timestamp of the current frame in microseconds
+  qint64 mRenderTimestampUs = 0;
+  // the content version taken before the object took its state for the frame
+  uint64_t mFrameContentVersion = 0;
+
+  // marks a change to what the object draws, to be called after the change is published
+  void markContentChanged() { mContentVersion.fetch_add(1, std::memory_order_acq_rel); }
 
  protected:
   // flag indicating if that render object is ready for rendering
@@ -80,10 +130,13 @@ class RENDERING_API RenderObject : public QObject {
   bool mIsInitialized;
   // the layer is a volatile member used
   int mLayer;
+  // the node in the transform graph, kNoNode if not managed
+  TransformGraph::NodeId mTransformNode = TransformGraph::kNoNode;
   // alpha value being used if shot component is not available
   float mFallbackAlpha = 1.0f;
   // allow updates flag
   bool mAllowUpdates = true;
+  std::atomic<uint64_t> mContentVersion{0};
 
   QString mResourceIdentifier;
 };
@@ -1,16 +1,34 @@
 #pragma once
 
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
 #include <QtCore/QUuid>
 #include <QtGui/QOffscreenSurface>
 #include <QtGui/QOpenGLContext>
 #include <QtOpenGL/QOpenGLDebugLogger>
 #include <QtOpenGL/QOpenGLFramebufferObject>
+#include <QtOpenGL/QOpenGLTimerQuery>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
+#include "Rendering/DamageTracker.h"
+#include "Rendering/FxaaEffect.h"
+#include "Rendering/ImageFileRefresher.h"
+#include "Rendering/OcclusionCuller.h"
+#include "Rendering/PostProcessingEffect.h"
+#include "Rendering/RenderBatcher.h"
 #include "Rendering/RenderObject.h"
 #include "Rendering/RenderData.h"
+#include "Rendering/RenderGraph.h"
+#include "Rendering/RenderQueue.h"
 #include "Rendering/Rendering.h"
+#include "Rendering/ResolutionScaler.h"
+#include "Rendering/SpatialIndex.h"
 #include "Rendering/TextureRenderObject.h"
+#include "Rendering/TransformGraph.h"
+#include "Rendering/VisibilityCuller.h"
 
 namespace nimagna {
 
@@ -21,6 +39,12 @@ class RENDERING_API RenderObjectManager final : public QObject {
   friend class RenderWorker;
 
  public:
+  // how the edges of the scene are anti-aliased: not at all, by multisampling the scene and
+  // resolving it, or by an FXAA pass over the single-sampled frame
+  enum class AntiAliasing { Off, Msaa2x, Msaa4x, Msaa8x, Fxaa };
+  Q_ENUM(AntiAliasing)
+  static constexpr AntiAliasing kDefaultAntiAliasing = AntiAliasing::Msaa8x;
+
   // not copyable but movable
   RenderObjectManager();
   RenderObjectManager(const RenderObjectManager& other) = delete;
@@ -41,17 +65,99 @@ class RENDERING_API RenderObjectManager final : public QObject {
   const TextureRenderObject::TextureTarget renderFrameBufferType() const {
     return mRenderFramebufferTarget;
   }
+  // the transforms of the render objects (each has its node, see RenderObject::transformNode) and
+  // the groups they are arranged in. The world matrices become the objects' model matrices. Not
+  // synchronized: render thread only, e.g. in a slot of the render worker.
+  TransformGraph& transformGraph() { return mTransformGraph; }
+  // the culling and overdraw statistics of the last frame
+  const VisibilityCuller::Statistics& cullStatistics() const {
+    return mVisibilityCuller.lastFrameStatistics();
+  }
+  const OcclusionCuller::Statistics& occlusionStatistics() const {
+    return mOcclusionCuller.lastFrameStatistics();
+  }
+  // the render objects whose world space bounds contain the point or overlap the rectangle (in
+  // the xy plane) or the view frustum, as of the last frame and in no particular order. Safe to
+  // call from any thread; an object removed from the manager meanwhile expires.
+  std::vector<std::weak_ptr<RenderObject>> renderObjectsAt(const QPointF& point) const;
+  std::vector<std::weak_ptr<RenderObject>> renderObjectsIn(const QRectF& rect) const;
+  std::vector<std::weak_ptr<RenderObject>> renderObjectsInFrustum(
+      const QMatrix4x4& viewProjection) const;
+  // the front-most render object (the last drawn) at a position in normalized device coordinates
+  // of the view/projection matrix (e.g. RenderData::projectionMatrix), by intersecting the ray
+  // through it with the objects' bounds. Objects not drawn in the last frame (culled, hidden, or
+  // fully transparent) are skipped, the alpha test skips objects mostly transparent at the
+  // hit (see RenderObject::alphaAt). Safe to call from any thread, the GPU is not involved. The
+  // result keeps the object alive even if it is removed from the manager meanwhile.
+  struct PickResult {
+    std::shared_ptr<RenderObject> renderObject;
+    QVector3D worldPosition;
+    // the hit in the object's bounds (normalized, origin bottom left)
+    QPointF boundsPosition;
+  };
+  PickResult pick(const QMatrix4x4& viewProjection, const QPointF& normalizedDevicePosition,
+                  bool alphaTest = true) const;
 
-  void addTextureObject(const QString& filename);
+  // false if the file could not be loaded
+  bool addTextureObject(const QString& filename);
+  // refreshes the texture objects showing the image file after it changed on disk
+  void refreshTextureObjects(const QString& filename);
+  void addVideoObject(const QString& filename);
+  void addImageSequenceObject(const QStringList& filenames, int framesPerSecond);
 
   const RenderObjectList& renderObjects() const;
   const RenderObjectList& activeRenderObjects() const;
   bool isActiveRenderObject(const std::shared_ptr<RenderObject> renderObject) const;
   void changeOpenGlDebugging(bool enabled);
+  // draws opaque objects front to back with depth test first, then the others blended back to
+  // front. Otherwise, all objects are blended back to front.
+  void setOpaquePassEnabled(bool enabled) { mOpaquePassEnabled = enabled; }
+  bool isOpaquePassEnabled() const { return mOpaquePassEnabled; }
+  // in 2D mode, re-renders only the regions of the objects that changed since the last frame and
+  // keeps the previous frame's content elsewhere. Otherwise, every frame is rendered completely.
+  void setPartialRenderingEnabled(bool enabled) { mPartialRenderingEnabled = enabled; }
+  bool isPartialRenderingEnabled() const { return mPartialRenderingEnabled; }
+  const DamageTracker::Statistics& damageStatistics() const {
+    return mDamageTracker.lastFrameStatistics();
+  }
+  // changes the anti-aliasing and recreates the framebuffers, on the render thread
+  void setAntiAliasing(AntiAliasing antiAliasing);
+  AntiAliasing antiAliasing() const { return mAntiAliasing; }
+  // the samples per pixel of the scene, 0 if it is not multisampled
+  static int sampleCount(AntiAliasing antiAliasing);
+  static QString name(AntiAliasing antiAliasing);
+  // the estimated GPU memory of the scene and output framebuffers
+  qint64 framebufferByteCount() const { return mFramebufferByteCount; }
+  // scales the scene's resolution between 50% and 100% to keep the GPU time of a frame within the
+  // budget, the scene is upscaled into the output. Render thread.
+  void setDynamicResolutionEnabled(bool enabled, double frameTimeBudgetMs);
+  bool isDynamicResolutionEnabled() const { return mDynamicResolutionEnabled; }
+  double frameTimeBudgetMs() const { return mResolutionScaler.frameTimeBudgetMs(); }
+  // the scale of the scene's width and height, 1 at full resolution. Safe to call from any thread.
+  float resolutionScale() const { return mResolutionScale; }
+  // full-frame effects applied to the rendered frame in the order they were added. The frame is
+  // rendered completely while an effect is enabled unless a scene framebuffer keeps the scene
+  // (any anti-aliasing).
+  void addPostProcessingEffect(const std::shared_ptr<PostProcessingEffect>& effect);
+  void removePostProcessingEffect(const std::shared_ptr<PostProcessingEffect>& effect);
+  // the passes of the last frame and the intermediate targets they used
+  const RenderGraph::Statistics& renderGraphStatistics() const {
+    return mRenderGraph.lastFrameStatistics();
+  }
+  // renders a frame into the render framebuffer, false if there was nothing to render. Render
+  // thread, the context must be current.
+  bool render();
+  // draws all objects of the render queue into the bound framebuffer as a frame does, without
+  // culling or damage regions: in the opaque and transparent passes if enabled, otherwise blended
+  // back to front. The uniform buffer ring's frame must have begun. Render thread.
+  void drawRenderObjects(const std::vector<RenderQueue::Entry>& renderQueue);
+
+ signals:
+  // the resolution scale changed (see setDynamicResolutionEnabled), emitted on the render thread
+  void resolutionScaleChanged(float scale);
 
  private:
   // pass the context to the render object manager and initialize
-  bool render();
   void initialize(std::shared_ptr<QOpenGLContext> context,
                   std::shared_ptr<QOffscreenSurface> surface);
   void cleanUp();
@@ -64,8 +170,31 @@ class RENDERING_API RenderObjectManager final : public QObject {
   // make OpenGL context the current context
   bool tryMakeOpenGlContextCurrent(bool isCritical);
 
+  // the GPU frame times measured since the last frame drive the resolution scale
+  void updateResolutionScale();
+  // the timer query measuring the GPU time of this frame, null if the query of three frames ago is
+  // not available yet (the GPU is behind and waiting would stall)
+  QOpenGLTimerQuery* beginFrameTimer();
+
   // removes and deletes all render objects
   void clearRenderObjects();
+  // draws the visible objects of the render queue in the damaged regions of the bound framebuffer
+  void drawRenderQueue(const std::vector<RenderQueue::Entry>& renderQueue,
+                       const std::vector<QRect>& damageRects);
+  // draws the objects of the render queue to draw in the current region in an opaque and a
+  // transparent pass
+  void drawOpaqueAndTransparentPasses(const std::vector<RenderQueue::Entry>& renderQueue);
+  // adds the object to the list, the render queue, and the transform graph
+  void addRenderObject(const std::shared_ptr<RenderObject>& renderObject);
+  // passes the changed world matrices to the render objects
+  void updateTransforms();
+  // moves the changed objects of the render queue in the spatial index
+  void updateSpatialIndex();
+  // records which objects are drawn in the frame for picking (see mVisibleRenderObjects)
+  void updatePickableObjects(const std::vector<RenderQueue::Entry>& renderQueue);
+  // the objects of the spatial index proxies. The spatial index mutex must be locked.
+  std::vector<std::weak_ptr<RenderObject>> renderObjectsOf(
+      const std::vector<SpatialIndex::ProxyId>& proxies) const;
   // access render objects
   int renderObjectListCount() const;
   int getRenderObjectRowIndex(const std::shared_ptr<RenderObject>& object) const;
@@ -84,11 +213,80 @@ class RENDERING_API RenderObjectManager final : public QObject {
   std::unique_ptr<QOpenGLFramebufferObject> mRenderFramebuffer;
   const TextureRenderObject::TextureTarget mRenderFramebufferTarget =
       TextureRenderObject::kDefaultTextureTarget;
-  std::unique_ptr<QOpenGLFramebufferObject> mMultisampleFramebuffer;
+  // the framebuffer the scene is drawn into unless straight into the render framebuffer (without
+  // anti-aliasing): multisampled, or single-sampled for FXAA
+  std::unique_ptr<QOpenGLFramebufferObject> mSceneFramebuffer;
+  AntiAliasing mAntiAliasing = kDefaultAntiAliasing;
+  FxaaEffect mFxaaEffect;
+  qint64 mFramebufferByteCount = 0;
   QSize mCurrentOutputResolution = {};
+  // the scene's resolution scale driven by the GPU frame times, read without waiting a few frames
+  // later
+  bool mDynamicResolutionEnabled = false;
+  ResolutionScaler mResolutionScaler;
+  std::atomic<float> mResolutionScale = 1.f;
+  static constexpr int kFrameTimerCount = 3;
+  struct FrameTimer {
+    std::unique_ptr<QOpenGLTimerQuery> query;
+    bool isPending = false;
+  };
+  std::array<FrameTimer, kFrameTimerCount> mFrameTimers;
+  int mFrameTimerIndex = 0;
+
+  // the render clock passed to the render objects to synchronize time based sources
+  QElapsedTimer mRenderClock;
 
   // the ordered list of all render objects
   RenderObjectList mRenderObjectsList;
+  // the render objects in draw order, re-sorted incrementally
+  RenderQueue mRenderQueue;
+  // the transform hierarchy and the render object of each node (groups have none)
+  TransformGraph mTransformGraph;
+  std::unordered_map<TransformGraph::NodeId, RenderObject*> mTransformNodeRenderObjects;
+  // the world space bounds of the render objects for region queries and picking, and what picking
+  // needs of each object as of the last frame (objects without bounds yet are not indexed)
+  struct SpatialIndexEntry {
+    // the object itself, for results used on other threads
+    std::weak_ptr<RenderObject> renderObject;
+    SpatialIndex::ProxyId proxy = SpatialIndex::kNoProxy;
+    QMatrix4x4 modelMatrix;
+    QMatrix4x4 inverseModelMatrix;
+    float bounds[4] = {};
+    int layer = 0;
+    uint64_t sequence = 0;
+    // drawn in the last frame, i.e. not culled, hidden, or fully transparent
+    bool isVisible = false;
+  };
+  mutable QMutex mSpatialIndexMutex;
+  SpatialIndex mSpatialIndex;
+  std::unordered_map<const RenderObject*, SpatialIndexEntry> mSpatialIndexEntries;
+  // skips the objects that are not visible in a frame
+  VisibilityCuller mVisibilityCuller;
+  // skips the objects that are covered by opaque objects in front of them
+  OcclusionCuller mOcclusionCuller;
+  int mLoggedCulledCount = -1;
+  int mLoggedOccludedCount = -1;
+  // whether each render queue entry is drawn in the current frame and in the current region
+  std::vector<unsigned char> mVisibleRenderObjects;
+  std::vector<unsigned char> mDrawnRenderObjects;
+  // the regions changed since the last frame, re-rendered with scissor and resolved alone
+  bool mPartialRenderingEnabled = true;
+  DamageTracker mDamageTracker;
+  std::vector<QRect> mFullFrameRects;
+  // whether opaque objects are drawn in a separate pass and which entries are opaque
+  bool mOpaquePassEnabled = true;
+  std::vector<unsigned char> mOpaqueRenderObjects;
+  // the passes of a frame: the scene, the multisample resolve, FXAA, and the post-processing
+  // effects
+  RenderGraph mRenderGraph;
+  std::vector<std::shared_ptr<PostProcessingEffect>> mPostProcessingEffects;
+  std::vector<PostProcessingEffect*> mAppliedPostProcessingEffects;
+  // merges the draws of consecutive compatible render objects
+  RenderBatcher mRenderBatcher;
+  int mLoggedDrawCallCount = -1;
+
+  // refreshes textures of image files that changed on disk
+  ImageFileRefresher mImageFileRefresher;
 
   // the core application
   std::shared_ptr<RenderData> mCurrentRenderData;
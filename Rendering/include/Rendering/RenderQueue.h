@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtGui/QMatrix4x4>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Rendering/RenderObject.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The render objects in draw order: by layer, then back to front by view depth, then in the order
+// they were added (stable)
+//
+// The order is kept between frames and updated incrementally: only objects whose properties
+// changed (propertiesChanged) are moved to their new position. A changed view/projection matrix
+// changes all depths; the nearly sorted order is then repaired with an insertion sort, which is
+// linear if few objects swap places, or sorted again if too many do.
+class RENDERING_API RenderQueue {
+ public:
+  struct SortKey {
+    int layer = 0;
+    // normalized device depth of the object's origin, greater is farther away
+    float depth = 0.f;
+    uint64_t sequence = 0;
+
+    bool operator<(const SortKey& other) const {
+      if (layer != other.layer) return layer < other.layer;
+      // back to front
+      if (depth != other.depth) return depth > other.depth;
+      return sequence < other.sequence;
+    }
+  };
+  struct Entry {
+    std::shared_ptr<RenderObject> renderObject;
+    SortKey key;
+  };
+
+  RenderQueue() = default;
+  // not copyable or movable
+  RenderQueue(const RenderQueue& other) = delete;
+  RenderQueue& operator=(const RenderQueue& other) = delete;
+  RenderQueue(RenderQueue&&) = delete;
+  RenderQueue& operator=(RenderQueue&&) = delete;
+  ~RenderQueue();
+
+  // adds the object once, objects already in the queue are ignored
+  void add(const std::shared_ptr<RenderObject>& renderObject);
+  // removes the object and stops watching its properties
+  void remove(const RenderObject* renderObject);
+  void clear();
+  // the render objects in draw order for the view/projection matrix
+  const std::vector<Entry>& update(const QMatrix4x4& viewProjection);
+  // the current key of the object, nullptr if it is not in the queue
+  const SortKey* keyOf(const RenderObject* renderObject) const;
+  // the objects added or changed before the last update, each once (valid until the next update)
+  const std::vector<RenderObject*>& changedObjects() const { return mUpdatedObjects; }
+
+ private:
+  SortKey sortKey(const RenderObject& renderObject, uint64_t sequence) const;
+  // moves the entry of a changed object to its new position
+  void reinsert(const RenderObject* renderObject);
+
+  std::vector<Entry> mEntries;
+  // the key of each object's entry, to find it by binary search
+  std::unordered_map<const RenderObject*, SortKey> mKeys;
+  // the propertiesChanged connection of each object
+  std::unordered_map<const RenderObject*, QMetaObject::Connection> mConnections;
+  QMatrix4x4 mViewProjection;
+  uint64_t mNextSequence = 0;
+
+  // objects whose properties changed since the last update (signals may come from any thread)
+  QMutex mChangedMutex;
+  std::vector<RenderObject*> mChangedObjects;
+  std::vector<RenderObject*> mUpdatedObjects;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QtCore/QSize>
+#include <QtGui/QOpenGLContext>
+#include <QtOpenGL/QOpenGLFramebufferObject>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The intermediate framebuffers of an OpenGL context, recycled across passes and frames
+//
+// A pass acquires a target of the description it needs and recycles it as soon as the last pass
+// reading it ran, such that passes whose lifetimes do not overlap share (alias) the same target.
+// Targets unused for a number of frames are deleted, e.g. after the output size changed.
+class RENDERING_API RenderTargetPool {
+ public:
+  // what a target is made of, targets of equal descriptions are interchangeable
+  struct Description {
+    QSize size;
+    GLenum internalFormat = GL_RGBA8;
+    GLenum textureTarget = GL_TEXTURE_2D;
+    // 0 for a texture, otherwise a multisample renderbuffer
+    int samples = 0;
+    bool hasDepth = false;
+
+    bool operator<(const Description& other) const {
+      return std::make_tuple(size.width(), size.height(), internalFormat, textureTarget, samples,
+                             hasDepth) < std::make_tuple(other.size.width(), other.size.height(),
+                                                         other.internalFormat, other.textureTarget,
+                                                         other.samples, other.hasDepth);
+    }
+  };
+  struct Statistics {
+    // the targets alive and their estimated memory
+    int targetCount = 0;
+    qint64 byteCount = 0;
+    // the targets created since the pool was created
+    int createdCount = 0;
+  };
+
+  // the pool of the current context, created on first use
+  static RenderTargetPool& forCurrentContext();
+  // releases the pool of the context. Must be current.
+  static void release(QOpenGLContext* context);
+  // the estimated memory of a target
+  static qint64 byteCount(const Description& description);
+
+  RenderTargetPool() = default;
+  // not copyable or movable
+  RenderTargetPool(const RenderTargetPool& other) = delete;
+  RenderTargetPool& operator=(const RenderTargetPool& other) = delete;
+  RenderTargetPool(RenderTargetPool&&) = delete;
+  RenderTargetPool& operator=(RenderTargetPool&&) = delete;
+  ~RenderTargetPool() = default;
+
+  // a free target of the description, created if there is none. Its content is undefined.
+  QOpenGLFramebufferObject* acquire(const Description& description);
+  // hands the target back to the pool for the following passes and frames
+  void recycle(QOpenGLFramebufferObject* target);
+  // deletes the free targets unused for kMaxUnusedFrameCount frames
+  void endFrame();
+  const Statistics& statistics() const { return mStatistics; }
+
+ private:
+  static constexpr int kMaxUnusedFrameCount = 60;
+
+  struct Target {
+    std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+    Description description;
+    bool isFree = false;
+    int unusedFrameCount = 0;
+  };
+
+  std::vector<Target> mTargets;
+  Statistics mStatistics;
+};
+
+}  // namespace nimagna
@@ -38,10 +38,34 @@ class RenderWorker final : public QObject {
   void stopRendering();
   // loads an image as texture render object
   void loadImage(QString filename);
+  // refreshes the texture render objects of an image file that changed on disk
+  void refreshImage(QString filename);
+  // loads a video as frame source render object
+  void loadVideo(QString filename);
+  // loads an image sequence played back at output frame rate
+  void loadImageSequence(QStringList filenames);
+  // runs the shader variant fill rate benchmark with the render context
+  void benchmarkShaderVariants();
+  // runs the opaque pass fill rate benchmark with the image files and the render context
+  void benchmarkOpaquePass(QStringList filenames);
+  // runs the mask blur benchmark with the render context
+  void benchmarkMaskBlur();
+  // runs the batched draws benchmark with the render context
+  void benchmarkBatchedDraws();
+  // runs the anti-aliasing benchmark rendering the current scene
+  void benchmarkAntiAliasing();
+  // changes the anti-aliasing of the rendered frames
+  void changeAntiAliasing(RenderObjectManager::AntiAliasing antiAliasing);
+  // enables or disables the dynamic resolution with the output frame interval as budget
+  void changeDynamicResolution(bool enabled);
 
  signals:
   // signals a rendered frame to the consumer, e.g. the virtual camera
   void renderFrameReady();
+  // signals a changed resolution scale of the dynamic resolution
+  void resolutionScaleChanged(float scale);
+  // signals an image file loaded as texture render object, e.g. to watch it for changes
+  void imageLoaded(QString filename);
 
  private slots:
   // rendering triggered by the timer
@@ -51,6 +75,9 @@ class RenderWorker final : public QObject {
   void createAndStartTimerIfNeeded();
   void udpateOutputFps();
 
+  // the output frame rate
+  static constexpr int kOutputFps = 30;
+
   // timer to trigger rendering
   std::unique_ptr<QTimer> mTimer;
   // render object manager doing the rendering
@@ -80,6 +107,19 @@ class RENDERING_API Renderer final : public QObject {
   void stop();
 
   void addImage(QString filename);
+  void addVideo(QString filename);
+  void addImageSequence(QStringList filenames);
+  // benchmarks run on the render thread
+  void runShaderVariantBenchmark();
+  void runOpaquePassBenchmark(const QStringList& filenames);
+  void runMaskBlurBenchmark();
+  void runBatchedDrawsBenchmark();
+  void runAntiAliasingBenchmark();
+  // the anti-aliasing of the rendered frames, see RenderObjectManager::AntiAliasing
+  void setAntiAliasing(RenderObjectManager::AntiAliasing antiAliasing);
+  // scales the render resolution down while frames take longer than the output frame interval,
+  // see RenderObjectManager::setDynamicResolutionEnabled
+  void setDynamicResolutionEnabled(bool enabled);
 
   // access to the ROM
   std::shared_ptr<RenderObjectManager> renderObjectManager() const;
@@ -95,8 +135,22 @@ class RENDERING_API Renderer final : public QObject {
   void stopRenderer();
   // signal that the the rendered frame was updated
   void renderFrameUpdated();
+  // signal that the dynamic resolution changed the resolution scale (1 at full resolution)
+  void resolutionScaleChanged(float scale);
+  // signal that an image file was loaded, failed loads are not signaled
+  void imageLoaded(QString filename);
 
   void loadImage(QString filename);
+  void refreshImage(QString filename);
+  void loadVideo(QString filename);
+  void loadImageSequence(QStringList filenames);
+  void benchmarkShaderVariants();
+  void benchmarkOpaquePass(QStringList filenames);
+  void benchmarkMaskBlur();
+  void benchmarkBatchedDraws();
+  void benchmarkAntiAliasing();
+  void changeAntiAliasing(RenderObjectManager::AntiAliasing antiAliasing);
+  void changeDynamicResolution(bool enabled);
 
  private:
   // The render worker performs the rendering
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtCore/QSize>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// Picks the resolution scale of the scene from the measured time of the last frames, to trade
+// resolution for frame rate when a frame takes longer than the budget
+//
+// The scale steps down by kScaleStep (to at least kMinScale) once the smoothed frame time stayed
+// above the budget for kDownscaleFrameCount frames. It steps up only once the time predicted at
+// the next step (the pixels grow with the square of the scale) stayed well below the budget for
+// kUpscaleFrameCount frames. The gap between the thresholds and the longer wait to step up keep
+// the scale from oscillating.
+class RENDERING_API ResolutionScaler {
+ public:
+  static constexpr float kMinScale = 0.5f;
+  static constexpr float kScaleStep = 0.125f;
+
+  // the time a frame may take, e.g. the output frame interval
+  void setFrameTimeBudget(double frameTimeBudgetMs) { mFrameTimeBudgetMs = frameTimeBudgetMs; }
+  double frameTimeBudgetMs() const { return mFrameTimeBudgetMs; }
+  // adds the measured time of a frame, true if the scale changed
+  bool addFrameTime(double frameTimeMs);
+  // back to full resolution, forgets the measured times
+  void reset();
+
+  // the scale of the width and height, 1 at full resolution
+  float scale() const { return mScale; }
+  // the smoothed frame time, as of the current scale
+  double averageFrameTimeMs() const { return mAverageFrameTimeMs; }
+  // the size at the current scale, at least 1x1
+  QSize scaledSize(const QSize& size) const;
+
+ private:
+  // the weight of a new frame time in the average
+  static constexpr double kSmoothing = 0.1;
+  // the average frame time relative to the budget above which the scale steps down, and the
+  // predicted frame time at the next step below which it steps up
+  static constexpr double kDownscaleThreshold = 0.95;
+  static constexpr double kUpscaleThreshold = 0.75;
+  static constexpr int kDownscaleFrameCount = 5;
+  static constexpr int kUpscaleFrameCount = 60;
+
+  void changeScale(float scale);
+
+  double mFrameTimeBudgetMs = 1000.0 / 30.0;
+  float mScale = 1.f;
+  double mAverageFrameTimeMs = 0.0;
+  bool mHasFrameTime = false;
+  // the consecutive frames above the down- and below the upscale threshold
+  int mOverBudgetFrameCount = 0;
+  int mUnderBudgetFrameCount = 0;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtGui/QOpenGLContext>
+#include <QtOpenGL/QOpenGLShaderProgram>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// Registry of linked shader programs shared by all render objects of an OpenGL context
+//
+// A program is compiled and linked once per variant (shader files and feature set) and context.
+// The features are defined as preprocessor symbols such that each variant is specialized at
+// compile time instead of branching on uniforms.
+// Render objects hold shared references. Programs are not shared across contexts even if the
+// contexts share objects: uniforms are program state and the contexts render on different threads.
+//
+// Linked programs are persisted as program binaries in a versioned disk cache. The cache file name
+// hashes the shader sources, the feature set and the driver, such that changed shaders or an
+// updated driver never load a stale binary. Binaries the driver rejects are deleted and compiled
+// from source.
+class RENDERING_API ShaderProgramCache {
+ public:
+  // identifies a program variant
+  struct Key {
+    QString vertexShaderFile;
+    QString fragmentShaderFile;
+    // the features the program is specialized for (sorted), defined as preprocessor symbols
+    QStringList features;
+
+    bool operator<(const Key& other) const {
+      return std::tie(vertexShaderFile, fragmentShaderFile, features) <
+             std::tie(other.vertexShaderFile, other.fragmentShaderFile, other.features);
+    }
+  };
+  // called once with the bound program before it is handed out first, e.g. to set constant
+  // uniforms
+  using Initializer = std::function<void(QOpenGLShaderProgram& program)>;
+
+  struct Statistics {
+    // the number of programs alive in all contexts
+    int programCount = 0;
+    // the number of programs compiled and linked from source
+    int compileCount = 0;
+    // the number of programs loaded from the binary cache
+    int binaryLoadCount = 0;
+    // the number of requests served without compiling or loading
+    int cacheHitCount = 0;
+    // the total time spent compiling and linking from source
+    qint64 compileTimeUs = 0;
+    // the total time spent loading binaries
+    qint64 binaryLoadTimeUs = 0;
+    // the compile time of the programs loaded from the binary cache when they were compiled
+    qint64 savedCompileTimeUs = 0;
+  };
+
+  ShaderProgramCache() = delete;
+
+  // returns the variant's program of the current context, compiles it on first use
+  static std::shared_ptr<QOpenGLShaderProgram> program(const Key& key,
+                                                       const Initializer& initializer = {});
+  // loads or compiles all variants of the current context at once. All compilations are issued
+  // before the first link status is queried such that the driver can compile in parallel (with
+  // GL_KHR_parallel_shader_compile on its own threads).
+  static void warmUp(const std::vector<Key>& keys);
+  // releases the programs of the context. Must be current.
+  static void releasePrograms(QOpenGLContext* context);
+  static Statistics statistics();
+  // the directory of the program binaries of the current cache version
+  static QString binaryCacheDirectory();
+
+ private:
+  struct Entry {
+    std::shared_ptr<QOpenGLShaderProgram> program;
+    bool isInitialized = false;
+  };
+  using ProgramMap = std::map<Key, Entry>;
+
+  // a program being loaded or compiled
+  struct PendingProgram {
+    Key key;
+    std::shared_ptr<QOpenGLShaderProgram> program;
+    // the compiled shaders attached to the program (none if loaded from a binary)
+    std::vector<GLuint> shaders;
+    QString binaryCacheFile;
+    // the compile time recorded with the loaded binary
+    std::optional<qint64> binaryCompileTimeUs;
+  };
+
+  // loads the binary or issues compilation and linking without waiting for the result
+  static std::optional<PendingProgram> beginCompile(const Key& key);
+  // waits for the link result and releases the shaders
+  static bool finishCompile(PendingProgram& pendingProgram);
+  // updates the statistics and stores the binary of a program compiled from source
+  static void recordCompletion(PendingProgram& pendingProgram, qint64 elapsedUs);
+  // inserts a #define per feature after the source's #version directive
+  static QByteArray withDefines(const QByteArray& source, const QStringList& defines);
+  // the cache file identifying the sources, features, and driver
+  static QString binaryCacheFile(const Key& key, const QByteArray& vertexSource,
+                                 const QByteArray& fragmentSource);
+  static bool loadBinary(QOpenGLShaderProgram& program, const QString& filename,
+                         qint64* compileTimeUs);
+  static void storeBinary(QOpenGLShaderProgram& program, const QString& filename,
+                          qint64 compileTimeUs);
+  static bool isBinaryCacheSupported();
+  // lets the driver compile on as many threads as it likes (GL_KHR_parallel_shader_compile)
+  static void enableParallelCompilation();
+  // releases the context's programs when it is destroyed, connects once per context. The mutex
+  // must be locked.
+  static void watchContext(QOpenGLContext* context);
+
+  // bump if the file layout changes: older cache directories are ignored
+  static constexpr quint32 kBinaryCacheVersion = 1;
+  static constexpr quint32 kBinaryCacheMagic = 0x4E53'4843;  // "NSHC"
+
+  static inline QMutex mMutex;
+  static inline std::map<QOpenGLContext*, ProgramMap> mPrograms;
+  // the contexts connected to watchContext's handler
+  static inline std::set<QOpenGLContext*> mWatchedContexts;
+  static inline Statistics mStatistics;
+};
+
+}  // namespace nimagna
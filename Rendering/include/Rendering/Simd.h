@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// SIMD helpers with SSE2 (x86-64), NEON (AArch64), and scalar implementations
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NIMAGNA_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define NIMAGNA_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace nimagna::simd {
+
+// true if both byte ranges are equal
+inline bool equalBytes(const unsigned char* a, const unsigned char* b, size_t size) {
+  size_t offset = 0;
+#if defined(NIMAGNA_SIMD_SSE2)
+  // 64 bytes per iteration: accumulate the differences and branch once
+  for (; offset + 64 <= size; offset += 64) {
+    __m128i difference = _mm_setzero_si128();
+    for (size_t lane = 0; lane < 64; lane += 16) {
+      const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset + lane));
+      const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset + lane));
+      difference = _mm_or_si128(difference, _mm_xor_si128(va, vb));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(difference, _mm_setzero_si128())) != 0xFFFF) {
+      return false;
+    }
+  }
+  for (; offset + 16 <= size; offset += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+      return false;
+    }
+  }
+#elif defined(NIMAGNA_SIMD_NEON)
+  for (; offset + 64 <= size; offset += 64) {
+    uint8x16_t difference = vdupq_n_u8(0);
+    for (size_t lane = 0; lane < 64; lane += 16) {
+      difference =
+          vorrq_u8(difference, veorq_u8(vld1q_u8(a + offset + lane), vld1q_u8(b + offset + lane)));
+    }
+    if (vmaxvq_u8(difference) != 0) {
+      return false;
+    }
+  }
+  for (; offset + 16 <= size; offset += 16) {
+    if (vmaxvq_u8(veorq_u8(vld1q_u8(a + offset), vld1q_u8(b + offset))) != 0) {
+      return false;
+    }
+  }
+#endif
+  // the remainder (or everything without SIMD support)
+  return std::memcmp(a + offset, b + offset, size - offset) == 0;
+}
+
+// Rectangles in the z=0 plane, each transformed by its own 4x4 matrix, in structure of arrays
+// layout: matrix[k][i] is element k (column-major, like QMatrix4x4::constData) of rectangle i's
+// matrix and rect[0..3][i] are its origin x, y and extent width, height. Only the matrix elements
+// of the x, y, and w columns (0-7, 12-15) are read.
+struct RectangleBatch {
+  const float* matrix[16];
+  const float* rect[4];
+};
+
+// false if all corners of the rectangle are beyond the same plane of the clip volume
+// -w <= x, y, z <= w (i.e. its normalized device bounding box misses [-1,1]^3). Tested in clip
+// space without dividing by w: rectangles with a corner at or behind the eye (w <= 0) are kept.
+inline bool rectangleInClipVolume(const RectangleBatch& batch, size_t index) {
+  bool allBelow[3] = {true, true, true};
+  bool allAbove[3] = {true, true, true};
+  const float* const* m = batch.matrix;
+  for (int corner = 0; corner < 4; ++corner) {
+    const float x = batch.rect[0][index] + ((corner & 1) ? batch.rect[2][index] : 0.f);
+    const float y = batch.rect[1][index] + ((corner & 2) ? batch.rect[3][index] : 0.f);
+    const float w = m[3][index] * x + m[7][index] * y + m[15][index];
+    if (!(w > 0.f)) {
+      return true;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+      const float clip = m[axis][index] * x + m[4 + axis][index] * y + m[12 + axis][index];
+      allBelow[axis] = allBelow[axis] && clip <= -w;
+      allAbove[axis] = allAbove[axis] && clip >= w;
+    }
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    if (allBelow[axis] || allAbove[axis]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// rectangleInClipVolume for the first count rectangles of the batch, 4 at a time
+inline void rectanglesInClipVolume(const RectangleBatch& batch, size_t count,
+                                   unsigned char* inside) {
+  size_t index = 0;
+  const float* const* m = batch.matrix;
+#if defined(NIMAGNA_SIMD_SSE2)
+  for (; index + 4 <= count; index += 4) {
+    const auto load = [index](const float* values) { return _mm_loadu_ps(values + index); };
+    const __m128 originX = load(batch.rect[0]);
+    const __m128 originY = load(batch.rect[1]);
+    const __m128 extentX = load(batch.rect[2]);
+    const __m128 extentY = load(batch.rect[3]);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 allOnes = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 behind = zero;
+    __m128 allBelow[3] = {allOnes, allOnes, allOnes};
+    __m128 allAbove[3] = {allOnes, allOnes, allOnes};
+    for (int corner = 0; corner < 4; ++corner) {
+      const __m128 x = (corner & 1) ? _mm_add_ps(originX, extentX) : originX;
+      const __m128 y = (corner & 2) ? _mm_add_ps(originY, extentY) : originY;
+      const __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(load(m[3]), x), _mm_mul_ps(load(m[7]), y)),
+                                  load(m[15]));
+      // not greater also catches NaN
+      behind = _mm_or_ps(behind, _mm_cmpngt_ps(w, zero));
+      const __m128 minusW = _mm_sub_ps(zero, w);
+      for (int axis = 0; axis < 3; ++axis) {
+        const __m128 clip = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(load(m[axis]), x), _mm_mul_ps(load(m[4 + axis]), y)),
+            load(m[12 + axis]));
+        allBelow[axis] = _mm_and_ps(allBelow[axis], _mm_cmple_ps(clip, minusW));
+        allAbove[axis] = _mm_and_ps(allAbove[axis], _mm_cmpge_ps(clip, w));
+      }
+    }
+    __m128 outside = zero;
+    for (int axis = 0; axis < 3; ++axis) {
+      outside = _mm_or_ps(outside, _mm_or_ps(allBelow[axis], allAbove[axis]));
+    }
+    const int mask = _mm_movemask_ps(behind) | (~_mm_movemask_ps(outside) & 0xF);
+    for (int lane = 0; lane < 4; ++lane) {
+      inside[index + lane] = (mask >> lane) & 1;
+    }
+  }
+#elif defined(NIMAGNA_SIMD_NEON)
+  for (; index + 4 <= count; index += 4) {
+    const auto load = [index](const float* values) { return vld1q_f32(values + index); };
+    const float32x4_t originX = load(batch.rect[0]);
+    const float32x4_t originY = load(batch.rect[1]);
+    const float32x4_t extentX = load(batch.rect[2]);
+    const float32x4_t extentY = load(batch.rect[3]);
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    uint32x4_t behind = vdupq_n_u32(0);
+    uint32x4_t allBelow[3] = {vdupq_n_u32(0xFFFFFFFF), vdupq_n_u32(0xFFFFFFFF),
+                              vdupq_n_u32(0xFFFFFFFF)};
+    uint32x4_t allAbove[3] = {vdupq_n_u32(0xFFFFFFFF), vdupq_n_u32(0xFFFFFFFF),
+                              vdupq_n_u32(0xFFFFFFFF)};
+    for (int corner = 0; corner < 4; ++corner) {
+      const float32x4_t x = (corner & 1) ? vaddq_f32(originX, extentX) : originX;
+      const float32x4_t y = (corner & 2) ? vaddq_f32(originY, extentY) : originY;
+      const float32x4_t w = vmlaq_f32(vmlaq_f32(load(m[15]), load(m[3]), x), load(m[7]), y);
+      // not greater also catches NaN
+      behind = vorrq_u32(behind, vmvnq_u32(vcgtq_f32(w, zero)));
+      const float32x4_t minusW = vnegq_f32(w);
+      for (int axis = 0; axis < 3; ++axis) {
+        const float32x4_t clip =
+            vmlaq_f32(vmlaq_f32(load(m[12 + axis]), load(m[axis]), x), load(m[4 + axis]), y);
+        allBelow[axis] = vandq_u32(allBelow[axis], vcleq_f32(clip, minusW));
+        allAbove[axis] = vandq_u32(allAbove[axis], vcgeq_f32(clip, w));
+      }
+    }
+    uint32x4_t outside = vdupq_n_u32(0);
+    for (int axis = 0; axis < 3; ++axis) {
+      outside = vorrq_u32(outside, vorrq_u32(allBelow[axis], allAbove[axis]));
+    }
+    const uint32x4_t overlaps = vorrq_u32(behind, vmvnq_u32(outside));
+    inside[index + 0] = vgetq_lane_u32(overlaps, 0) != 0;
+    inside[index + 1] = vgetq_lane_u32(overlaps, 1) != 0;
+    inside[index + 2] = vgetq_lane_u32(overlaps, 2) != 0;
+    inside[index + 3] = vgetq_lane_u32(overlaps, 3) != 0;
+  }
+#endif
+  // the remainder (or everything without SIMD support)
+  for (; index < count; ++index) {
+    inside[index] = rectangleInClipVolume(batch, index);
+  }
+}
+
+// out = a * b for column-major 4x4 matrices (like QMatrix4x4::constData). out must not alias.
+inline void multiplyMatrices4x4(const float* a, const float* b, float* out) {
+#if defined(NIMAGNA_SIMD_SSE2)
+  const __m128 column0 = _mm_loadu_ps(a);
+  const __m128 column1 = _mm_loadu_ps(a + 4);
+  const __m128 column2 = _mm_loadu_ps(a + 8);
+  const __m128 column3 = _mm_loadu_ps(a + 12);
+  // each column of the product is a linear combination of a's columns
+  for (int column = 0; column < 4; ++column) {
+    const float* factors = b + 4 * column;
+    const __m128 product = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(factors[0])),
+                   _mm_mul_ps(column1, _mm_set1_ps(factors[1]))),
+        _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(factors[2])),
+                   _mm_mul_ps(column3, _mm_set1_ps(factors[3]))));
+    _mm_storeu_ps(out + 4 * column, product);
+  }
+#elif defined(NIMAGNA_SIMD_NEON)
+  const float32x4_t column0 = vld1q_f32(a);
+  const float32x4_t column1 = vld1q_f32(a + 4);
+  const float32x4_t column2 = vld1q_f32(a + 8);
+  const float32x4_t column3 = vld1q_f32(a + 12);
+  for (int column = 0; column < 4; ++column) {
+    const float32x4_t factors = vld1q_f32(b + 4 * column);
+    float32x4_t product = vmulq_laneq_f32(column0, factors, 0);
+    product = vfmaq_laneq_f32(product, column1, factors, 1);
+    product = vfmaq_laneq_f32(product, column2, factors, 2);
+    product = vfmaq_laneq_f32(product, column3, factors, 3);
+    vst1q_f32(out + 4 * column, product);
+  }
+#else
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      float sum = 0.f;
+      for (int k = 0; k < 4; ++k) {
+        sum += a[4 * k + row] * b[4 * column + k];
+      }
+      out[4 * column + row] = sum;
+    }
+  }
+#endif
+}
+
+}  // namespace nimagna::simd
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QVector3D>
+#include <vector>
+
+#include "Rendering/RenderObject.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// A dynamic bounding volume hierarchy over the world space bounds of render objects for frustum,
+// point, rectangle, and ray queries
+//
+// Each object is a leaf with an enlarged ("fat") box, such that small movements do not change the
+// tree; the leaves' exact boxes decide the query results. Leaves are inserted next to the sibling
+// that enlarges the tree the least, and the tree is kept balanced with rotations (like Box2D's
+// dynamic tree). Point and rectangle queries are in the world's xy plane.
+class RENDERING_API SpatialIndex {
+ public:
+  using ProxyId = int;
+  static constexpr ProxyId kNoProxy = -1;
+
+  // an axis aligned box in world space
+  struct Box {
+    QVector3D minimum;
+    QVector3D maximum;
+
+    bool contains(const Box& other) const;
+    bool overlaps(const Box& other) const;
+    Box united(const Box& other) const;
+    // the sum of the extents, the insertion cost (unlike the area, positive for flat boxes)
+    float extentSum() const;
+  };
+  // the world space box of the object's bounds (see RenderObject::localBounds), false if it has
+  // none
+  static bool worldBox(const RenderObject& renderObject, Box* box);
+
+  SpatialIndex() = default;
+  // not copyable or movable
+  SpatialIndex(const SpatialIndex& other) = delete;
+  SpatialIndex& operator=(const SpatialIndex& other) = delete;
+  SpatialIndex(SpatialIndex&&) = delete;
+  SpatialIndex& operator=(SpatialIndex&&) = delete;
+
+  ProxyId insert(const Box& box, RenderObject* renderObject);
+  void remove(ProxyId proxy);
+  // updates the box of the proxy, true if it left its fat box and was reinserted
+  bool move(ProxyId proxy, const Box& box);
+  void clear();
+  RenderObject* renderObject(ProxyId proxy) const { return mNodes[proxy].renderObject; }
+  int proxyCount() const { return mProxyCount; }
+  int height() const { return mRoot == kNoNode ? 0 : mNodes[mRoot].height; }
+
+  // the proxies overlapping the view frustum of the view/projection matrix
+  void queryFrustum(const QMatrix4x4& viewProjection, std::vector<ProxyId>* proxies) const;
+  // the proxies containing the point
+  void queryPoint(const QPointF& point, std::vector<ProxyId>* proxies) const;
+  // the proxies overlapping the rectangle
+  void queryRect(const QRectF& rect, std::vector<ProxyId>* proxies) const;
+  // the proxies the line segment passes through, e.g. a pick ray from the near to the far plane
+  void querySegment(const QVector3D& start, const QVector3D& end,
+                    std::vector<ProxyId>* proxies) const;
+
+ private:
+  static constexpr int kNoNode = -1;
+  struct Node {
+    // the union of the children, fat box for leaves
+    Box box;
+    // exact box of leaves
+    Box bounds;
+    int parent = kNoNode;
+    int child1 = kNoNode;
+    int child2 = kNoNode;
+    // leaves are 0, -1 for free nodes
+    int height = 0;
+    RenderObject* renderObject = nullptr;
+
+    bool isLeaf() const { return child1 == kNoNode; }
+  };
+
+  // the leaves whose exact boxes the predicate accepts, descending into the nodes it accepts
+  template <typename Predicate>
+  void query(const Predicate& overlaps, std::vector<ProxyId>* proxies) const;
+
+  static Box fatBox(const Box& box);
+  int allocateNode();
+  void freeNode(int node);
+  void insertLeaf(int leaf);
+  void removeLeaf(int leaf);
+  // rotates the subtree if unbalanced, returns its new root
+  int balance(int node);
+  // refits boxes and heights from the node up to the root
+  void refit(int node);
+
+  std::vector<Node> mNodes;
+  int mRoot = kNoNode;
+  int mFreeNode = kNoNode;
+  int mProxyCount = 0;
+};
+
+}  // namespace nimagna
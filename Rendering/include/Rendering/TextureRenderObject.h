@@ -5,13 +5,18 @@
 #include <QtGui/QOffscreenSurface>
 #include <QtGui/QOpenGLContext>
 #include <QtOpenGL/QOpenGLBuffer>
+#include <QtOpenGL/QOpenGLFramebufferObject>
 #include <QtOpenGL/QOpenGLFunctions_4_0_Core>
 #include <QtOpenGL/QOpenGLShaderProgram>
 #include <QtOpenGL/QOpenGLTexture>
-#include <QtOpenGL/QOpenGLVertexArrayObject>
 #include <vector>
 
+#include "MaskBlur.h"
+#include "RenderBatcher.h"
 #include "RenderObject.h"
+#include "ShaderProgramCache.h"
+#include "TripleBuffer.h"
+#include "UniformBufferRing.h"
 
 namespace nimagna {
 
@@ -41,22 +46,51 @@ class RENDERING_API TextureRenderObject : public RenderObject, protected QOpenGL
   // initializes the render object.
   virtual void initialize() override;
 
-  // draws the render object.
+  // takes the latest published state for the frame
+  virtual void prepare(const QMatrix4x4& vp, qint64 renderTimestampUs) override;
+  // advances the source and uploads its content due in the frame (see updateTexture), then takes
+  // the state again
+  virtual void updateContent(bool isVisible) override;
+  // blurs the mask if enabled and changed since it was last blurred (see setMaskBlur)
+  virtual void addPasses(RenderGraph& renderGraph,
+                         std::vector<RenderGraph::TargetId>* inputs) override;
+  // draws the render object immediately.
   virtual void draw() override;
+  // adds the render object to the batch of compatible objects
+  virtual void submit(RenderBatcher& batcher) override;
 
   // get the source's texture and mask size
   bool isEmpty() const;
   // normally, the TextureRenderObject renders its own texture. If this flag is set, the TRO assumes
   // an external texture is bound during rendering and does not bind its own texture(s).
   virtual void useExternalTexture(bool useExternal);
-  // checks if the render object is visible on the screen
-  bool isVisible() const;
+  // the position rectangle
+  virtual bool localBounds(float (&rect)[4]) const override;
+  // an own texture with source alpha 1 (see setSourceAlphaOpaque) without mask drawn with alpha 1
+  virtual bool isOpaque() const override;
+  // from a low resolution copy of the mask or the texture's alpha channel, 1 for RGB textures
+  // without mask and for content written directly by beginTextureUpload
+  virtual float alphaAt(const QPointF& boundsPosition) const override;
 
   // the texture's source size
   const QSize& textureSourceSize() const;
   const QSize& maskSourceSize() const;
   // the source's format (RGB, RGBA, BGRA) and type (static, streaming)
   SourcePixelFormat sourcePixelFormat() const;
+  // declares that the source's alpha is 1 everywhere although the pixel format has an alpha
+  // channel, e.g. for RGB32 images uploaded as BGRA. Always true for RGB sources, reset when the
+  // source pixel format changes and set by setTextureData(const QImage&).
+  void setSourceAlphaOpaque(bool opaque);
+  bool isSourceAlphaOpaque() const;
+  // checks if images of the format have alpha 1 everywhere (e.g. RGB32, RGBX8888, RGB888)
+  static bool hasOpaqueAlpha(QImage::Format format);
+  // the size of the low resolution alpha copy of a source for picking (see alphaAt): at most
+  // kPickingAlphaSize wide and high
+  static constexpr int kPickingAlphaSize = 64;
+  static QSize pickingAlphaSize(const QSize& sourceSize);
+  // sets the alpha copy from an image of the source, e.g. a scaled decode of what was written to
+  // the upload buffer (see beginTextureUpload)
+  void setPickingAlpha(const QImage& image);
   // the texture's and mask's real size
   const QSize& textureSize() const;
   const QSize& maskSize() const;
@@ -64,20 +98,29 @@ class RENDERING_API TextureRenderObject : public RenderObject, protected QOpenGL
   // get the texture target
   const TextureTarget target() const { return mTextureTarget; }
 
-  // the texture units for color and separate mask textures
+  // the first texture units for color and separate mask textures, a batch binds its texture slots
+  // to the consecutive units (see RenderBatcher)
   static const GLint colorTextureUnit() { return mColorTextureUnit; }
   static const GLint maskTextureUnit() { return mMaskTextureUnit; }
+  // associates the sampler arrays of a texture shader program with the texture slots' units
+  static void setTextureUnits(QOpenGLShaderProgram& program, TextureTarget target,
+                              bool separateMaskEnabled);
   // static helpers to translate target and pixel format to OpenGL and Qt constants
   static QOpenGLTexture::Target qGlTarget(TextureTarget target);
   static GLint glTarget(TextureTarget target);
   static QOpenGLTexture::PixelFormat qGlSourceFormat(SourcePixelFormat format);
   static GLint glSourceFormat(SourcePixelFormat format);
+  static QImage::Format qImageFormatFromSourcePixelFormat(SourcePixelFormat format);
+
+  // all shader program variants, e.g. to warm up the shader program cache
+  static std::vector<ShaderProgramCache::Key> shaderProgramKeys();
 
   bool hasSeparateMask() const;
   void enableSeparateMask(bool separateMaskEnabled, bool blurEnabled);
+  // the blur of the separate mask (if enabled). The blurred mask is kept until the mask data or
+  // the blur changes.
+  void setMaskBlur(const MaskBlur::Parameters& parameters);
 
-  // uploads the VertexData to GPU. Must be called after changing mVBD data
-  void uploadVertexData();
   // change the texture size and format
   virtual void changeTextureSizeAndFormat(QSize size, SourcePixelFormat pixelFormat);
   // change the mask size
@@ -89,32 +132,95 @@ class RENDERING_API TextureRenderObject : public RenderObject, protected QOpenGL
   void setFlipHorizontally(bool flipHorizontally);
   // update the texture data
   void setTextureData(const QImage& image);
+  // update the texture data from raw pixels in the current source pixel format using the streaming
+  // upload path: the pixels are copied once into the pixel unpack buffer, from which the driver
+  // transfers them to the texture (instead of copying them into its own memory first). Rows may
+  // be padded to bytesPerLine.
+  void setTextureData(const uchar* data, int bytesPerLine);
+  // map the streaming upload buffer to write the texture's pixels (source size and pixel format)
+  // directly, e.g. by a decoder. Rows are 4 byte aligned and bytesPerLine apart. Returns nullptr on
+  // failure. Every successful call must be followed by endTextureUpload, the memory is invalid
+  // afterwards. The memory is write only, the writer sets the alpha copy (see setPickingAlpha).
+  uchar* beginTextureUpload(int* bytesPerLine);
+  // unmap the streaming upload buffer and transfer its content to the texture
+  void endTextureUpload();
+  // update a region of the texture, e.g. a decoded tile. The image must have the layout of the
+  // current source pixel format but may be a view into a larger image.
+  void setTextureRegionData(const QImage& image, const QPoint& offset);
   // update the mask texture data
   void setMaskTextureData(const QImage& image);
-  // set the position of a particular vertex. does not upload the data to the GPU -> call
-  // uploadVertexData after changing the vertex data
-  void setVertexPosition(int vertexId, int index, float value);
 
  protected:
+  // advances the source to the current render clock and uploads its content due if upload is set,
+  // i.e. the object is drawn in the frame
+  virtual void updateTexture(bool upload) {}
+
   // the vertex shader code
   static const inline QString mVertexShaderFile = ":/resources/shaders/texture.vert";
   // the fragment shader code
   static const inline std::map<TextureTarget, QString> mFragmentShaderFile = {
       {TextureTarget::Target2D, ":/resources/shaders/texture_2d.frag"},
       {TextureTarget::TargetRectangle, ":/resources/shaders/texture_rectangle.frag"}};
-  // the shaders
-  std::unique_ptr<QOpenGLShaderProgram> mShaderProgram;
+  // the shader program shared with all texture render objects of the same variant
+  std::shared_ptr<QOpenGLShaderProgram> mShaderProgram;
+  ShaderProgramCache::Key mShaderProgramKey;
 
 
  private:
-  // initialize the shader program
-  void setupShaderProgram();
+  // everything the render thread needs to draw the object, published as a whole whenever it
+  // changes such that drawing never waits for a thread changing textures or sizes
+  struct DrawState {
+    // 0 if there is nothing to draw
+    GLuint texture = 0;
+    GLuint maskTexture = 0;
+    SourcePixelFormat sourcePixelFormat = SourcePixelFormat::RGB;
+    // the source's alpha is 1 everywhere
+    bool sourceAlphaOpaque = true;
+    bool separateMaskEnabled = false;
+    bool useExternalTexture = false;
+    // the mask's texture size and whether and how it is blurred
+    QSize maskSize;
+    bool maskBlurEnabled = false;
+    MaskBlur::Parameters maskBlur;
+    // changed with the mask data and the blur, the blurred mask is outdated if it differs
+    quint64 maskVersion = 0;
+    // the rectangles (the model matrix and alpha are set per draw)
+    UniformBufferRing::ObjectUniforms uniforms{};
+  };
+  // publishes the current state to the render thread. The access mutex must be locked.
+  void publishDrawState();
+
+  // switches to the program variant of the mask and pixel format (if changed)
+  bool selectShaderProgramVariant(bool separateMaskEnabled, bool blurredMask, bool swapRGB);
+  // the program, textures, and uniforms to draw the object with, false if there is nothing to draw
+  bool batchItem(RenderBatcher::Item* item);
+  static ShaderProgramCache::Key shaderProgramKey(TextureTarget target, bool separateMaskEnabled,
+                                                  bool blurredMask, bool swapRGB);
   // updates the texture coordinates if size has changed or flip flag has changed
   void updateTextureCoordinates();
   // updates the mask's texture coordinates if size has changed or flip flag has changed
   void updateMaskTextureCoordinates();
+  // sets the origin and extent of texture coordinates in [0,width]x[0,height] respecting the flips
+  void updateTextureRect(float (&textureRect)[4], float width, float height) const;
 
+  // samples the alpha of the source pixels in the region into the alpha copy. The data starts at
+  // the region's top left pixel, the alpha is the byte at alphaOffset of each pixel.
+  void updatePickingAlpha(const uchar* data, int bytesPerLine, const QRect& region,
+                          const QSize& sourceSize, int pixelBytes, int alphaOffset);
+  // updates the alpha copy from texture data unless the mask provides the alpha. The access mutex
+  // must be locked.
+  void updatePickingAlphaFromTexture(const uchar* data, int bytesPerLine, const QRect& region);
+
+  // serializes the threads changing the textures and the state, never locked by drawing
   QMutex mAccessMutex;
+  // the state last published and taken by the render thread (see prepare)
+  TripleBuffer<DrawState> mDrawState;
+  // the textures replaced while the render thread may still draw a state naming them, deleted by
+  // the next prepare once the frame drawing them is submitted
+  QMutex mRetiredTexturesMutex;
+  std::vector<std::unique_ptr<QOpenGLTexture>> mRetiredTextures;
+  // keeps the texture until the render thread is done with it. The access mutex must be locked.
+  void retireTexture(std::unique_ptr<QOpenGLTexture> texture);
 
   // helpers related to the texture target
   const QOpenGLTexture::Target qGlTarget() const;
@@ -122,32 +228,26 @@ class RENDERING_API TextureRenderObject : public RenderObject, protected QOpenGL
   // helpers related to the pixel format
   const QOpenGLTexture::PixelFormat qGlSourceFormat() const;
   const GLint glSourceFormat() const;
-  static QImage::Format qImageFormatFromSourcePixelFormat(SourcePixelFormat format);
+  static int bytesPerPixel(SourcePixelFormat format);
   static const std::map<SourcePixelFormat, QImage::Format>
       kSourcePixelFormatToQImageFormatMap;
 
   // The texture's type (2D or Rect)
   const TextureTarget mTextureTarget;
-  // the Vertex Array Object holds all vertex relevant data
-  QOpenGLVertexArrayObject mVAO;
-  // the vertex buffer object
-  QOpenGLBuffer mVBO;
-  // the index buffer with the vertex indices for each triangle
-  QOpenGLBuffer mIBO;
-  // struct holding the data per vertex
-  struct vertexData {
-    float position[3];
-    float texture[2];
-    float maskTexture[2];
-  };
-  // the vertex buffer data that is uploaded to the vertex buffer object
-  std::vector<vertexData> mVBD;
+  // the rectangles the shared unit quad is mapped to, published with the draw state
+  UniformBufferRing::ObjectUniforms mObjectUniforms{
+      {}, {-1.f, -1.f, 2.f, 2.f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 0.f, 1.f, 1.f}, 1.f};
 
   // the source format can be RGB, RGBA, or BGRA
   SourcePixelFormat mSourcePixelFormat = SourcePixelFormat::RGB;
+  // the source's alpha is 1 everywhere (see setSourceAlphaOpaque)
+  bool mSourceAlphaOpaque = true;
 
   // the texture for static sources
   std::unique_ptr<QOpenGLTexture> mTexture;
+  // the pixel unpack buffer for streaming sources. It gets orphaned on every upload such that the
+  // driver never has to wait for a previous transfer to finish.
+  QOpenGLBuffer mStreamingBuffer;
   // the separate texture for the mask
   bool mSeparateMaskTextureEnabled = false;
   std::unique_ptr<QOpenGLTexture> mMaskTexture;
@@ -167,14 +267,26 @@ class RENDERING_API TextureRenderObject : public RenderObject, protected QOpenGL
   bool mFlipVertically = false;
   // render output horizontally flipped
   bool mFlipHorizontally = false;
-  // the transformation matrix location in the shader
-  int mWorldTransformationShaderPosition = -1;
-  // flag to enable or disable the blurring in the keyed_texture shader
+
+  // the low resolution alpha copy (Alpha8, null for opaque) and the flips it is sampled with. The
+  // mutex is held for single updates and lookups only.
+  mutable QMutex mPickingAlphaMutex;
+  QImage mPickingAlpha;
+  bool mPickingFlipVertically = false;
+  bool mPickingFlipHorizontally = false;
+  // flag to enable or disable the blurring of the separate mask
   bool mCameraMaskBlurring = false;
+  static constexpr int kDefaultMaskBlurRadius = 3;
+  static constexpr int kMaxMaskBlurRadius = 32;
+  MaskBlur::Parameters mMaskBlur{kDefaultMaskBlurRadius, 0.f};
+  quint64 mMaskVersion = 0;
+  // the blurred mask and the mask version it was blurred from (render thread)
+  std::unique_ptr<QOpenGLFramebufferObject> mBlurredMask;
+  quint64 mBlurredMaskVersion = 0;
 
   // texture units for color and mask texture
   static inline const GLint mColorTextureUnit = 2;
-  static inline const GLint mMaskTextureUnit = 3;
+  static inline const GLint mMaskTextureUnit = mColorTextureUnit + RenderBatcher::kTextureSlotCount;
 
   // As a performance optimization, texture sizes as multiples of four are considered to have better
   // performance. And on really old hardware, textures had to have a power of two size. It is
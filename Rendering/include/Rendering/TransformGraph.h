@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QQuaternion>
+#include <QtGui/QVector3D>
+#include <vector>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The hierarchy of transforms of the render objects and the groups they are arranged in
+//
+// Each node has a local transform relative to its parent, its world matrix is the product of the
+// local matrices from the root down. Changing a node marks it dirty, update() recomputes the world
+// matrices of the dirty subtrees only. The nodes are kept in depth first order, such that every
+// subtree is a contiguous range and its matrices are multiplied in one pass over contiguous
+// storage, parents before children.
+// Changing the hierarchy (adding, removing, or reparenting nodes) rebuilds the order on the next
+// update.
+class RENDERING_API TransformGraph {
+ public:
+  using NodeId = int;
+  static constexpr NodeId kNoNode = -1;
+
+  // the local transform: scaled and rotated around the pivot, then translated
+  struct Transform {
+    QVector3D translation;
+    QQuaternion rotation;
+    QVector3D scale{1.f, 1.f, 1.f};
+    QVector3D pivot;
+
+    QMatrix4x4 matrix() const;
+  };
+
+  // adds a node with the identity transform
+  NodeId addNode(NodeId parent = kNoNode);
+  // removes the node, its children move to its parent
+  void removeNode(NodeId node);
+  // moves the node with its subtree to a new parent (kNoNode for the root)
+  void setParent(NodeId node, NodeId parent);
+  NodeId parent(NodeId node) const;
+
+  void setTransform(NodeId node, const Transform& transform);
+  const Transform& transform(NodeId node) const;
+
+  // recomputes the world matrices of the dirty subtrees, returns the nodes whose world matrix
+  // changed (valid until the next update)
+  const std::vector<NodeId>& update();
+  // the world matrix as of the last update
+  QMatrix4x4 worldMatrix(NodeId node) const;
+  int nodeCount() const { return static_cast<int>(mOrder.size()); }
+
+ private:
+  struct alignas(16) Matrix {
+    float m[16];
+  };
+
+  bool isValid(NodeId node) const;
+  // sorts the nodes in depth first order
+  void rebuildOrder();
+  // multiplies the world matrices of the depth first positions [begin, end)
+  void updateWorldMatrices(int begin, int end);
+
+  // by node id
+  std::vector<Transform> mTransforms;
+  std::vector<NodeId> mParents;
+  std::vector<std::vector<NodeId>> mChildren;
+  std::vector<bool> mIsAlive;
+  std::vector<NodeId> mFreeNodes;
+  // the depth first position of each node
+  std::vector<int> mPositions;
+
+  // by depth first position: the node, the position of its parent (-1 for the root), the end of
+  // its subtree, and its local and world matrices
+  std::vector<NodeId> mOrder;
+  std::vector<int> mParentPositions;
+  std::vector<int> mSubtreeEnds;
+  std::vector<Matrix> mLocalMatrices;
+  std::vector<Matrix> mWorldMatrices;
+
+  bool mIsOrderDirty = false;
+  std::vector<NodeId> mDirtyNodes;
+  std::vector<NodeId> mChangedNodes;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace nimagna {
+
+// Hands complete snapshots of a value from one writer to one reader without locks
+//
+// The writer fills its own slot and publishes it by exchanging it with the middle slot, the reader
+// takes the middle slot in exchange for its own if a newer snapshot was published. Neither side
+// ever waits for the other or sees a slot the other side is writing. With only two slots, a writer
+// publishing twice during one read would overwrite the slot being read.
+// Multiple writers must be serialized by the caller.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+  explicit TripleBuffer(const T& value) : mSlots{value, value, value} {}
+  // not copyable or movable
+  TripleBuffer(const TripleBuffer& other) = delete;
+  TripleBuffer& operator=(const TripleBuffer& other) = delete;
+  TripleBuffer(TripleBuffer&&) = delete;
+  TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+  // writer: publishes the value as the latest snapshot
+  void publish(const T& value) {
+    mSlots[mWriteIndex] = value;
+    // release: the slot's content is visible to the reader taking it
+    mWriteIndex = mMiddle.exchange(mWriteIndex | kFreshFlag, std::memory_order_acq_rel) & kIndex;
+  }
+
+  // reader: switches to the latest snapshot if one was published since, true if so
+  bool acquire() {
+    if ((mMiddle.load(std::memory_order_relaxed) & kFreshFlag) == 0) {
+      return false;
+    }
+    // acquire: the writer's content of the slot is visible
+    mReadIndex = mMiddle.exchange(mReadIndex, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+  // reader: the snapshot taken by the last acquire
+  const T& read() const { return mSlots[mReadIndex]; }
+
+ private:
+  static constexpr int kIndex = 0x3;
+  static constexpr int kFreshFlag = 0x4;
+
+  std::array<T, 3> mSlots{};
+  // the writer's slot, the middle slot (with the flag set if not taken by the reader yet), and
+  // the reader's slot
+  int mWriteIndex = 0;
+  std::atomic<int> mMiddle{1};
+  int mReadIndex = 2;
+};
+
+}  // namespace nimagna
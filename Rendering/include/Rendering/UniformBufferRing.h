@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <QtOpenGL/QOpenGLShaderProgram>
+#include <array>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The uniform data of all render objects of an OpenGL context, written to a ring of uniform buffer
+// segments, one per frame in flight
+//
+// Each frame writes the frame uniforms (shared by all objects) to the start of its segment and
+// appends the object uniforms of each (instanced) draw as an array indexed by the instance. A draw
+// binds its array with glBindBufferRange instead of setting uniforms one by one. A segment is
+// reused only after the GPU finished the frame that used it (fence), such that writing never waits
+// for the GPU or makes the driver copy.
+// With GL_ARB_buffer_storage, the buffer is persistently mapped and written with memcpy.
+class RENDERING_API UniformBufferRing {
+ public:
+  // std140 layout of the shaders' FrameUniforms block
+  struct FrameUniforms {
+    float viewProjection[16];
+    // non-zero to replace the depth of the objects by their draw depth (see ObjectUniforms)
+    int useDrawDepth;
+    int padding[3];
+  };
+  // std140 layout of an element of the shaders' ObjectUniforms block (one per instance). The
+  // rectangles are origin and extent (x, y, width, height) the unit quad is mapped to, negative
+  // extents flip. The draw depth in [-1,1] is the object's depth derived from the draw order,
+  // smaller is in front. The texture slot selects the instance's textures (see RenderBatcher).
+  struct ObjectUniforms {
+    float model[16];
+    float positionRect[4];
+    float textureRect[4];
+    float maskTextureRect[4];
+    float alphaTransparency;
+    float drawDepth;
+    int textureSlot;
+    float padding;
+  };
+  // the uniform buffer binding points of the blocks
+  static constexpr GLuint kFrameBlockBinding = 0;
+  static constexpr GLuint kObjectBlockBinding = 1;
+  // the array size of the ObjectUniforms block (16 KiB, the minimum block size OpenGL guarantees),
+  // must match the shader
+  static constexpr int kMaxInstanceCount = 128;
+
+  // the ring of the current context, created on first use
+  static UniformBufferRing& forCurrentContext();
+  // releases the ring of the context. Must be current.
+  static void release(QOpenGLContext* context);
+  // assigns the program's uniform blocks to their binding points. Once per program.
+  static void bindBlocks(QOpenGLShaderProgram& program);
+
+  UniformBufferRing();
+  // not copyable or movable
+  UniformBufferRing(const UniformBufferRing& other) = delete;
+  UniformBufferRing& operator=(const UniformBufferRing& other) = delete;
+  UniformBufferRing(UniformBufferRing&&) = delete;
+  UniformBufferRing& operator=(UniformBufferRing&&) = delete;
+  ~UniformBufferRing();
+
+  // starts a frame: waits until the GPU finished reading the segment and binds the frame uniforms
+  void beginFrame(const QMatrix4x4& viewProjection, bool useDrawDepth = false);
+  // writes the uniforms of up to kMaxInstanceCount instances to the frame's segment and binds them
+  // for the next draw
+  bool bindObjectUniforms(const ObjectUniforms* uniforms, int count);
+  // fences the frame's segment and advances to the next one
+  void endFrame();
+
+ private:
+  // (re)creates the buffer with room for the given number of object uniforms per frame
+  void allocate(int objectCapacity);
+  void destroyBuffer();
+  void write(GLintptr offset, const void* data, GLsizeiptr size);
+  void writeFrameUniforms();
+  GLintptr segmentOffset() const { return static_cast<GLintptr>(mSegment) * mSegmentSize; }
+
+  static constexpr int kFramesInFlight = 3;
+  static constexpr int kInitialObjectCapacity = 256;
+  // the size of the bound object uniforms range: the whole block, even for fewer instances
+  static constexpr GLsizeiptr kObjectBlockSize = kMaxInstanceCount * sizeof(ObjectUniforms);
+
+  QOpenGLExtraFunctions* mFunctions = nullptr;
+  GLuint mBuffer = 0;
+  // the persistently mapped buffer, nullptr if written with glBufferSubData
+  uchar* mMappedData = nullptr;
+  bool mIsPersistentMappingSupported = false;
+  // the uniform buffer offset alignment of the bound ranges
+  GLint mAlignment = 256;
+  GLsizeiptr mFrameSlotSize = 0;
+  int mObjectCapacity = 0;
+  GLsizeiptr mSegmentSize = 0;
+  // the current segment and the write offset in it
+  int mSegment = 0;
+  GLsizeiptr mWriteOffset = 0;
+  std::array<GLsync, kFramesInFlight> mFences{};
+  bool mIsInFrame = false;
+  FrameUniforms mFrameUniforms{};
+};
+
+}  // namespace nimagna
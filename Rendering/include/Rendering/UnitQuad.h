@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QtGui/QOpenGLContext>
+#include <QtOpenGL/QOpenGLBuffer>
+#include <QtOpenGL/QOpenGLVertexArrayObject>
+
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// The unit rectangle [0,1]x[0,1] drawn by all textured rectangles of an OpenGL context
+//
+// The vertex shader maps the unit corners to the object's position and texture coordinate
+// rectangles (see UniformBufferRing::ObjectUniforms), such that render objects own no geometry.
+class RENDERING_API UnitQuad {
+ public:
+  // layout location of the vec2 unit corner attribute
+  static constexpr GLuint kUnitPositionLocation = 0;
+
+  // the quad of the current context, created on first use
+  static UnitQuad& forCurrentContext();
+  // releases the quad of the context. Must be current.
+  static void release(QOpenGLContext* context);
+
+  UnitQuad();
+  // not copyable or movable
+  UnitQuad(const UnitQuad& other) = delete;
+  UnitQuad& operator=(const UnitQuad& other) = delete;
+  UnitQuad(UnitQuad&&) = delete;
+  UnitQuad& operator=(UnitQuad&&) = delete;
+  ~UnitQuad();
+
+  // binds the vertex array, draws the two triangles (strip) per instance, and releases it
+  void draw(int instanceCount = 1);
+
+ private:
+  QOpenGLVertexArrayObject mVAO;
+  QOpenGLBuffer mVBO;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QtGui/QMatrix4x4>
+#include <array>
+#include <vector>
+
+#include "Rendering/RenderQueue.h"
+#include "Rendering/Rendering.h"
+
+namespace nimagna {
+
+// Decides before drawing which render objects of a frame are drawn at all
+//
+// Objects are culled if updates are not allowed, if they are fully transparent, or if their
+// bounds lie outside of the clip volume (the same test as TextureRenderObject::isVisible). The
+// bounds are gathered in structure of arrays layout and tested 4 at a time with SIMD. Objects
+// without bounds are never culled for being off-screen.
+class RENDERING_API VisibilityCuller {
+ public:
+  // the culling result of the last frame
+  struct Statistics {
+    int drawnCount = 0;
+    int culledCount = 0;
+  };
+
+  // sets the visibility of each entry (in the same order)
+  void cull(const std::vector<RenderQueue::Entry>& entries, const QMatrix4x4& viewProjection,
+            std::vector<unsigned char>* visible);
+  const Statistics& lastFrameStatistics() const { return mLastFrameStatistics; }
+
+ private:
+  // the model/view/projection matrices and the rectangles of the objects with bounds
+  std::array<std::vector<float>, 16> mMatrices;
+  std::array<std::vector<float>, 4> mRects;
+  // the entry index of each object with bounds and whether it is inside the clip volume
+  std::vector<size_t> mBoundedEntries;
+  std::vector<unsigned char> mInside;
+  Statistics mLastFrameStatistics;
+};
+
+}  // namespace nimagna
@@ -0,0 +1,83 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/DamageTracker.h"
+
+#include <QtGui/QRegion>
+
+#include "Rendering/OcclusionCuller.h"
+
+namespace nimagna {
+
+const std::vector<QRect>& DamageTracker::update(const std::vector<RenderQueue::Entry>& entries,
+                                                const std::vector<unsigned char>& visible,
+                                                const QMatrix4x4& viewProjection,
+                                                const QSize& viewportSize) {
+  mLastFrameStatistics = {};
+  const QRect viewport(QPoint(0, 0), viewportSize);
+  const bool everythingDamaged =
+      mIsInvalid || viewProjection != mViewProjection || viewportSize != mViewportSize;
+  mIsInvalid = false;
+  mViewProjection = viewProjection;
+  mViewportSize = viewportSize;
+  ++mFrame;
+
+  QRegion damage;
+  mScreenRects.resize(entries.size());
+  for (size_t index = 0; index < entries.size(); ++index) {
+    const auto& renderObject = *entries[index].renderObject;
+    // empty if not drawn
+    QRect screenRect;
+    QRect inner;
+    if (visible[index]) {
+      if (OcclusionCuller::screenRects(renderObject, viewProjection, viewportSize, &screenRect,
+                                       &inner)) {
+        screenRect = screenRect.adjusted(-kMargin, -kMargin, kMargin, kMargin) & viewport;
+      } else {
+        // no bounds: it may draw anywhere
+        screenRect = viewport;
+      }
+    }
+    mScreenRects[index] = screenRect;
+
+    auto [iter, isNew] = mObjectStates.try_emplace(entries[index].key.sequence);
+    ObjectState& state = iter->second;
+    const uint64_t contentVersion = renderObject.frameContentVersion();
+    if (isNew || state.screenRect != screenRect || state.position != index ||
+        state.contentVersion != contentVersion) {
+      damage += state.screenRect;
+      damage += screenRect;
+      ++mLastFrameStatistics.damagedObjectCount;
+    }
+    state = {screenRect, index, contentVersion, mFrame};
+  }
+  // the objects removed since the last frame
+  for (auto iter = mObjectStates.begin(); iter != mObjectStates.end();) {
+    if (iter->second.frame != mFrame) {
+      damage += iter->second.screenRect;
+      iter = mObjectStates.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  mDamageRects.clear();
+  if (everythingDamaged) {
+    mDamageRects.push_back(viewport);
+  } else if (damage.rectCount() > kMaxDamageRectCount) {
+    mDamageRects.push_back(damage.boundingRect() & viewport);
+  } else {
+    for (const QRect& rect : damage) {
+      mDamageRects.push_back(rect & viewport);
+    }
+  }
+  if (!viewport.isEmpty()) {
+    double area = 0.0;
+    for (const QRect& rect : mDamageRects) {
+      area += double(rect.width()) * rect.height();
+    }
+    mLastFrameStatistics.damagedArea = area / (double(viewport.width()) * viewport.height());
+  }
+  return mDamageRects;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,155 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/FrameSourceRenderObject.h"
+
+#include <QtCore/QMutexLocker>
+
+namespace nimagna {
+
+FrameSourceRenderObject::FrameSourceRenderObject(TextureTarget type, const QUrl& source)
+    : TextureRenderObject(type) {
+  enableSeparateMask(false, false);
+  initialize();
+
+  mVideoSink = std::make_unique<QVideoSink>();
+  mMediaPlayer = std::make_unique<QMediaPlayer>();
+  mMediaPlayer->setVideoOutput(mVideoSink.get());
+  mMediaPlayer->setLoops(QMediaPlayer::Infinite);
+  // the connection is explicitly direct: frames are queued on the backend's thread without a
+  // detour through the render thread's event loop
+  connect(mVideoSink.get(), &QVideoSink::videoFrameChanged, this,
+          &FrameSourceRenderObject::onVideoFrameChanged, Qt::DirectConnection);
+  connect(mMediaPlayer.get(), &QMediaPlayer::errorOccurred, this,
+          [this](QMediaPlayer::Error, const QString& errorString) {
+            SPDLOG_ERROR("Video playback error on {}: {}", getDisplayName(), errorString);
+          });
+  mMediaPlayer->setSource(source);
+}
+
+FrameSourceRenderObject::~FrameSourceRenderObject() {
+  // stop the backend before the jitter buffer is destroyed
+  disconnect(mVideoSink.get(), nullptr, this, nullptr);
+  mMediaPlayer->stop();
+  mMediaPlayer.reset();
+  mVideoSink.reset();
+  QMutexLocker locker(&mFrameQueueMutex);
+  mFrameQueue.clear();
+}
+
+void FrameSourceRenderObject::play() {
+  SPDLOG_DEBUG("Play video {}", getDisplayName());
+  mMediaPlayer->play();
+}
+
+void FrameSourceRenderObject::stop() {
+  SPDLOG_DEBUG("Stop video {}", getDisplayName());
+  mMediaPlayer->stop();
+  QMutexLocker locker(&mFrameQueueMutex);
+  mFrameQueue.clear();
+  mIsClockSynchronized = false;
+  mLastPresentedStartTimeUs = -1;
+}
+
+void FrameSourceRenderObject::updateTexture(bool upload) {
+  // the clock and the jitter buffer advance while the object is not drawn, such that it shows the
+  // current frame when it appears again
+  QVideoFrame dueFrame;
+  if (takeDueFrame(dueFrame)) {
+    if (mDueFrame.isValid()) {
+      // superseded before it was shown
+      ++mDroppedFrameCount;
+    }
+    mDueFrame = std::move(dueFrame);
+  }
+  if (upload && mDueFrame.isValid()) {
+    uploadFrame(mDueFrame);
+    mDueFrame = QVideoFrame();
+    ++mPresentedFrameCount;
+  }
+}
+
+void FrameSourceRenderObject::onVideoFrameChanged(const QVideoFrame& frame) {
+  if (!frame.isValid()) return;
+  QMutexLocker locker(&mFrameQueueMutex);
+  mFrameQueue.push_back(frame);
+  // the render thread does not keep up: drop the oldest frames
+  while (mFrameQueue.size() > kJitterBufferSize) {
+    mFrameQueue.pop_front();
+    ++mDroppedFrameCount;
+  }
+}
+
+bool FrameSourceRenderObject::takeDueFrame(QVideoFrame& dueFrame) {
+  // never stall the render thread: if the backend is queueing right now, try again next tick
+  if (!mFrameQueueMutex.tryLock()) return false;
+  bool hasDueFrame = false;
+  if (!mFrameQueue.empty()) {
+    const qint64 frontStartTimeUs = mFrameQueue.front().startTime();
+    if (frontStartTimeUs < 0) {
+      // the stream has no timestamps: present in order of arrival
+      hasDueFrame = true;
+    } else {
+      // (re)synchronize the stream to the render clock on start, after looping or seeking
+      if (!mIsClockSynchronized || frontStartTimeUs < mLastPresentedStartTimeUs ||
+          frontStartTimeUs - (mRenderTimestampUs - mClockOffsetUs) > kResyncThresholdUs) {
+        mClockOffsetUs = mRenderTimestampUs - frontStartTimeUs;
+        mIsClockSynchronized = true;
+      }
+      const qint64 streamTimeUs = mRenderTimestampUs - mClockOffsetUs;
+      // drop all frames that are already superseded by a later frame which is due
+      while (mFrameQueue.size() > 1 && mFrameQueue[1].startTime() >= 0 &&
+             mFrameQueue[1].startTime() <= streamTimeUs) {
+        mFrameQueue.pop_front();
+        ++mDroppedFrameCount;
+      }
+      hasDueFrame = mFrameQueue.front().startTime() <= streamTimeUs;
+    }
+    if (hasDueFrame) {
+      dueFrame = mFrameQueue.front();
+      mFrameQueue.pop_front();
+      mLastPresentedStartTimeUs = dueFrame.startTime();
+    }
+  }
+  mFrameQueueMutex.unlock();
+  return hasDueFrame;
+}
+
+void FrameSourceRenderObject::uploadFrame(QVideoFrame& frame) {
+  const auto pixelFormat = frame.pixelFormat();
+  if (pixelFormat == QVideoFrameFormat::Format_RGBA8888 ||
+      pixelFormat == QVideoFrameFormat::Format_BGRA8888) {
+    // the mapped plane is copied once into the upload buffer, there is no intermediate image
+    // Note: BGRA is interpreted as RGBA and transformed in the fragment shader!
+    if (!frame.map(QtVideo::MapMode::ReadOnly)) {
+      SPDLOG_ERROR("Failed to map video frame of {}", getDisplayName());
+      return;
+    }
+    changeTextureSizeAndFormat(frame.size(), pixelFormat == QVideoFrameFormat::Format_RGBA8888
+                                                 ? SourcePixelFormat::RGBA
+                                                 : SourcePixelFormat::BGRA);
+    setSourceAlphaOpaque(false);
+    setTextureData(frame.bits(0), frame.bytesPerLine(0));
+    frame.unmap();
+    return;
+  }
+
+  // other formats (e.g. YUV) need a conversion
+  if (!mConversionWarningLogged) {
+    SPDLOG_WARN("Video {} delivers pixel format {} which needs a conversion", getDisplayName(),
+                static_cast<int>(pixelFormat));
+    mConversionWarningLogged = true;
+  }
+  QImage image = frame.toImage();
+  // e.g. YUV frames convert to images without alpha channel
+  const bool alphaOpaque = !image.hasAlphaChannel();
+  if (image.format() != QImage::Format_RGBA8888 &&
+      image.format() != QImage::Format_RGBA8888_Premultiplied &&
+      image.format() != QImage::Format_RGBX8888) {
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+  }
+  changeTextureSizeAndFormat(image.size(), SourcePixelFormat::RGBA);
+  setSourceAlphaOpaque(alphaOpaque);
+  setTextureData(image.constBits(), static_cast<int>(image.bytesPerLine()));
+}
+
+}  // namespace nimagna
@@ -0,0 +1,47 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/FxaaEffect.h"
+
+#include <QtGui/QOpenGLFunctions>
+
+#include "Rendering/UnitQuad.h"
+
+namespace nimagna {
+
+void FxaaEffect::apply(const QOpenGLFramebufferObject& input) {
+  const GLenum textureTarget = input.format().textureTarget();
+  const auto program = ShaderProgramCache::program(
+      shaderProgramKey(textureTarget),
+      [](QOpenGLShaderProgram& program) { program.setUniformValue("frameTexture", kTextureUnit); });
+  if (!program) {
+    SPDLOG_ERROR("No FXAA program");
+    return;
+  }
+  auto* f = QOpenGLContext::currentContext()->functions();
+  program->bind();
+  f->glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+  f->glBindTexture(textureTarget, input.texture());
+  // the samples along edges fall between pixels, the framebuffer textures filter nearest
+  f->glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  f->glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  UnitQuad::forCurrentContext().draw();
+  f->glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  f->glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  f->glBindTexture(textureTarget, 0);
+  program->release();
+}
+
+std::vector<ShaderProgramCache::Key> FxaaEffect::shaderProgramKeys() {
+  return {shaderProgramKey(GL_TEXTURE_2D), shaderProgramKey(GL_TEXTURE_RECTANGLE)};
+}
+
+ShaderProgramCache::Key FxaaEffect::shaderProgramKey(GLenum textureTarget) {
+  // the features are the shader's defines
+  ShaderProgramCache::Key key{mVertexShaderFile, mFragmentShaderFile, {}};
+  if (textureTarget == GL_TEXTURE_RECTANGLE) {
+    key.features << "RECTANGLE_TEXTURE";
+  }
+  return key;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,137 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/ImageDecoder.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSysInfo>
+#include <QtGui/QImageReader>
+#include <algorithm>
+#include <cstring>
+
+namespace nimagna {
+
+bool ImageDecoder::decodeIntoTexture(const QString& filename, TextureRenderObject& renderObject) {
+  QElapsedTimer timer;
+  timer.start();
+  if (decodeIntoStagingBuffer(filename, renderObject)) {
+    SPDLOG_DEBUG("Decoded {} into the upload buffer in {} ms", filename, timer.elapsed());
+    return true;
+  }
+
+  // fallback: decode into a QImage which is converted and uploaded by the render object
+  auto image = QImage(filename);
+  if (image.isNull()) {
+    SPDLOG_ERROR("No image: {}", filename);
+    return false;
+  }
+  // the QImage path converts to RGB or RGBA (a failed direct attempt may have left BGRA)
+  renderObject.changeTextureSizeAndFormat(
+      image.size(), image.hasAlphaChannel() ? TextureRenderObject::SourcePixelFormat::RGBA
+                                            : TextureRenderObject::SourcePixelFormat::RGB);
+  renderObject.setTextureData(image);
+  renderObject.setMaskTextureData(image);
+  SPDLOG_DEBUG("Decoded {} through QImage in {} ms", filename, timer.elapsed());
+  return true;
+}
+
+QImage ImageDecoder::decodeForUpload(const QString& filename,
+                                     TextureRenderObject::SourcePixelFormat* sourcePixelFormat) {
+  QImage image = QImageReader(filename).read();
+  if (image.isNull()) {
+    return {};
+  }
+  if (const auto directFormat = directSourcePixelFormat(image.format())) {
+    *sourcePixelFormat = *directFormat;
+    return image;
+  }
+  // the same conversion as in setTextureData
+  *sourcePixelFormat = image.hasAlphaChannel() ? TextureRenderObject::SourcePixelFormat::RGBA
+                                               : TextureRenderObject::SourcePixelFormat::RGB;
+  image.convertTo(TextureRenderObject::qImageFormatFromSourcePixelFormat(*sourcePixelFormat));
+  return image;
+}
+
+std::optional<TextureRenderObject::SourcePixelFormat> ImageDecoder::directSourcePixelFormat(
+    QImage::Format format) {
+  using SourcePixelFormat = TextureRenderObject::SourcePixelFormat;
+  switch (format) {
+    case QImage::Format_RGB888:
+      return SourcePixelFormat::RGB;
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888:
+      return SourcePixelFormat::RGBA;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+      // 0xAARRGGBB words are stored as B, G, R, A bytes on little endian machines
+      if constexpr (QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+        return SourcePixelFormat::BGRA;
+      }
+      return std::nullopt;
+    default:
+      return std::nullopt;
+  }
+}
+
+bool ImageDecoder::decodeIntoStagingBuffer(const QString& filename,
+                                           TextureRenderObject& renderObject) {
+  QImageReader reader(filename);
+  const QSize size = reader.size();
+  const QImage::Format format = reader.imageFormat();
+  const auto sourcePixelFormat = directSourcePixelFormat(format);
+  if (!size.isValid() || !sourcePixelFormat) {
+    // the handler cannot tell size and format upfront or a conversion is needed
+    return false;
+  }
+  if (renderObject.hasSeparateMask()) {
+    // the mask is derived from the decoded image
+    return false;
+  }
+
+  renderObject.changeTextureSizeAndFormat(size, *sourcePixelFormat);
+  // e.g. RGB32 from JPEG is uploaded as BGRA but its alpha is 1
+  renderObject.setSourceAlphaOpaque(TextureRenderObject::hasOpaqueAlpha(format));
+  int bytesPerLine = 0;
+  uchar* staging = renderObject.beginTextureUpload(&bytesPerLine);
+  if (staging == nullptr) {
+    return false;
+  }
+  // the image wraps the mapped memory: handlers reuse a target image of matching size and format
+  // and write their scan lines directly into it
+  QImage target(staging, size.width(), size.height(), bytesPerLine, format);
+  bool success = reader.read(&target);
+  const bool decodedInPlace = target.constBits() == staging;
+  if (success && !decodedInPlace) {
+    // the handler allocated its own image (e.g. due to a transformation): copy it over once
+    SPDLOG_DEBUG("Decoder of {} did not decode in place", filename);
+    if (target.size() != size) {
+      success = false;
+    } else {
+      if (target.format() != format) {
+        target.convertTo(format);
+      }
+      const auto rowBytes = std::min<qsizetype>(bytesPerLine, target.bytesPerLine());
+      for (int row = 0; row < size.height(); ++row) {
+        std::memcpy(staging + row * bytesPerLine, target.constScanLine(row), rowBytes);
+      }
+    }
+  }
+  renderObject.endTextureUpload();
+  if (!success) {
+    SPDLOG_WARN("Decoding {} into the upload buffer failed: {}", filename, reader.errorString());
+    return false;
+  }
+  if (!TextureRenderObject::hasOpaqueAlpha(format)) {
+    // the upload buffer is write only: the alpha copy for picking is taken from the handler's own
+    // image or from a second decode at its small size (cheap for handlers that scale natively)
+    QImage alpha = decodedInPlace ? QImage() : target;
+    if (alpha.isNull()) {
+      QImageReader alphaReader(filename);
+      alphaReader.setScaledSize(TextureRenderObject::pickingAlphaSize(size));
+      alpha = alphaReader.read();
+    }
+    renderObject.setPickingAlpha(alpha);
+  }
+  return true;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,190 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/ImageFileRefresher.h"
+
+#include <QtCore/QMutexLocker>
+#include <algorithm>
+#include <utility>
+
+#include "Rendering/ImageDecoder.h"
+#include "Rendering/Simd.h"
+
+namespace nimagna {
+
+ImageFileRefresher::ImageFileRefresher() {
+  // refreshes are rare, keep them from competing with the decoders of the sources
+  mRefreshPool.setMaxThreadCount(1);
+}
+
+ImageFileRefresher::~ImageFileRefresher() {
+  mRefreshPool.clear();
+  mRefreshPool.waitForDone();
+}
+
+void ImageFileRefresher::watch(const QString& filename,
+                               std::shared_ptr<TextureRenderObject> renderObject) {
+  mWatchedFiles[filename].renderObjects.push_back(renderObject);
+}
+
+void ImageFileRefresher::refresh(const QString& filename) {
+  const auto iter = mWatchedFiles.find(filename);
+  if (iter == mWatchedFiles.end()) {
+    return;
+  }
+  if (mRunningRefreshes.count(filename) > 0) {
+    // the file changed again while decoding: refresh again once the running one is applied
+    mRepeatedRefreshes.insert(filename);
+    return;
+  }
+
+  // the first refresh has no previous pixels and rebuilds the textures from the decoded file,
+  // which is cheaper than reading them back from the GPU
+  const auto& watchedFile = iter->second;
+  mRunningRefreshes.insert(filename);
+  mRefreshPool.start([this, filename, previousPixels = watchedFile.pixels,
+                      previousSourcePixelFormat = watchedFile.sourcePixelFormat]() {
+    decodeAndCompare(filename, previousPixels, previousSourcePixelFormat);
+  });
+}
+
+void ImageFileRefresher::uploadChangedTiles() {
+  std::vector<Refresh> finishedRefreshes;
+  {
+    QMutexLocker locker(&mFinishedMutex);
+    finishedRefreshes = std::exchange(mFinishedRefreshes, {});
+  }
+  for (const auto& finishedRefresh : finishedRefreshes) {
+    mRunningRefreshes.erase(finishedRefresh.filename);
+    apply(finishedRefresh);
+    if (mRepeatedRefreshes.erase(finishedRefresh.filename) > 0) {
+      refresh(finishedRefresh.filename);
+    }
+  }
+}
+
+void ImageFileRefresher::clear() {
+  mRefreshPool.clear();
+  mRefreshPool.waitForDone();
+  mWatchedFiles.clear();
+  mRunningRefreshes.clear();
+  mRepeatedRefreshes.clear();
+  QMutexLocker locker(&mFinishedMutex);
+  mFinishedRefreshes.clear();
+}
+
+void ImageFileRefresher::decodeAndCompare(
+    const QString& filename, const QImage& previousPixels,
+    TextureRenderObject::SourcePixelFormat previousSourcePixelFormat) {
+  QElapsedTimer timer;
+  timer.start();
+  Refresh refresh{filename};
+  refresh.pixels = ImageDecoder::decodeForUpload(filename, &refresh.sourcePixelFormat);
+  if (refresh.pixels.isNull()) {
+    // e.g. the file is still being written, the next change notification will retry
+    SPDLOG_WARN("Unable to decode changed file {}", filename);
+  } else if (previousPixels.isNull() || refresh.pixels.size() != previousPixels.size() ||
+             refresh.sourcePixelFormat != previousSourcePixelFormat ||
+             refresh.pixels.depth() != previousPixels.depth() ||
+             refresh.pixels.hasAlphaChannel() != previousPixels.hasAlphaChannel()) {
+    refresh.needsRebuild = true;
+  } else {
+    refresh.changedRegions = changedRegions(previousPixels, refresh.pixels, &refresh.tileCount);
+  }
+  refresh.elapsedMs = timer.elapsed();
+
+  QMutexLocker locker(&mFinishedMutex);
+  mFinishedRefreshes.push_back(std::move(refresh));
+}
+
+void ImageFileRefresher::apply(const Refresh& refresh) {
+  const auto iter = mWatchedFiles.find(refresh.filename);
+  if (iter == mWatchedFiles.end() || refresh.pixels.isNull()) {
+    return;
+  }
+  auto& watchedFile = iter->second;
+  // forget render objects that were removed meanwhile
+  auto& renderObjects = watchedFile.renderObjects;
+  const auto isExpired = [](const auto& renderObject) { return renderObject.expired(); };
+  renderObjects.erase(std::remove_if(renderObjects.begin(), renderObjects.end(), isExpired),
+                      renderObjects.end());
+  if (renderObjects.empty()) {
+    mWatchedFiles.erase(iter);
+    return;
+  }
+
+  const auto& pixels = refresh.pixels;
+  for (const auto& weakRenderObject : renderObjects) {
+    const auto renderObject = weakRenderObject.lock();
+    if (refresh.needsRebuild) {
+      renderObject->changeTextureSizeAndFormat(pixels.size(), refresh.sourcePixelFormat);
+      renderObject->setSourceAlphaOpaque(!pixels.hasAlphaChannel());
+      renderObject->setTextureData(pixels.constBits(), static_cast<int>(pixels.bytesPerLine()));
+      continue;
+    }
+    for (const auto& region : refresh.changedRegions) {
+      // a view into the refreshed pixels, no copy
+      const QImage regionPixels(pixels.constScanLine(region.top()) +
+                                    region.left() * (pixels.depth() / 8),
+                                region.width(), region.height(), pixels.bytesPerLine(),
+                                pixels.format());
+      renderObject->setTextureRegionData(regionPixels, region.topLeft());
+    }
+  }
+  if (refresh.needsRebuild) {
+    SPDLOG_INFO("Refreshed {}: rebuilt texture ({}x{})", refresh.filename, pixels.width(),
+                pixels.height());
+  } else {
+    int changedTileCount = 0;
+    for (const auto& region : refresh.changedRegions) {
+      changedTileCount += (region.width() + kTileSize - 1) / kTileSize;
+    }
+    SPDLOG_INFO("Refreshed {}: {}/{} tiles changed, decoded and compared in {} ms",
+                refresh.filename, changedTileCount, refresh.tileCount, refresh.elapsedMs);
+  }
+  watchedFile.pixels = pixels;
+  watchedFile.sourcePixelFormat = refresh.sourcePixelFormat;
+}
+
+std::vector<QRect> ImageFileRefresher::changedRegions(const QImage& previous,
+                                                      const QImage& current, int* tileCount) {
+  std::vector<QRect> regions;
+  const int width = current.width();
+  const int height = current.height();
+  const int pixelBytes = current.depth() / 8;
+  const int tileColumns = (width + kTileSize - 1) / kTileSize;
+  *tileCount = tileColumns * ((height + kTileSize - 1) / kTileSize);
+  std::vector<bool> isTileChanged(tileColumns);
+
+  for (int top = 0; top < height; top += kTileSize) {
+    const int tileHeight = std::min(kTileSize, height - top);
+    std::fill(isTileChanged.begin(), isTileChanged.end(), false);
+    // scan line by scan line for linear memory access, skipping tiles known to be changed
+    for (int row = top; row < top + tileHeight; ++row) {
+      const uchar* previousLine = previous.constScanLine(row);
+      const uchar* currentLine = current.constScanLine(row);
+      for (int column = 0; column < tileColumns; ++column) {
+        if (isTileChanged[column]) continue;
+        const int left = column * kTileSize;
+        const size_t offset = static_cast<size_t>(left) * pixelBytes;
+        const size_t rowBytes =
+            static_cast<size_t>(std::min(kTileSize, width - left)) * pixelBytes;
+        isTileChanged[column] =
+            !simd::equalBytes(previousLine + offset, currentLine + offset, rowBytes);
+      }
+    }
+    // merge runs of changed tiles to upload them at once
+    for (int column = 0; column < tileColumns;) {
+      if (!isTileChanged[column]) {
+        ++column;
+        continue;
+      }
+      const int firstColumn = column;
+      while (column < tileColumns && isTileChanged[column]) ++column;
+      const int left = firstColumn * kTileSize;
+      regions.emplace_back(left, top, std::min(column * kTileSize, width) - left, tileHeight);
+    }
+  }
+  return regions;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,148 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/ImageSequenceRenderObject.h"
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtGui/QImageReader>
+#include <algorithm>
+#include <cmath>
+
+namespace nimagna {
+
+ImageSequenceRenderObject::ImageSequenceRenderObject(TextureTarget type,
+                                                     const QStringList& filenames,
+                                                     int framesPerSecond,
+                                                     PlaybackMode playbackMode)
+    : TextureRenderObject(type),
+      mFilenames(filenames),
+      mFramesPerSecond(std::max(framesPerSecond, 1)),
+      mPlaybackMode(playbackMode),
+      mRingCapacity(std::max(
+          2, static_cast<int>(std::ceil(mFramesPerSecond * kPrefetchDurationMs / 1000.0)))) {
+  enableSeparateMask(false, false);
+  initialize();
+
+  // leave cores for the render and main threads
+  mDecodePool.setMaxThreadCount(std::clamp(QThread::idealThreadCount() - 2, 1, 4));
+  SPDLOG_DEBUG("Image sequence with {} frames at {} fps, prefetching {} frames on {} threads",
+               frameCount(), mFramesPerSecond, mRingCapacity, mDecodePool.maxThreadCount());
+  // decode the first frames right away
+  updatePrefetchWindow(0);
+}
+
+ImageSequenceRenderObject::~ImageSequenceRenderObject() {
+  // the workers access this object: wait for them before destruction
+  mIsStopping = true;
+  mDecodePool.clear();
+  mDecodePool.waitForDone();
+}
+
+void ImageSequenceRenderObject::updateTexture(bool upload) {
+  if (mFilenames.isEmpty()) return;
+  if (!mHasStarted) {
+    mStartTimestampUs = mRenderTimestampUs;
+    mHasStarted = true;
+  }
+  const int frameIndex = frameIndexAt(mRenderTimestampUs);
+  // decoding keeps up with the clock while the object is not drawn, nothing is shown or missed
+  updatePrefetchWindow(frameIndex);
+
+  if (upload && frameIndex != mCurrentFrameIndex) {
+    QImage frame;
+    {
+      QMutexLocker locker(&mFramesMutex);
+      if (auto iter = mReadyFrames.find(frameIndex); iter != mReadyFrames.end()) {
+        frame = std::move(iter->second);
+        mReadyFrames.erase(iter);
+      }
+    }
+    if (!frame.isNull()) {
+      changeTextureSizeAndFormat(frame.size(), frame.hasAlphaChannel() ? SourcePixelFormat::RGBA
+                                                                       : SourcePixelFormat::RGB);
+      setTextureData(frame.constBits(), static_cast<int>(frame.bytesPerLine()));
+      mCurrentFrameIndex = frameIndex;
+      mUnderrunFrameIndex = -1;
+    } else if (mCurrentFrameIndex >= 0 && frameIndex != mUnderrunFrameIndex) {
+      // underrun: keep the previous frame visible. Waiting for the first frame is no underrun.
+      mUnderrunFrameIndex = frameIndex;
+      ++mUnderrunCount;
+      if (mUnderrunCount == 1 || mUnderrunCount % 100 == 0) {
+        SPDLOG_WARN("Image sequence {}: frame {} not decoded in time ({} underruns)",
+                    getDisplayName(), frameIndex, mUnderrunCount);
+      }
+      emit underrun(frameIndex);
+    }
+  }
+}
+
+int ImageSequenceRenderObject::frameIndexAt(qint64 renderTimestampUs) const {
+  const qint64 elapsedUs = std::max<qint64>(renderTimestampUs - mStartTimestampUs, 0);
+  const qint64 frameNumber = elapsedUs * mFramesPerSecond / 1000000;
+  if (mPlaybackMode == PlaybackMode::Loop) {
+    return static_cast<int>(frameNumber % frameCount());
+  }
+  return static_cast<int>(std::min<qint64>(frameNumber, frameCount() - 1));
+}
+
+void ImageSequenceRenderObject::updatePrefetchWindow(int currentFrameIndex) {
+  if (mFilenames.isEmpty()) return;
+  // the frames needed within the prefetch duration, wrapped around when looping
+  std::set<int> window;
+  for (int offset = 0; offset < mRingCapacity; ++offset) {
+    int frameIndex = currentFrameIndex + offset;
+    if (frameIndex >= frameCount()) {
+      if (mPlaybackMode == PlaybackMode::Hold) break;
+      frameIndex %= frameCount();
+    }
+    window.insert(frameIndex);
+  }
+
+  std::vector<int> framesToDecode;
+  {
+    QMutexLocker locker(&mFramesMutex);
+    // evict ready frames which fell out of the window (e.g. skipped ones)
+    std::erase_if(mReadyFrames, [&window](const auto& entry) {
+      return !window.contains(entry.first);
+    });
+    for (const int frameIndex : window) {
+      if (frameIndex == mCurrentFrameIndex || mReadyFrames.contains(frameIndex) ||
+          mPendingFrames.contains(frameIndex) || mFailedFrames.contains(frameIndex)) {
+        continue;
+      }
+      mPendingFrames.insert(frameIndex);
+      framesToDecode.push_back(frameIndex);
+    }
+  }
+  // the window is ordered by frame index: decode the most urgent frames first
+  std::sort(framesToDecode.begin(), framesToDecode.end(), [currentFrameIndex](int a, int b) {
+    return (a < currentFrameIndex) == (b < currentFrameIndex) ? a < b : a >= currentFrameIndex;
+  });
+  for (const int frameIndex : framesToDecode) {
+    mDecodePool.start([this, frameIndex]() { decodeFrame(frameIndex); });
+  }
+}
+
+void ImageSequenceRenderObject::decodeFrame(int frameIndex) {
+  if (mIsStopping) return;
+  QImageReader reader(mFilenames.at(frameIndex));
+  QImage image = reader.read();
+  if (image.isNull()) {
+    SPDLOG_ERROR("Failed to decode frame {}: {}", mFilenames.at(frameIndex), reader.errorString());
+  } else {
+    // convert on the worker such that the render thread only uploads, premultiplied like the
+    // images of texture objects (see TextureRenderObject::setTextureData)
+    image.convertTo(qImageFormatFromSourcePixelFormat(
+        image.hasAlphaChannel() ? SourcePixelFormat::RGBA : SourcePixelFormat::RGB));
+  }
+  QMutexLocker locker(&mFramesMutex);
+  mPendingFrames.erase(frameIndex);
+  if (image.isNull()) {
+    // do not retry broken files on every render tick
+    mFailedFrames.insert(frameIndex);
+  } else {
+    mReadyFrames[frameIndex] = std::move(image);
+  }
+}
+
+}  // namespace nimagna
@@ -0,0 +1,130 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/MaskBlur.h"
+
+#include <QtGui/QOpenGLFunctions>
+#include <QtGui/QVector2D>
+#include <QtOpenGL/QOpenGLFramebufferObjectFormat>
+#include <cmath>
+
+#include "Rendering/UnitQuad.h"
+
+namespace nimagna {
+
+RenderTargetPool::Description MaskBlur::targetDescription(const QSize& maskSize,
+                                                          GLenum textureTarget) {
+  RenderTargetPool::Description description;
+  description.size = maskSize;
+  description.internalFormat = GL_R8;
+  description.textureTarget = textureTarget;
+  return description;
+}
+
+std::unique_ptr<QOpenGLFramebufferObject> MaskBlur::createTarget(const QSize& maskSize,
+                                                                 GLenum textureTarget) {
+  const auto description = targetDescription(maskSize, textureTarget);
+  QOpenGLFramebufferObjectFormat format;
+  format.setInternalTextureFormat(description.internalFormat);
+  format.setTextureTarget(description.textureTarget);
+  auto target = std::make_unique<QOpenGLFramebufferObject>(description.size, format);
+  if (!target->isValid()) {
+    SPDLOG_ERROR("Failed to create a {}x{} mask target", maskSize.width(), maskSize.height());
+  }
+  return target;
+}
+
+void MaskBlur::addPasses(RenderGraph& renderGraph, GLuint maskTexture, GLenum textureTarget,
+                         const QSize& maskSize, const Parameters& parameters,
+                         RenderGraph::TargetId blurredMask) {
+  const auto rows =
+      renderGraph.createTarget("mask blur rows", targetDescription(maskSize, textureTarget));
+  renderGraph.addPass("mask blur rows", {}, {rows}, [=](const RenderGraph& graph) {
+    drawPass(maskTexture, textureTarget, parameters, Direction::Horizontal,
+             *graph.framebuffer(rows));
+  });
+  renderGraph.addPass("mask blur columns", {rows}, {blurredMask}, [=](const RenderGraph& graph) {
+    drawPass(graph.framebuffer(rows)->texture(), textureTarget, parameters, Direction::Vertical,
+             *graph.framebuffer(blurredMask));
+  });
+}
+
+void MaskBlur::drawPass(GLuint sourceTexture, GLenum textureTarget, const Parameters& parameters,
+                        Direction direction, QOpenGLFramebufferObject& destination) {
+  const bool isHorizontal = direction == Direction::Horizontal;
+  const bool postProcessing = isHorizontal && parameters.sharpness != 0.f;
+  const auto program = ShaderProgramCache::program(
+      shaderProgramKey(textureTarget, postProcessing),
+      [](QOpenGLShaderProgram& program) { program.setUniformValue("maskTexture", kTextureUnit); });
+  if (!program) {
+    SPDLOG_ERROR("No mask blur program");
+    return;
+  }
+  auto* f = QOpenGLContext::currentContext()->functions();
+  destination.bind();
+  GLint viewport[4];
+  f->glGetIntegerv(GL_VIEWPORT, viewport);
+  const GLboolean isBlendingEnabled = f->glIsEnabled(GL_BLEND);
+  f->glViewport(0, 0, destination.width(), destination.height());
+  f->glDisable(GL_BLEND);
+
+  program->bind();
+  program->setUniformValue("blurDirection", isHorizontal ? QVector2D(1.f, 0.f)
+                                                         : QVector2D(0.f, 1.f));
+  program->setUniformValue("blurKernelSize", parameters.radius);
+  // the transparent border, filtered in the first pass. The second pass averages rows of it.
+  program->setUniformValue("borderValue", parameters.sharpness != 0.f
+                                              ? sigmoid(0.f, parameters.sharpness)
+                                              : 0.f);
+  if (postProcessing) {
+    const auto table = sigmoidTable(parameters.sharpness);
+    program->setUniformValueArray("sigmoidTable", table.data(), static_cast<int>(table.size()));
+  }
+  f->glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+  f->glBindTexture(textureTarget, sourceTexture);
+  UnitQuad::forCurrentContext().draw();
+  f->glBindTexture(textureTarget, 0);
+  program->release();
+
+  f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (isBlendingEnabled) {
+    f->glEnable(GL_BLEND);
+  }
+}
+
+float MaskBlur::sigmoid(float value, float sharpness) {
+  const float sig = std::exp(sharpness * (value - 0.5f));
+  return sig / (1.f + sig);
+}
+
+std::array<QVector4D, MaskBlur::kSigmoidTableSize / 4> MaskBlur::sigmoidTable(float sharpness) {
+  std::array<QVector4D, kSigmoidTableSize / 4> table;
+  for (int level = 0; level < kSigmoidTableSize; ++level) {
+    table[level / 4][level % 4] =
+        sigmoid(static_cast<float>(level) / (kSigmoidTableSize - 1), sharpness);
+  }
+  return table;
+}
+
+std::vector<ShaderProgramCache::Key> MaskBlur::shaderProgramKeys() {
+  std::vector<ShaderProgramCache::Key> keys;
+  for (const GLenum textureTarget : {GL_TEXTURE_2D, GL_TEXTURE_RECTANGLE}) {
+    for (const bool postProcessing : {false, true}) {
+      keys.push_back(shaderProgramKey(textureTarget, postProcessing));
+    }
+  }
+  return keys;
+}
+
+ShaderProgramCache::Key MaskBlur::shaderProgramKey(GLenum textureTarget, bool postProcessing) {
+  // the features are the shader's defines (in sorted order)
+  ShaderProgramCache::Key key{mVertexShaderFile, mFragmentShaderFile, {}};
+  if (postProcessing) {
+    key.features << "POST_PROCESSING";
+  }
+  if (textureTarget == GL_TEXTURE_RECTANGLE) {
+    key.features << "RECTANGLE_TEXTURE";
+  }
+  return key;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,122 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nimagna {
+
+namespace {
+
+// projects a point of the object plane to pixels, false if it is at or behind the eye (w <= 0)
+// where the projection wraps around
+bool projectToPixels(const QMatrix4x4& mvp, float x, float y, const QSize& viewportSize,
+                     QPointF* pixel, bool* withinDepthRange) {
+  const QVector4D clip = mvp * QVector4D(x, y, 0.f, 1.f);
+  if (!(clip.w() > 0.f)) {
+    return false;
+  }
+  *withinDepthRange = *withinDepthRange && std::abs(clip.z()) < clip.w();
+  *pixel = QPointF((clip.x() / clip.w() + 1.f) * 0.5f * viewportSize.width(),
+                   (clip.y() / clip.w() + 1.f) * 0.5f * viewportSize.height());
+  return true;
+}
+
+}  // namespace
+
+void OcclusionCuller::cull(const std::vector<RenderQueue::Entry>& entries,
+                           const QMatrix4x4& viewProjection, const QSize& viewportSize,
+                           std::vector<unsigned char>* visible) {
+  mLastFrameStatistics = {};
+  mCoveredRegion = QRegion();
+  const QRect viewport(QPoint(0, 0), viewportSize);
+  if (viewport.isEmpty()) {
+    return;
+  }
+  const double viewportArea = double(viewport.width()) * viewport.height();
+
+  // front to back: objects drawn later cover the ones drawn before
+  for (size_t index = entries.size(); index-- > 0;) {
+    if (!(*visible)[index]) continue;
+    const auto& renderObject = *entries[index].renderObject;
+    QRect outer;
+    QRect inner;
+    if (!screenRects(renderObject, viewProjection, viewportSize, &outer, &inner)) {
+      // no bounds, drawn but not counted
+      continue;
+    }
+    outer &= viewport;
+    const double area = double(outer.width()) * outer.height() / viewportArea;
+    mLastFrameStatistics.overdrawWithoutOcclusion += area;
+    if (QRegion(outer).subtracted(mCoveredRegion).isEmpty()) {
+      (*visible)[index] = 0;
+      ++mLastFrameStatistics.occludedCount;
+      continue;
+    }
+    mLastFrameStatistics.overdraw += area;
+    if (renderObject.isOpaque() && !inner.isEmpty()) {
+      mCoveredRegion += inner & viewport;
+    }
+  }
+}
+
+bool OcclusionCuller::screenRects(const RenderObject& renderObject,
+                                  const QMatrix4x4& viewProjection, const QSize& viewportSize,
+                                  QRect* outer, QRect* inner) {
+  float rect[4];
+  if (!renderObject.localBounds(rect)) {
+    return false;
+  }
+  const QMatrix4x4 mvp = viewProjection * renderObject.getModelMatrix();
+  // the corners in pixels: origin, +width, +height, +width+height
+  QPointF corners[4];
+  bool withinDepthRange = true;
+  for (int corner = 0; corner < 4; ++corner) {
+    if (!projectToPixels(mvp, rect[0] + ((corner & 1) ? rect[2] : 0.f),
+                         rect[1] + ((corner & 2) ? rect[3] : 0.f), viewportSize, &corners[corner],
+                         &withinDepthRange)) {
+      // a corner at or behind the eye: the object may cover anything but nothing fully
+      *outer = QRect(QPoint(0, 0), viewportSize);
+      *inner = QRect();
+      return true;
+    }
+  }
+  double left = corners[0].x();
+  double right = left;
+  double top = corners[0].y();
+  double bottom = top;
+  for (const auto& corner : corners) {
+    left = std::min(left, corner.x());
+    right = std::max(right, corner.x());
+    top = std::min(top, corner.y());
+    bottom = std::max(bottom, corner.y());
+  }
+  // corners close to the eye plane project far outside, keep them within int range
+  left = std::clamp(left, -1.0, viewportSize.width() + 1.0);
+  right = std::clamp(right, -1.0, viewportSize.width() + 1.0);
+  top = std::clamp(top, -1.0, viewportSize.height() + 1.0);
+  bottom = std::clamp(bottom, -1.0, viewportSize.height() + 1.0);
+  // every pixel touched
+  *outer = QRect(QPoint(int(std::floor(left)), int(std::floor(top))),
+                 QPoint(int(std::ceil(right)) - 1, int(std::ceil(bottom)) - 1));
+
+  // only pixels completely covered, if the corners are an axis aligned (possibly 90 degrees
+  // rotated) rectangle
+  constexpr double kTolerance = 1e-3;
+  const auto same = [](double a, double b) { return std::abs(a - b) < kTolerance; };
+  const bool axisAligned =
+      (same(corners[0].x(), corners[2].x()) && same(corners[1].x(), corners[3].x()) &&
+       same(corners[0].y(), corners[1].y()) && same(corners[2].y(), corners[3].y())) ||
+      (same(corners[0].x(), corners[1].x()) && same(corners[2].x(), corners[3].x()) &&
+       same(corners[0].y(), corners[2].y()) && same(corners[1].y(), corners[3].y()));
+  *inner = QRect();
+  if (withinDepthRange && axisAligned) {
+    *inner = QRect(QPoint(int(std::ceil(left - kTolerance)), int(std::ceil(top - kTolerance))),
+                   QPoint(int(std::floor(right + kTolerance)) - 1,
+                          int(std::floor(bottom + kTolerance)) - 1));
+  }
+  return true;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,107 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/RenderBatcher.h"
+
+#include <QtGui/QOpenGLFunctions>
+#include <utility>
+
+#include "Rendering/TextureRenderObject.h"
+#include "Rendering/UnitQuad.h"
+
+namespace nimagna {
+
+void RenderBatcher::add(const Item& item) {
+  if (!mInstances.empty() &&
+      (!isCompatible(item, mBatch) ||
+       static_cast<int>(mInstances.size()) == UniformBufferRing::kMaxInstanceCount)) {
+    flush();
+  }
+  int slot = textureSlot(item);
+  if (slot < 0 && mUsedTextureSlotCount == kTextureSlotCount) {
+    // all texture units are taken by other textures
+    flush();
+  }
+  if (mInstances.empty()) {
+    mBatch = item;
+    mUsedTextureSlotCount = 0;
+    slot = textureSlot(item);
+  }
+  if (slot < 0) {
+    slot = mUsedTextureSlotCount++;
+    mTextures[slot] = item.texture;
+    mMaskTextures[slot] = item.maskTexture;
+  }
+  mInstances.push_back(item.uniforms);
+  mInstances.back().drawDepth = mDrawDepth;
+  mInstances.back().textureSlot = slot;
+  ++mStatistics.itemCount;
+}
+
+void RenderBatcher::flush() {
+  if (mInstances.empty()) {
+    return;
+  }
+  const int instanceCount = static_cast<int>(mInstances.size());
+  const int textureSlotCount = std::exchange(mUsedTextureSlotCount, 0);
+  if (!UniformBufferRing::forCurrentContext().bindObjectUniforms(mInstances.data(),
+                                                                 instanceCount)) {
+    mInstances.clear();
+    return;
+  }
+  if (!mBatch.program->bind()) {
+    SPDLOG_ERROR("Failed to bind texture program");
+  }
+  auto* f = QOpenGLContext::currentContext()->functions();
+  const auto bindTextures = [&](bool unbind) {
+    for (int slot = 0; slot < textureSlotCount; ++slot) {
+      if (mMaskTextures[slot] != 0) {
+        f->glActiveTexture(GL_TEXTURE0 + TextureRenderObject::maskTextureUnit() + slot);
+        f->glBindTexture(mBatch.textureTarget, unbind ? 0 : mMaskTextures[slot]);
+      }
+      f->glActiveTexture(GL_TEXTURE0 + TextureRenderObject::colorTextureUnit() + slot);
+      f->glBindTexture(mBatch.textureTarget, unbind ? 0 : mTextures[slot]);
+    }
+    f->glActiveTexture(GL_TEXTURE0 + TextureRenderObject::colorTextureUnit());
+  };
+  // an external texture is bound to the first unit already and keeps the only slot
+  const bool bindsTextures = mBatch.texture != 0;
+  if (bindsTextures) {
+    bindTextures(false);
+  }
+
+  UnitQuad::forCurrentContext().draw(instanceCount);
+  ++mStatistics.drawCallCount;
+
+  // release (for completeness)
+  if (bindsTextures) {
+    bindTextures(true);
+  }
+  mBatch.program->release();
+  mInstances.clear();
+}
+
+void RenderBatcher::endFrame() {
+  flush();
+  mLastFrameStatistics = std::exchange(mStatistics, {});
+}
+
+bool RenderBatcher::isCompatible(const Item& item, const Item& other) {
+  // the textures may differ (see textureSlot) unless they are external
+  return item.program == other.program && item.textureTarget == other.textureTarget &&
+         (item.texture == 0) == (other.texture == 0) &&
+         (item.texture != 0 || item.maskTexture == other.maskTexture);
+}
+
+int RenderBatcher::textureSlot(const Item& item) const {
+  if (item.texture == 0) {
+    return mInstances.empty() ? -1 : 0;
+  }
+  for (int slot = 0; slot < mUsedTextureSlotCount; ++slot) {
+    if (mTextures[slot] == item.texture && mMaskTextures[slot] == item.maskTexture) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+}  // namespace nimagna
@@ -0,0 +1,740 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/RenderBenchmarks.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QRandomGenerator>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Rendering/ImageDecoder.h"
+#include "Rendering/MaskBlur.h"
+#include "Rendering/RenderBatcher.h"
+#include "Rendering/RenderObjectManager.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/RenderTargetPool.h"
+#include "Rendering/ShaderProgramCache.h"
+#include "Rendering/SpatialIndex.h"
+#include "Rendering/TextureRenderObject.h"
+#include "Rendering/TransformGraph.h"
+#include "Rendering/TripleBuffer.h"
+#include "Rendering/UniformBufferRing.h"
+#include "Rendering/UnitQuad.h"
+
+namespace nimagna {
+
+void RenderBenchmarks::shaderVariantFillRate() {
+  auto* context = QOpenGLContext::currentContext();
+  if (!context) {
+    SPDLOG_ERROR("Shader variant benchmark requires a current OpenGL context");
+    return;
+  }
+  auto* f = context->extraFunctions();
+  SPDLOG_INFO("Benchmark: shader variant fill rate on {}",
+              reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kDrawCount = 200;
+  const QString vertexShaderFile = ":/resources/shaders/texture.vert";
+  const QString fragmentShaderFile = ":/resources/shaders/texture_2d.frag";
+  const QString branchingShaderFile = ":/resources/shaders/benchmark/texture_2d_branching.frag";
+  // the texture units of the texture render objects which share the specialized programs
+  const GLint imageTextureUnit = TextureRenderObject::colorTextureUnit();
+  const GLint maskTextureUnit = TextureRenderObject::maskTextureUnit();
+
+  QOpenGLFramebufferObject framebuffer(kWidth, kHeight);
+  if (!framebuffer.bind()) {
+    SPDLOG_ERROR("Unable to bind benchmark framebuffer");
+    return;
+  }
+  f->glViewport(0, 0, kWidth, kHeight);
+  f->glDisable(GL_DEPTH_TEST);
+  f->glEnable(GL_BLEND);
+  f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // random pixels such that no texture compression or fast path kicks in
+  QImage pixels(kWidth, kHeight, QImage::Format_RGBA8888);
+  for (int row = 0; row < kHeight; ++row) {
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32*>(pixels.scanLine(row)),
+                                          kWidth);
+  }
+  QOpenGLTexture imageTexture(pixels, QOpenGLTexture::DontGenerateMipMaps);
+  QOpenGLTexture maskTexture(pixels, QOpenGLTexture::DontGenerateMipMaps);
+  f->glActiveTexture(GL_TEXTURE0 + imageTextureUnit);
+  imageTexture.bind();
+  f->glActiveTexture(GL_TEXTURE0 + maskTextureUnit);
+  maskTexture.bind();
+
+  // the unit quad mapped to the full screen with the full texture
+  UniformBufferRing::ObjectUniforms fullScreenUniforms{
+      {}, {-1.f, -1.f, 2.f, 2.f}, {0.f, 0.f, 1.f, 1.f}, {0.f, 0.f, 1.f, 1.f}, 1.f};
+  std::copy_n(QMatrix4x4().constData(), 16, fullScreenUniforms.model);
+  auto& unitQuad = UnitQuad::forCurrentContext();
+
+  // the reference selecting the features at run time
+  QOpenGLShaderProgram branchingProgram;
+  if (!branchingProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, vertexShaderFile) ||
+      !branchingProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, branchingShaderFile) ||
+      !branchingProgram.link()) {
+    SPDLOG_ERROR("Unable to build the branching shader: {}", branchingProgram.log());
+    return;
+  }
+  branchingProgram.bind();
+  UniformBufferRing::bindBlocks(branchingProgram);
+  branchingProgram.setUniformValue("imageTexture", imageTextureUnit);
+  branchingProgram.setUniformValue("maskTexture", maskTextureUnit);
+  branchingProgram.setUniformValue("doBlurring", false);
+  branchingProgram.setUniformValue("isPostProcessingEnabled", false);
+  branchingProgram.setUniformValue("swapRGB", false);
+
+  // returns the fill rate in megapixels per second
+  const auto measure = [&](QOpenGLShaderProgram& program) {
+    program.bind();
+    auto& uniformBufferRing = UniformBufferRing::forCurrentContext();
+    uniformBufferRing.beginFrame(QMatrix4x4());
+    uniformBufferRing.bindObjectUniforms(&fullScreenUniforms, 1);
+    // warm up, e.g. lazy shader compilation in the driver
+    unitQuad.draw();
+    f->glFinish();
+    QElapsedTimer timer;
+    timer.start();
+    for (int draw = 0; draw < kDrawCount; ++draw) {
+      unitQuad.draw();
+    }
+    f->glFinish();
+    uniformBufferRing.endFrame();
+    const double elapsedS = std::max<qint64>(timer.nsecsElapsed(), 1) * 1e-9;
+    return static_cast<double>(kWidth) * kHeight * kDrawCount / elapsedS * 1e-6;
+  };
+
+  for (const bool useMaskTexture : {false, true}) {
+    ShaderProgramCache::Key key{vertexShaderFile, fragmentShaderFile, {}};
+    if (useMaskTexture) {
+      key.features << "USE_MASK_TEXTURE";
+    }
+    // the specialized programs sample the texture slots' sampler arrays (all instances use the
+    // first slot)
+    const auto specializedProgram =
+        ShaderProgramCache::program(key, [&](QOpenGLShaderProgram& program) {
+          UniformBufferRing::bindBlocks(program);
+          TextureRenderObject::setTextureUnits(
+              program, TextureRenderObject::TextureTarget::Target2D, useMaskTexture);
+        });
+    if (!specializedProgram) {
+      SPDLOG_ERROR("Unable to build the specialized shader variant");
+      return;
+    }
+    branchingProgram.bind();
+    branchingProgram.setUniformValue("useMaskTexture", useMaskTexture);
+    const double branchingRate = measure(branchingProgram);
+    const double specializedRate = measure(*specializedProgram);
+    SPDLOG_INFO("> {}: specialized {:.0f} MPixel/s, branching {:.0f} MPixel/s (speedup {:.2f})",
+                useMaskTexture ? "mask texture" : "plain", specializedRate, branchingRate,
+                specializedRate / branchingRate);
+  }
+
+  branchingProgram.release();
+  framebuffer.release();
+  f->glActiveTexture(GL_TEXTURE0 + imageTextureUnit);
+}
+
+void RenderBenchmarks::opaquePassFillRate(RenderObjectManager& renderObjectManager,
+                                          const QStringList& filenames) {
+  auto* f = QOpenGLContext::currentContext()->functions();
+  SPDLOG_INFO("Benchmark: opaque pass fill rate on {}",
+              reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kFrameCount = 50;
+  // the files are stacked repeatedly, e.g. full frame backgrounds with overlays on top
+  constexpr int kMinimumLayerCount = 10;
+
+  // the layers in draw order, loaded like RenderObjectManager::addTextureObject loads images
+  std::vector<RenderQueue::Entry> renderQueue;
+  int opaqueLayerCount = 0;
+  while (!filenames.isEmpty() && static_cast<int>(renderQueue.size()) < kMinimumLayerCount) {
+    for (const QString& filename : filenames) {
+      auto renderObject =
+          std::make_shared<TextureRenderObject>(TextureRenderObject::kDefaultTextureTarget);
+      renderObject->enableSeparateMask(false, false);
+      renderObject->initialize();
+      if (!ImageDecoder::decodeIntoTexture(filename, *renderObject)) {
+        return;
+      }
+      renderObject->setDisplayName(filename);
+      renderObject->prepare(QMatrix4x4(), 0);
+      if (renderObject->isOpaque()) {
+        ++opaqueLayerCount;
+      }
+      renderQueue.push_back({std::move(renderObject), {}});
+    }
+  }
+  if (renderQueue.empty()) {
+    SPDLOG_ERROR("Opaque pass benchmark requires image files");
+    return;
+  }
+
+  // the render framebuffer's configuration
+  QOpenGLFramebufferObject framebuffer(kWidth, kHeight, QOpenGLFramebufferObject::Depth);
+  if (!framebuffer.bind()) {
+    SPDLOG_ERROR("Unable to bind benchmark framebuffer");
+    return;
+  }
+  f->glViewport(0, 0, kWidth, kHeight);
+
+  // the objects are drawn by the render object manager's passes, its state is rebuilt per frame
+  auto& uniformBufferRing = UniformBufferRing::forCurrentContext();
+  const bool isOpaquePassEnabled = renderObjectManager.isOpaquePassEnabled();
+  const auto drawFrame = [&](bool opaquePass) {
+    uniformBufferRing.beginFrame(QMatrix4x4(), opaquePass);
+    f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderObjectManager.drawRenderObjects(renderQueue);
+    uniformBufferRing.endFrame();
+  };
+  // returns the milliseconds per frame and the last frame
+  const auto measure = [&](bool opaquePass) {
+    renderObjectManager.setOpaquePassEnabled(opaquePass);
+    // warm up, e.g. lazy shader compilation in the driver
+    drawFrame(opaquePass);
+    f->glFinish();
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+      drawFrame(opaquePass);
+    }
+    f->glFinish();
+    const double frameMs = std::max<qint64>(timer.nsecsElapsed(), 1) * 1e-6 / kFrameCount;
+    return std::pair{frameMs, framebuffer.toImage()};
+  };
+
+  const auto [blendedMs, blendedImage] = measure(false);
+  const auto [opaquePassMs, opaquePassImage] = measure(true);
+  renderObjectManager.setOpaquePassEnabled(isOpaquePassEnabled);
+  // both modes must produce the same image (up to rounding)
+  int maximumDifference = 0;
+  for (int row = 0; row < kHeight; ++row) {
+    const uchar* blendedRow = blendedImage.constScanLine(row);
+    const uchar* opaquePassRow = opaquePassImage.constScanLine(row);
+    for (qsizetype byte = 0; byte < blendedImage.bytesPerLine(); ++byte) {
+      maximumDifference =
+          std::max(maximumDifference, std::abs(blendedRow[byte] - opaquePassRow[byte]));
+    }
+  }
+  SPDLOG_INFO("> {} opaque and {} transparent layers: blended {:.2f} ms, opaque pass {:.2f} ms "
+              "per frame (speedup {:.2f}), maximum difference {}",
+              opaqueLayerCount, renderQueue.size() - opaqueLayerCount, blendedMs, opaquePassMs,
+              blendedMs / opaquePassMs, maximumDifference);
+
+  framebuffer.release();
+}
+
+void RenderBenchmarks::maskBlurFillRate() {
+  auto* context = QOpenGLContext::currentContext();
+  if (!context) {
+    SPDLOG_ERROR("Mask blur benchmark requires a current OpenGL context");
+    return;
+  }
+  auto* f = context->extraFunctions();
+  SPDLOG_INFO("Benchmark: mask blur on {}",
+              reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kBlurCount = 20;
+  // the results may differ by the rounding of the intermediate R8 target
+  constexpr int kToleranceLevels = 2;
+  const QString vertexShaderFile = ":/resources/shaders/full_target.vert";
+  const QString referenceShaderFile = ":/resources/shaders/benchmark/mask_blur_reference.frag";
+
+  // random mask texels such that no texture compression or fast path kicks in, configured as
+  // the texture render objects' masks
+  QImage pixels(kWidth, kHeight, QImage::Format_Alpha8);
+  for (int row = 0; row < kHeight; ++row) {
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32*>(pixels.scanLine(row)),
+                                          kWidth / 4);
+  }
+  QOpenGLTexture maskTexture(QOpenGLTexture::Target2D);
+  maskTexture.setSize(kWidth, kHeight);
+  maskTexture.setFormat(QOpenGLTexture::R8_UNorm);
+  maskTexture.allocateStorage();
+  maskTexture.setMinificationFilter(QOpenGLTexture::Linear);
+  maskTexture.setMagnificationFilter(QOpenGLTexture::Linear);
+  maskTexture.setBorderColor(Qt::transparent);
+  maskTexture.setWrapMode(QOpenGLTexture::WrapMode::ClampToBorder);
+  maskTexture.setData(0, 0, 0, kWidth, kHeight, 0, 0, QOpenGLTexture::Red,
+                      QOpenGLTexture::UInt8, static_cast<const void*>(pixels.constBits()));
+
+  QOpenGLFramebufferObjectFormat format;
+  format.setInternalTextureFormat(GL_R8);
+  QOpenGLFramebufferObject referenceFramebuffer(kWidth, kHeight, format);
+  QOpenGLFramebufferObject rowsFramebuffer(kWidth, kHeight, format);
+  QOpenGLFramebufferObject blurredFramebuffer(kWidth, kHeight, format);
+  f->glViewport(0, 0, kWidth, kHeight);
+  f->glDisable(GL_BLEND);
+  f->glDisable(GL_DEPTH_TEST);
+
+  // the reference sampling all texels of the box per pixel
+  QOpenGLShaderProgram referenceProgram;
+  if (!referenceProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, vertexShaderFile) ||
+      !referenceProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, referenceShaderFile) ||
+      !referenceProgram.link()) {
+    SPDLOG_ERROR("Unable to build the mask blur reference shader: {}", referenceProgram.log());
+    return;
+  }
+  auto& unitQuad = UnitQuad::forCurrentContext();
+  const auto drawReference = [&](const MaskBlur::Parameters& parameters) {
+    referenceFramebuffer.bind();
+    referenceProgram.bind();
+    referenceProgram.setUniformValue("maskTexture", 0);
+    referenceProgram.setUniformValue("blurKernelSize", parameters.radius);
+    referenceProgram.setUniformValue("isPostProcessingEnabled", parameters.sharpness != 0.f);
+    referenceProgram.setUniformValue("sharpnessValue", parameters.sharpness);
+    f->glActiveTexture(GL_TEXTURE0);
+    maskTexture.bind();
+    unitQuad.draw();
+    referenceProgram.release();
+  };
+  const auto drawSeparable = [&](const MaskBlur::Parameters& parameters) {
+    MaskBlur::drawPass(maskTexture.textureId(), GL_TEXTURE_2D, parameters,
+                       MaskBlur::Direction::Horizontal, rowsFramebuffer);
+    MaskBlur::drawPass(rowsFramebuffer.texture(), GL_TEXTURE_2D, parameters,
+                       MaskBlur::Direction::Vertical, blurredFramebuffer);
+  };
+  // returns the milliseconds per blur
+  const auto measure = [&](const auto& blur, const MaskBlur::Parameters& parameters) {
+    // warm up, e.g. lazy shader compilation in the driver
+    blur(parameters);
+    f->glFinish();
+    QElapsedTimer timer;
+    timer.start();
+    for (int count = 0; count < kBlurCount; ++count) {
+      blur(parameters);
+    }
+    f->glFinish();
+    return std::max<qint64>(timer.nsecsElapsed(), 1) * 1e-6 / kBlurCount;
+  };
+  const auto readBack = [&](QOpenGLFramebufferObject& framebuffer) {
+    std::vector<uchar> values(static_cast<size_t>(kWidth) * kHeight);
+    framebuffer.bind();
+    f->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    f->glReadPixels(0, 0, kWidth, kHeight, GL_RED, GL_UNSIGNED_BYTE, values.data());
+    f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return values;
+  };
+
+  for (const float sharpness : {0.f, 10.f}) {
+    for (const int radius : {1, 3, 5, 10}) {
+      const MaskBlur::Parameters parameters{radius, sharpness};
+      const double referenceMs = measure(drawReference, parameters);
+      const double separableMs = measure(drawSeparable, parameters);
+      const auto referenceValues = readBack(referenceFramebuffer);
+      const auto separableValues = readBack(blurredFramebuffer);
+      int maximumDifference = 0;
+      for (size_t index = 0; index < referenceValues.size(); ++index) {
+        maximumDifference = std::max(maximumDifference,
+                                     std::abs(referenceValues[index] - separableValues[index]));
+      }
+      SPDLOG_INFO("> radius {}{}: {:.2f} ms per blur, separable {:.2f} ms (speedup {:.2f}), "
+                  "maximum difference {}",
+                  radius, sharpness != 0.f ? " with sigmoid" : "", referenceMs, separableMs,
+                  referenceMs / separableMs, maximumDifference);
+      if (maximumDifference > kToleranceLevels) {
+        SPDLOG_WARN("> separable blur differs by more than {} levels", kToleranceLevels);
+      }
+    }
+  }
+
+  blurredFramebuffer.release();
+  f->glEnable(GL_BLEND);
+}
+
+void RenderBenchmarks::batchedDraws() {
+  auto* context = QOpenGLContext::currentContext();
+  if (!context) {
+    SPDLOG_ERROR("Batched draws benchmark requires a current OpenGL context");
+    return;
+  }
+  auto* f = context->functions();
+  SPDLOG_INFO("Benchmark: batched draws on {}",
+              reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kFrameCount = 50;
+  // e.g. thumbnails, every object has its own texture
+  constexpr int kColumnCount = 40;
+  constexpr int kRowCount = 25;
+  constexpr int kTextureSize = 64;
+
+  // the objects in draw order, each filling a cell of the grid in clip space
+  std::vector<std::shared_ptr<TextureRenderObject>> renderObjects;
+  for (int row = 0; row < kRowCount; ++row) {
+    for (int column = 0; column < kColumnCount; ++column) {
+      QImage pixels(kTextureSize, kTextureSize, QImage::Format_RGBA8888_Premultiplied);
+      pixels.fill(QColor::fromRgb(QRandomGenerator::global()->generate()));
+      auto renderObject = std::make_shared<TextureRenderObject>(
+          TextureRenderObject::TextureTarget::Target2D, pixels);
+      QMatrix4x4 model;
+      model.translate(-1.f + (2.f * column + 1.f) / kColumnCount,
+                      -1.f + (2.f * row + 1.f) / kRowCount);
+      model.scale(1.f / kColumnCount, 1.f / kRowCount);
+      renderObject->setModelMatrix(model);
+      renderObject->prepare(QMatrix4x4(), 0);
+      renderObjects.push_back(std::move(renderObject));
+    }
+  }
+
+  QOpenGLFramebufferObject framebuffer(kWidth, kHeight);
+  if (!framebuffer.bind()) {
+    SPDLOG_ERROR("Unable to bind benchmark framebuffer");
+    return;
+  }
+  f->glViewport(0, 0, kWidth, kHeight);
+  f->glDisable(GL_DEPTH_TEST);
+  f->glEnable(GL_BLEND);
+  f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  auto& uniformBufferRing = UniformBufferRing::forCurrentContext();
+  RenderBatcher batcher;
+  const auto drawFrame = [&](bool batched) {
+    uniformBufferRing.beginFrame(QMatrix4x4());
+    f->glClear(GL_COLOR_BUFFER_BIT);
+    for (const auto& renderObject : renderObjects) {
+      renderObject->submit(batcher);
+      // a batch per texture, as before the texture slots
+      if (!batched) {
+        batcher.flush();
+      }
+    }
+    batcher.endFrame();
+    uniformBufferRing.endFrame();
+  };
+  // returns the milliseconds per frame, the draw calls of a frame, and the last frame
+  const auto measure = [&](bool batched) {
+    // warm up, e.g. lazy shader compilation in the driver
+    drawFrame(batched);
+    f->glFinish();
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+      drawFrame(batched);
+    }
+    f->glFinish();
+    const double frameMs = std::max<qint64>(timer.nsecsElapsed(), 1) * 1e-6 / kFrameCount;
+    return std::tuple{frameMs, batcher.lastFrameStatistics().drawCallCount, framebuffer.toImage()};
+  };
+
+  const auto [unbatchedMs, unbatchedDrawCalls, unbatchedImage] = measure(false);
+  const auto [batchedMs, batchedDrawCalls, batchedImage] = measure(true);
+  SPDLOG_INFO("> {} objects: {} draw calls {:.2f} ms, batched {} draw calls {:.2f} ms per frame "
+              "(speedup {:.2f}), results {}",
+              renderObjects.size(), unbatchedDrawCalls, unbatchedMs, batchedDrawCalls, batchedMs,
+              unbatchedMs / batchedMs, unbatchedImage == batchedImage ? "equal" : "differ");
+
+  framebuffer.release();
+}
+
+void RenderBenchmarks::antiAliasingModes(RenderObjectManager& renderObjectManager) {
+  auto* f = QOpenGLContext::currentContext()->functions();
+  SPDLOG_INFO("Benchmark: anti-aliasing modes on {}",
+              reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+
+  constexpr int kFrameCount = 50;
+  constexpr double kMegabyte = 1024.0 * 1024.0;
+  using AntiAliasing = RenderObjectManager::AntiAliasing;
+  const AntiAliasing antiAliasing = renderObjectManager.antiAliasing();
+  const bool isPartialRenderingEnabled = renderObjectManager.isPartialRenderingEnabled();
+  const bool isDynamicResolutionEnabled = renderObjectManager.isDynamicResolutionEnabled();
+  const double frameTimeBudgetMs = renderObjectManager.frameTimeBudgetMs();
+  // every frame is rendered completely at full resolution
+  renderObjectManager.setPartialRenderingEnabled(false);
+  renderObjectManager.setDynamicResolutionEnabled(false, frameTimeBudgetMs);
+  double referenceMs = 0.0;
+  for (const AntiAliasing mode : {AntiAliasing::Off, AntiAliasing::Msaa2x, AntiAliasing::Msaa4x,
+                                  AntiAliasing::Msaa8x, AntiAliasing::Fxaa}) {
+    renderObjectManager.setAntiAliasing(mode);
+    // the first frame acquires the intermediate targets
+    renderObjectManager.render();
+    f->glFinish();
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+      renderObjectManager.render();
+    }
+    f->glFinish();
+    const double frameMs = timer.nsecsElapsed() / 1e6 / kFrameCount;
+    if (mode == AntiAliasing::Off) {
+      referenceMs = frameMs;
+    }
+    SPDLOG_INFO("> {}: {:.2f} ms per frame ({:+.2f} ms), framebuffers {:.1f} MB, pooled targets "
+                "{:.1f} MB",
+                RenderObjectManager::name(mode), frameMs, frameMs - referenceMs,
+                renderObjectManager.framebufferByteCount() / kMegabyte,
+                RenderTargetPool::forCurrentContext().statistics().byteCount / kMegabyte);
+  }
+  renderObjectManager.setAntiAliasing(antiAliasing);
+  renderObjectManager.setPartialRenderingEnabled(isPartialRenderingEnabled);
+  renderObjectManager.setDynamicResolutionEnabled(isDynamicResolutionEnabled, frameTimeBudgetMs);
+}
+
+void RenderBenchmarks::objectStateContention() {
+  SPDLOG_INFO("Benchmark: object state contention");
+  constexpr int kReadCount = 20000;
+  // the writer's work while changing the state, e.g. allocating and filling a texture
+  constexpr qint64 kWriteWorkNs = 200'000;
+  // the size of a texture render object's draw state
+  struct State {
+    quint32 texture = 0;
+    quint32 maskTexture = 0;
+    UniformBufferRing::ObjectUniforms uniforms{};
+  };
+
+  // returns the mean and the maximum read time in microseconds while the writer runs
+  const auto measure = [](const auto& write, const auto& read) {
+    std::atomic<bool> isDone = false;
+    std::unique_ptr<QThread> writer(QThread::create([&]() {
+      for (quint32 texture = 1; !isDone.load(std::memory_order_relaxed); ++texture) {
+        write(texture);
+      }
+    }));
+    writer->start();
+    qint64 totalNs = 0;
+    qint64 maximumNs = 0;
+    quint32 checksum = 0;
+    QElapsedTimer timer;
+    for (int count = 0; count < kReadCount; ++count) {
+      timer.start();
+      checksum += read().texture;
+      const qint64 elapsedNs = timer.nsecsElapsed();
+      totalNs += elapsedNs;
+      maximumNs = std::max(maximumNs, elapsedNs);
+    }
+    isDone = true;
+    writer->wait();
+    SPDLOG_DEBUG("> checksum {}", checksum);
+    return std::pair{totalNs * 1e-3 / kReadCount, maximumNs * 1e-3};
+  };
+  const auto work = []() {
+    QElapsedTimer workTimer;
+    workTimer.start();
+    while (workTimer.nsecsElapsed() < kWriteWorkNs) {
+    }
+  };
+
+  // the writer changes the state while holding the mutex
+  QMutex mutex;
+  State lockedState;
+  const auto [lockedMeanUs, lockedMaximumUs] = measure(
+      [&](quint32 texture) {
+        QMutexLocker locker(&mutex);
+        work();
+        lockedState.texture = texture;
+      },
+      [&]() {
+        QMutexLocker locker(&mutex);
+        return lockedState;
+      });
+
+  // the writer prepares the state and publishes it when complete
+  TripleBuffer<State> tripleBuffer;
+  const auto [tripleBufferMeanUs, tripleBufferMaximumUs] = measure(
+      [&](quint32 texture) {
+        work();
+        State state;
+        state.texture = texture;
+        tripleBuffer.publish(state);
+      },
+      [&]() {
+        tripleBuffer.acquire();
+        return tripleBuffer.read();
+      });
+
+  SPDLOG_INFO("> mutex: mean {:.3f} us, maximum {:.1f} us per read", lockedMeanUs,
+              lockedMaximumUs);
+  SPDLOG_INFO("> triple buffer: mean {:.3f} us, maximum {:.1f} us per read", tripleBufferMeanUs,
+              tripleBufferMaximumUs);
+}
+
+void RenderBenchmarks::transformGraphUpdate() {
+  SPDLOG_INFO("Benchmark: transform graph update");
+  constexpr int kGroupCount = 10;
+  constexpr int kObjectsPerGroup = 1000;
+  constexpr int kFrameCount = 200;
+
+  TransformGraph graph;
+  std::vector<TransformGraph::NodeId> groups;
+  for (int group = 0; group < kGroupCount; ++group) {
+    groups.push_back(graph.addNode());
+    for (int object = 0; object < kObjectsPerGroup; ++object) {
+      const auto node = graph.addNode(groups.back());
+      TransformGraph::Transform transform;
+      transform.translation = QVector3D(0.001f * object, 0.f, 0.f);
+      graph.setTransform(node, transform);
+    }
+  }
+  graph.update();
+
+  // returns the microseconds per frame and the number of changed nodes per frame
+  const auto measure = [&](int animatedGroupCount) {
+    QElapsedTimer timer;
+    timer.start();
+    size_t changedCount = 0;
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+      TransformGraph::Transform transform;
+      transform.rotation = QQuaternion::fromAxisAndAngle(0.f, 0.f, 1.f, frame * 0.5f);
+      for (int group = 0; group < animatedGroupCount; ++group) {
+        graph.setTransform(groups[group], transform);
+      }
+      changedCount += graph.update().size();
+    }
+    const double frameUs = timer.nsecsElapsed() * 1e-3 / kFrameCount;
+    return std::pair{frameUs, changedCount / kFrameCount};
+  };
+  const auto [oneGroupUs, oneGroupChangedCount] = measure(1);
+  const auto [allGroupsUs, allGroupsChangedCount] = measure(kGroupCount);
+  SPDLOG_INFO("> {} groups of {} objects: one group {:.1f} us ({} nodes), all groups {:.1f} us "
+              "({} nodes) per update",
+              kGroupCount, kObjectsPerGroup, oneGroupUs, oneGroupChangedCount, allGroupsUs,
+              allGroupsChangedCount);
+}
+
+void RenderBenchmarks::spatialIndexQueries() {
+  SPDLOG_INFO("Benchmark: spatial index queries");
+  constexpr float kWorldSize = 1000.f;
+  constexpr int kQueryCount = 1000;
+  constexpr int kFrameCount = 20;
+
+  for (const int objectCount : {10000, 100000}) {
+    auto* random = QRandomGenerator::global();
+    const auto uniform = [random](float minimum, float maximum) {
+      return minimum + static_cast<float>(random->generateDouble()) * (maximum - minimum);
+    };
+    std::vector<SpatialIndex::Box> boxes;
+    boxes.reserve(objectCount);
+    for (int object = 0; object < objectCount; ++object) {
+      const QVector3D minimum(uniform(0.f, kWorldSize), uniform(0.f, kWorldSize), 0.f);
+      boxes.push_back({minimum, minimum + QVector3D(uniform(1.f, 10.f), uniform(1.f, 10.f), 0.f)});
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    SpatialIndex index;
+    std::vector<SpatialIndex::ProxyId> proxies;
+    proxies.reserve(objectCount);
+    for (const auto& box : boxes) {
+      proxies.push_back(index.insert(box, nullptr));
+    }
+    const double buildMs = timer.nsecsElapsed() * 1e-6;
+
+    // small movements of a tenth of the objects per frame, most stay within their fat boxes
+    timer.restart();
+    int reinsertedCount = 0;
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+      for (int object = frame % 10; object < objectCount; object += 10) {
+        const QVector3D offset(uniform(-1.f, 1.f), uniform(-1.f, 1.f), 0.f);
+        boxes[object] = {boxes[object].minimum + offset, boxes[object].maximum + offset};
+        reinsertedCount += index.move(proxies[object], boxes[object]) ? 1 : 0;
+      }
+    }
+    const double moveMs = timer.nsecsElapsed() * 1e-6 / kFrameCount;
+
+    // returns the microseconds per query of the index and of the linear scan, and whether both
+    // found the same number of objects
+    std::vector<SpatialIndex::ProxyId> results;
+    const auto measure = [&](const auto& queryIndex, const auto& overlaps) {
+      size_t indexCount = 0;
+      timer.restart();
+      for (int query = 0; query < kQueryCount; ++query) {
+        results.clear();
+        queryIndex(query, &results);
+        indexCount += results.size();
+      }
+      const double indexUs = timer.nsecsElapsed() * 1e-3 / kQueryCount;
+      size_t linearCount = 0;
+      timer.restart();
+      for (int query = 0; query < kQueryCount; ++query) {
+        for (const auto& box : boxes) {
+          linearCount += overlaps(query, box) ? 1 : 0;
+        }
+      }
+      const double linearUs = timer.nsecsElapsed() * 1e-3 / kQueryCount;
+      return std::tuple{indexUs, linearUs, indexCount == linearCount};
+    };
+
+    std::vector<QPointF> points;
+    std::vector<QRectF> rects;
+    std::vector<QMatrix4x4> viewProjections;
+    for (int query = 0; query < kQueryCount; ++query) {
+      points.emplace_back(uniform(0.f, kWorldSize), uniform(0.f, kWorldSize));
+      rects.emplace_back(uniform(0.f, kWorldSize), uniform(0.f, kWorldSize), 50., 50.);
+      // a view of a fifth of the world
+      const float left = uniform(0.f, 0.8f * kWorldSize);
+      const float bottom = uniform(0.f, 0.8f * kWorldSize);
+      viewProjections.emplace_back();
+      viewProjections.back().ortho(left, left + 0.2f * kWorldSize, bottom,
+                                   bottom + 0.2f * kWorldSize, -1.f, 1.f);
+    }
+    const auto [pointUs, linearPointUs, pointMatches] = measure(
+        [&](int query, auto* results) { index.queryPoint(points[query], results); },
+        [&](int query, const SpatialIndex::Box& box) {
+          const auto& point = points[query];
+          return box.minimum.x() <= point.x() && point.x() <= box.maximum.x() &&
+                 box.minimum.y() <= point.y() && point.y() <= box.maximum.y();
+        });
+    const auto [rectUs, linearRectUs, rectMatches] = measure(
+        [&](int query, auto* results) { index.queryRect(rects[query], results); },
+        [&](int query, const SpatialIndex::Box& box) {
+          const auto& rect = rects[query];
+          return box.minimum.x() <= rect.right() && rect.left() <= box.maximum.x() &&
+                 box.minimum.y() <= rect.bottom() && rect.top() <= box.maximum.y();
+        });
+    // pick rays through the points, as for a 2D view
+    const auto [rayUs, linearRayUs, rayMatches] = measure(
+        [&](int query, auto* results) {
+          const float x = static_cast<float>(points[query].x());
+          const float y = static_cast<float>(points[query].y());
+          index.querySegment(QVector3D(x, y, -1.f), QVector3D(x, y, 1.f), results);
+        },
+        [&](int query, const SpatialIndex::Box& box) {
+          const auto& point = points[query];
+          return box.minimum.x() <= point.x() && point.x() <= box.maximum.x() &&
+                 box.minimum.y() <= point.y() && point.y() <= box.maximum.y();
+        });
+    const auto [frustumUs, linearFrustumUs, frustumMatches] = measure(
+        [&](int query, auto* results) { index.queryFrustum(viewProjections[query], results); },
+        [&](int query, const SpatialIndex::Box& box) {
+          // the clip space bounds of the flat box's corners
+          const auto& viewProjection = viewProjections[query];
+          const QVector3D minimum = viewProjection.map(box.minimum);
+          const QVector3D maximum = viewProjection.map(box.maximum);
+          return minimum.x() <= 1.f && maximum.x() >= -1.f && minimum.y() <= 1.f &&
+                 maximum.y() >= -1.f;
+        });
+
+    SPDLOG_INFO("> {} objects: build {:.1f} ms (height {}), moving a tenth {:.2f} ms per frame "
+                "({:.1f}% reinserted)",
+                objectCount, buildMs, index.height(), moveMs,
+                100. * reinsertedCount / (kFrameCount * objectCount / 10));
+    SPDLOG_INFO(">   point: index {:.2f} us, linear {:.1f} us per query{}", pointUs, linearPointUs,
+                pointMatches ? "" : " (results differ)");
+    SPDLOG_INFO(">   rectangle: index {:.2f} us, linear {:.1f} us per query{}", rectUs,
+                linearRectUs, rectMatches ? "" : " (results differ)");
+    SPDLOG_INFO(">   pick ray: index {:.2f} us, linear {:.1f} us per query{}", rayUs, linearRayUs,
+                rayMatches ? "" : " (results differ)");
+    SPDLOG_INFO(">   frustum: index {:.2f} us, linear {:.1f} us per query{}", frustumUs,
+                linearFrustumUs, frustumMatches ? "" : " (results differ)");
+  }
+}
+
+}  // namespace nimagna
@@ -0,0 +1,144 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/RenderGraph.h"
+
+namespace nimagna {
+
+void RenderGraph::reset() {
+  mTargets.clear();
+  mPasses.clear();
+}
+
+RenderGraph::TargetId RenderGraph::importTarget(const QString& name,
+                                                QOpenGLFramebufferObject* framebuffer) {
+  assert(framebuffer);
+  Target target;
+  target.name = name;
+  target.description.size = framebuffer->size();
+  target.description.internalFormat = framebuffer->format().internalTextureFormat();
+  target.description.textureTarget = framebuffer->format().textureTarget();
+  target.description.samples = framebuffer->format().samples();
+  target.framebuffer = framebuffer;
+  target.isImported = true;
+  mTargets.push_back(std::move(target));
+  return static_cast<TargetId>(mTargets.size()) - 1;
+}
+
+RenderGraph::TargetId RenderGraph::createTarget(const QString& name,
+                                                const RenderTargetPool::Description& description) {
+  Target target;
+  target.name = name;
+  target.description = description;
+  mTargets.push_back(std::move(target));
+  return static_cast<TargetId>(mTargets.size()) - 1;
+}
+
+void RenderGraph::addPass(const QString& name, std::vector<TargetId> inputs,
+                          std::vector<TargetId> outputs, Execute execute) {
+  const int pass = static_cast<int>(mPasses.size());
+  for (const TargetId input : inputs) {
+    // the passes run in the order they were added: the content must be written before
+    if (!isValid(input) || (!mTargets[input].isImported && mTargets[input].writer == kNoPass)) {
+      SPDLOG_ERROR("Render pass {} reads target {} before it is written", name, input);
+      return;
+    }
+  }
+  for (const TargetId output : outputs) {
+    if (!isValid(output) || mTargets[output].writer != kNoPass) {
+      SPDLOG_ERROR("Render pass {} writes target {} written by another pass", name, output);
+      return;
+    }
+  }
+  for (const TargetId output : outputs) {
+    mTargets[output].writer = pass;
+  }
+  mPasses.push_back({name, std::move(inputs), std::move(outputs), std::move(execute)});
+}
+
+void RenderGraph::execute(RenderTargetPool& pool) {
+  mStatistics = {};
+  mStatistics.passCount = static_cast<int>(mPasses.size());
+  cull();
+  for (auto& pass : mPasses) {
+    if (pass.referenceCount == 0) {
+      ++mStatistics.culledPassCount;
+      continue;
+    }
+    for (const TargetId output : pass.outputs) {
+      auto& target = mTargets[output];
+      if (!target.isImported) {
+        target.framebuffer = pool.acquire(target.description);
+        ++mStatistics.acquiredTargetCount;
+      }
+    }
+    pass.execute(*this);
+    // the targets no later pass reads go back to the pool for the next passes
+    for (const TargetId input : pass.inputs) {
+      auto& target = mTargets[input];
+      if (--target.readerCount == 0 && !target.isImported) {
+        pool.recycle(target.framebuffer);
+        target.framebuffer = nullptr;
+      }
+    }
+    for (const TargetId output : pass.outputs) {
+      auto& target = mTargets[output];
+      if (target.readerCount == 0 && !target.isImported && target.framebuffer) {
+        pool.recycle(target.framebuffer);
+        target.framebuffer = nullptr;
+      }
+    }
+  }
+  for (const auto& target : mTargets) {
+    if (!target.isImported) {
+      ++mStatistics.transientTargetCount;
+    }
+  }
+}
+
+QOpenGLFramebufferObject* RenderGraph::framebuffer(TargetId target) const {
+  assert(isValid(target));
+  return mTargets[target].framebuffer;
+}
+
+void RenderGraph::cull() {
+  for (auto& target : mTargets) {
+    target.readerCount = 0;
+  }
+  for (const auto& pass : mPasses) {
+    for (const TargetId input : pass.inputs) {
+      ++mTargets[input].readerCount;
+    }
+  }
+  // a pass is referenced by its outputs that are read or kept after the frame
+  std::vector<int> unreferencedPasses;
+  for (int pass = 0; pass < static_cast<int>(mPasses.size()); ++pass) {
+    auto& referenceCount = mPasses[pass].referenceCount;
+    referenceCount = 0;
+    for (const TargetId output : mPasses[pass].outputs) {
+      if (mTargets[output].isImported || mTargets[output].readerCount > 0) {
+        ++referenceCount;
+      }
+    }
+    if (referenceCount == 0) {
+      unreferencedPasses.push_back(pass);
+    }
+  }
+  // a culled pass does not read its inputs, which may leave their writers unreferenced
+  while (!unreferencedPasses.empty()) {
+    const int pass = unreferencedPasses.back();
+    unreferencedPasses.pop_back();
+    for (const TargetId input : mPasses[pass].inputs) {
+      auto& target = mTargets[input];
+      if (--target.readerCount > 0 || target.isImported || target.writer == kNoPass) continue;
+      if (--mPasses[target.writer].referenceCount == 0) {
+        unreferencedPasses.push_back(target.writer);
+      }
+    }
+  }
+}
+
+bool RenderGraph::isValid(TargetId target) const {
+  return target >= 0 && target < static_cast<TargetId>(mTargets.size());
+}
+
+}  // namespace nimagna
@@ -2,6 +2,7 @@
 
 #include "Rendering/RenderObject.h"
 
+#include "Rendering/RenderBatcher.h"
 
 namespace nimagna {
 
@@ -11,8 +12,17 @@ void RenderObject::initialize() {
   mIsInitialized = true;
 }
 
-void RenderObject::prepare(const QMatrix4x4& vp) {
+void RenderObject::prepare(const QMatrix4x4& vp, qint64 renderTimestampUs) {
   mViewProjectionMatrix = vp;
+  mRenderTimestampUs = renderTimestampUs;
+  // before subclasses take their state: a change published meanwhile is drawn next frame again
+  mFrameContentVersion = contentVersion();
+}
+
+void RenderObject::submit(RenderBatcher& batcher) {
+  // keep the draw order
+  batcher.flush();
+  draw();
 }
 
 float RenderObject::alpha() const {
@@ -21,12 +31,21 @@ float RenderObject::alpha() const {
 
 void RenderObject::setFallbackAlpha(float alphaValue) {
   mFallbackAlpha = std::clamp(alphaValue, 0.0f, 1.0f);
+  markContentChanged();
 }
 
 const QMatrix4x4& RenderObject::getModelMatrix() const {
   return mModelMatrix;
 }
 
+void RenderObject::setModelMatrix(const QMatrix4x4& modelMatrix) {
+  if (modelMatrix == mModelMatrix) return;
+  mModelMatrix = modelMatrix;
+  // e.g. a rotation may keep the screen rectangle
+  markContentChanged();
+  emit propertiesChanged();
+}
+
 void RenderObject::setDisplayName(const QString& displayName) {
   SPDLOG_INFO("Set display name: {}", displayName.toStdString());
   mDisplayName = displayName;
@@ -2,9 +2,22 @@
 
 #include "Rendering/RenderObjectManager.h"
 
+#include "Rendering/FrameSourceRenderObject.h"
+#include "Rendering/ImageDecoder.h"
+#include "Rendering/ImageSequenceRenderObject.h"
+#include "Rendering/MaskBlur.h"
+#include "Rendering/RenderTargetPool.h"
+#include "Rendering/ShaderProgramCache.h"
+#include "Rendering/UniformBufferRing.h"
+#include "Rendering/UnitQuad.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QThread>
 #include <QtGui/QPainter>
 #include <QtOpenGL/QOpenGLPaintDevice>
+#include <algorithm>
+#include <cmath>
 
 namespace nimagna {
 
@@ -47,9 +60,17 @@ void RenderObjectManager::initialize(std::shared_ptr<QOpenGLContext> context,
   // turn on debugging if enabled
   changeOpenGlDebugging(true);
 #endif
+  SPDLOG_INFO("> Warm up shader programs");
+  auto shaderProgramKeys = TextureRenderObject::shaderProgramKeys();
+  const auto maskBlurKeys = MaskBlur::shaderProgramKeys();
+  shaderProgramKeys.insert(shaderProgramKeys.end(), maskBlurKeys.begin(), maskBlurKeys.end());
+  const auto fxaaKeys = FxaaEffect::shaderProgramKeys();
+  shaderProgramKeys.insert(shaderProgramKeys.end(), fxaaKeys.begin(), fxaaKeys.end());
+  ShaderProgramCache::warmUp(shaderProgramKeys);
   SPDLOG_INFO("> Create FBO and co.");
   // create FBO
   onOutputSettingsChanged();
+  mRenderClock.start();
   mIsInitialized = true;
   SPDLOG_INFO("> Render once");
   render();
@@ -68,6 +89,19 @@ void RenderObjectManager::cleanUp() {
   // clean up all render objects
   SPDLOG_INFO("> clear objects...");
   clearRenderObjects();
+  // release the shader programs shared by the render objects
+  const auto shaderStatistics = ShaderProgramCache::statistics();
+  SPDLOG_INFO("> release shader programs ({} compiled in {:.1f} ms, {} reused)...",
+              shaderStatistics.compileCount, shaderStatistics.compileTimeUs / 1000.0,
+              shaderStatistics.cacheHitCount);
+  ShaderProgramCache::releasePrograms(mContext.get());
+  UniformBufferRing::release(mContext.get());
+  UnitQuad::release(mContext.get());
+  RenderTargetPool::release(mContext.get());
+  for (auto& frameTimer : mFrameTimers) {
+    frameTimer.query.reset();
+    frameTimer.isPending = false;
+  }
   // release all objects
   if (mRenderFramebuffer) {
     SPDLOG_INFO("> release frame buffer...");
@@ -111,35 +145,194 @@ bool RenderObjectManager::tryMakeOpenGlContextCurrent(bool isCritical) {
 bool RenderObjectManager::render() {
   if (!isInitialized()) return false;
 
-  // activate offscreen context with framebuffer as target
+  // activate offscreen context
   tryMakeOpenGlContextCurrent(false);
-  const bool multisamplingRendering = true;
-  if (multisamplingRendering) {
-    mMultisampleFramebuffer->bind();
-  } else {
-    mRenderFramebuffer->bind();
-  }
-
+  const bool multisamplingRendering =
+      mSceneFramebuffer && mSceneFramebuffer->format().samples() > 0;
   glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // the scene is drawn into the bottom left of its target at the resolution scale
+  updateResolutionScale();
+  const QSize sceneSize = mResolutionScaler.scaledSize(mCurrentOutputResolution);
+  const bool isScaled = sceneSize != mCurrentOutputResolution;
+
+  // the full-frame effects of this frame, anti-aliasing first
+  std::vector<PostProcessingEffect*> effects;
+  if (mAntiAliasing == AntiAliasing::Fxaa) {
+    effects.push_back(&mFxaaEffect);
+  }
+  for (const auto& effect : mPostProcessingEffects) {
+    if (effect->isEnabled()) {
+      effects.push_back(effect.get());
+    }
+  }
+  // the output of other effects is no longer valid anywhere
+  if (effects != mAppliedPostProcessingEffects) {
+    mDamageTracker.invalidate();
+    mAppliedPostProcessingEffects = effects;
+  }
+  // the scene is drawn into the scene framebuffer, straight into the render framebuffer, or into
+  // an intermediate target for the effects or the upscale. Only the first two keep their content.
+  const bool isSceneKept = mSceneFramebuffer || (effects.empty() && !isScaled);
 
   // render objects only if there's render data for the projection and the list has more than one
   // object (i.e. storyboard + more) or the storyboard is the only item and has content
+  mImageFileRefresher.uploadChangedTiles();
+  // the regions re-rendered in this frame, the framebuffers keep their content elsewhere
+  const std::vector<QRect>* damageRects = &mFullFrameRects;
+  mFullFrameRects.assign(1, QRect(QPoint(0, 0), mCurrentOutputResolution));
+  const std::vector<RenderQueue::Entry>* renderQueue = nullptr;
   if (mCurrentRenderData && (mRenderObjectsList.size() > 0)) {
     // get projection from shot
     const QMatrix4x4 projectionMatrix = mCurrentRenderData->projectionMatrix();
-    for (const auto& renderObject : mRenderObjectsList) {
-      renderObject->prepare(projectionMatrix);
-      renderObject->draw();
+    const qint64 renderTimestampUs = mRenderClock.nsecsElapsed() / 1000;
+    // the view/projection matrix is shared by all objects, their uniforms follow in the same ring
+    UniformBufferRing::forCurrentContext().beginFrame(projectionMatrix, mOpaquePassEnabled);
+    // in layer and depth order, consecutive compatible objects are drawn with one instanced draw
+    // call. Objects that are off-screen or invisible are skipped.
+    updateTransforms();
+    renderQueue = &mRenderQueue.update(projectionMatrix);
+    // the objects take the state of the frame before they are culled
+    for (const auto& [renderObject, sortKey] : *renderQueue) {
+      renderObject->prepare(projectionMatrix, renderTimestampUs);
+    }
+    updateSpatialIndex();
+    mVisibilityCuller.cull(*renderQueue, projectionMatrix, &mVisibleRenderObjects);
+    // the content due in this frame is uploaded before the damage is known. Every object advances
+    // its clock and queues, only the visible ones upload.
+    for (size_t index = 0; index < renderQueue->size(); ++index) {
+      (*renderQueue)[index].renderObject->updateContent(mVisibleRenderObjects[index] != 0);
+    }
+    mOcclusionCuller.cull(*renderQueue, projectionMatrix, mCurrentOutputResolution,
+                          &mVisibleRenderObjects);
+    updatePickableObjects(*renderQueue);
+    // in 2D mode, only the regions of objects that changed are re-rendered
+    if (!mPartialRenderingEnabled || !mCurrentRenderData->is2D() || !isSceneKept || isScaled) {
+      mDamageTracker.invalidate();
+    }
+    damageRects = &mDamageTracker.update(*renderQueue, mVisibleRenderObjects, projectionMatrix,
+                                         mCurrentOutputResolution);
+  } else {
+    // the next frame with objects starts from scratch
+    mDamageTracker.invalidate();
+  }
+
+  // the passes of the frame: the effects read the whole frame, the output is written only where
+  // it changed if there are none
+  mRenderGraph.reset();
+  const auto output = mRenderGraph.importTarget("output", mRenderFramebuffer.get());
+  RenderTargetPool::Description frameDescription;
+  frameDescription.size = mCurrentOutputResolution;
+  frameDescription.textureTarget = TextureRenderObject::qGlTarget(mRenderFramebufferTarget);
+  RenderGraph::TargetId scene = output;
+  if (mSceneFramebuffer) {
+    scene = mRenderGraph.importTarget("scene", mSceneFramebuffer.get());
+  } else if (!effects.empty() || isScaled) {
+    RenderTargetPool::Description sceneDescription = frameDescription;
+    // the depth buffer of the opaque pass
+    sceneDescription.hasDepth = true;
+    scene = mRenderGraph.createTarget("scene", sceneDescription);
+  }
+  // the passes of the objects preparing what they draw. Those of objects outside the damaged
+  // regions are not read by the scene and culled, except those updating targets the objects keep.
+  std::vector<RenderGraph::TargetId> sceneInputs;
+  std::vector<RenderGraph::TargetId> objectTargets;
+  for (size_t index = 0; renderQueue && index < renderQueue->size(); ++index) {
+    if (!mVisibleRenderObjects[index]) continue;
+    objectTargets.clear();
+    (*renderQueue)[index].renderObject->addPasses(mRenderGraph, &objectTargets);
+    const QRect& screenRect = mDamageTracker.screenRect(index);
+    if (std::any_of(damageRects->begin(), damageRects->end(),
+                    [&screenRect](const QRect& rect) { return rect.intersects(screenRect); })) {
+      sceneInputs.insert(sceneInputs.end(), objectTargets.begin(), objectTargets.end());
     }
   }
+  mRenderGraph.addPass("scene", std::move(sceneInputs), {scene}, [&](const RenderGraph& graph) {
+    graph.framebuffer(scene)->bind();
+    glViewport(0, 0, sceneSize.width(), sceneSize.height());
+    if (renderQueue) {
+      drawRenderQueue(*renderQueue, *damageRects);
+    } else {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    glViewport(0, 0, mCurrentOutputResolution.width(), mCurrentOutputResolution.height());
+  });
+  RenderGraph::TargetId result = scene;
+  // the scene goes straight into the output unless it is followed by the upscale or the effects
+  const bool isResolvedIntoOutput = effects.empty() && !isScaled;
+  const std::vector<QRect> sceneRects{QRect(QPoint(0, 0), sceneSize)};
+  if (multisamplingRendering || (mSceneFramebuffer && isResolvedIntoOutput)) {
+    // resolve the multisampling framebuffer (the effects read single-sampled textures) or copy
+    // the scene, only the re-rendered regions into the output
+    const auto resolved = isResolvedIntoOutput
+                              ? output
+                              : mRenderGraph.createTarget("resolved", frameDescription);
+    mRenderGraph.addPass("resolve", {scene}, {resolved}, [&, resolved](const RenderGraph& graph) {
+      const auto& resolveRects = isResolvedIntoOutput ? *damageRects : sceneRects;
+      for (const QRect& rect : resolveRects) {
+        QOpenGLFramebufferObject::blitFramebuffer(graph.framebuffer(resolved), rect,
+                                                  graph.framebuffer(scene), rect,
+                                                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+      }
+    });
+    result = resolved;
+  }
+  if (isScaled) {
+    // upscale the scene to the frame, multisampled framebuffers cannot be blitted scaled
+    const auto upscaled =
+        effects.empty() ? output : mRenderGraph.createTarget("upscaled", frameDescription);
+    mRenderGraph.addPass("upscale", {result}, {upscaled},
+                         [&, source = result, upscaled](const RenderGraph& graph) {
+                           QOpenGLFramebufferObject::blitFramebuffer(
+                               graph.framebuffer(upscaled), mFullFrameRects.front(),
+                               graph.framebuffer(source), sceneRects.front(),
+                               GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                         });
+    result = upscaled;
+  }
+  // the effects ping-pong between two pooled targets, the last one draws into the output
+  for (size_t index = 0; index < effects.size(); ++index) {
+    const auto input = result;
+    result = index + 1 == effects.size()
+                 ? output
+                 : mRenderGraph.createTarget(effects[index]->name(), frameDescription);
+    mRenderGraph.addPass(effects[index]->name(), {input}, {result},
+                         [effect = effects[index], input, result](const RenderGraph& graph) {
+                           graph.framebuffer(result)->bind();
+                           glDisable(GL_BLEND);
+                           effect->apply(*graph.framebuffer(input));
+                           glEnable(GL_BLEND);
+                         });
+  }
+  auto& renderTargetPool = RenderTargetPool::forCurrentContext();
+  auto* frameTimer = beginFrameTimer();
+  mRenderGraph.execute(renderTargetPool);
+  if (frameTimer) {
+    frameTimer->end();
+  }
+  renderTargetPool.endFrame();
 
-  if (multisamplingRendering) {
-    // blit the multisampling framebuffer to the render framebuffer
-    QOpenGLFramebufferObject::blitFramebuffer(
-        mRenderFramebuffer.get(), mMultisampleFramebuffer.get(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  if (renderQueue) {
+    mRenderBatcher.endFrame();
+    UniformBufferRing::forCurrentContext().endFrame();
+    const auto& batchStatistics = mRenderBatcher.lastFrameStatistics();
+    const auto& cullStatistics = mVisibilityCuller.lastFrameStatistics();
+    const auto& occlusionStatistics = mOcclusionCuller.lastFrameStatistics();
+    if (batchStatistics.drawCallCount != mLoggedDrawCallCount ||
+        cullStatistics.culledCount != mLoggedCulledCount ||
+        occlusionStatistics.occludedCount != mLoggedOccludedCount) {
+      SPDLOG_DEBUG(
+          "Drawing {} objects with {} draw calls, {} culled, {} occluded, overdraw {:.2f} ({:.2f} "
+          "without occlusion), {:.1f}% damaged",
+          batchStatistics.itemCount, batchStatistics.drawCallCount, cullStatistics.culledCount,
+          occlusionStatistics.occludedCount, occlusionStatistics.overdraw,
+          occlusionStatistics.overdrawWithoutOcclusion,
+          100.0 * mDamageTracker.lastFrameStatistics().damagedArea);
+      mLoggedDrawCallCount = batchStatistics.drawCallCount;
+      mLoggedCulledCount = cullStatistics.culledCount;
+      mLoggedOccludedCount = occlusionStatistics.occludedCount;
+    }
   }
 
   glFlush();
@@ -147,51 +340,466 @@ bool RenderObjectManager::render() {
   return true;
 }
 
+void RenderObjectManager::drawRenderQueue(const std::vector<RenderQueue::Entry>& renderQueue,
+                                          const std::vector<QRect>& damageRects) {
+  glEnable(GL_SCISSOR_TEST);
+  mDrawnRenderObjects.resize(renderQueue.size());
+  for (const QRect& damageRect : damageRects) {
+    glScissor(damageRect.x(), damageRect.y(), damageRect.width(), damageRect.height());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // the visible objects overlapping the region
+    for (size_t index = 0; index < renderQueue.size(); ++index) {
+      mDrawnRenderObjects[index] =
+          mVisibleRenderObjects[index] && mDamageTracker.screenRect(index).intersects(damageRect);
+    }
+    if (mOpaquePassEnabled) {
+      drawOpaqueAndTransparentPasses(renderQueue);
+    } else {
+      for (size_t index = 0; index < renderQueue.size(); ++index) {
+        if (mDrawnRenderObjects[index]) {
+          renderQueue[index].renderObject->submit(mRenderBatcher);
+        }
+      }
+      mRenderBatcher.flush();
+    }
+  }
+  glDisable(GL_SCISSOR_TEST);
+}
+
+void RenderObjectManager::drawRenderObjects(const std::vector<RenderQueue::Entry>& renderQueue) {
+  mDrawnRenderObjects.assign(renderQueue.size(), true);
+  if (mOpaquePassEnabled) {
+    drawOpaqueAndTransparentPasses(renderQueue);
+  } else {
+    for (const auto& entry : renderQueue) {
+      entry.renderObject->submit(mRenderBatcher);
+    }
+    mRenderBatcher.flush();
+  }
+  mRenderBatcher.endFrame();
+}
+
+void RenderObjectManager::drawOpaqueAndTransparentPasses(
+    const std::vector<RenderQueue::Entry>& renderQueue) {
+  // the depth of each object follows the draw order, later objects are in front
+  const auto drawDepth = [count = renderQueue.size()](size_t index) {
+    return 1.f - 2.f * static_cast<float>(index + 1) / static_cast<float>(count + 1);
+  };
+  mOpaqueRenderObjects.resize(renderQueue.size());
+  for (size_t index = 0; index < renderQueue.size(); ++index) {
+    mOpaqueRenderObjects[index] = renderQueue[index].renderObject->isOpaque();
+  }
+
+  // opaque objects front to back without blending: hidden fragments fail the early depth test
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+  for (size_t index = renderQueue.size(); index-- > 0;) {
+    if (mDrawnRenderObjects[index] && mOpaqueRenderObjects[index]) {
+      mRenderBatcher.setDrawDepth(drawDepth(index));
+      renderQueue[index].renderObject->submit(mRenderBatcher);
+    }
+  }
+  mRenderBatcher.flush();
+
+  // transparent objects back to front with blending, tested against but not writing the depth
+  glDepthMask(GL_FALSE);
+  glEnable(GL_BLEND);
+  for (size_t index = 0; index < renderQueue.size(); ++index) {
+    if (mDrawnRenderObjects[index] && !mOpaqueRenderObjects[index]) {
+      mRenderBatcher.setDrawDepth(drawDepth(index));
+      renderQueue[index].renderObject->submit(mRenderBatcher);
+    }
+  }
+  mRenderBatcher.flush();
+  glDepthMask(GL_TRUE);
+  glDisable(GL_DEPTH_TEST);
+  mRenderBatcher.setDrawDepth(0.f);
+}
+
 const RenderObjectManager::RenderObjectList& RenderObjectManager::renderObjects() const {
   return mRenderObjectsList;
 }
 
 void RenderObjectManager::clearRenderObjects() {
+  mImageFileRefresher.clear();
+  for (const auto& renderObject : mRenderObjectsList) {
+    mTransformGraph.removeNode(renderObject->transformNode());
+    renderObject->setTransformNode(TransformGraph::kNoNode);
+  }
+  mTransformNodeRenderObjects.clear();
+  mDamageTracker.invalidate();
+  {
+    QMutexLocker locker(&mSpatialIndexMutex);
+    mSpatialIndex.clear();
+    mSpatialIndexEntries.clear();
+  }
   mRenderObjectsList.clear();
+  mRenderQueue.clear();
 }
 
-void RenderObjectManager::addTextureObject(const QString& filename) {
-  auto qImage = QImage(filename);
-  if (qImage.isNull()) {
-    SPDLOG_ERROR("No image: {}", filename);
+void RenderObjectManager::addPostProcessingEffect(
+    const std::shared_ptr<PostProcessingEffect>& effect) {
+  if (!effect) {
+    SPDLOG_ERROR("Add no post-processing effect");
     return;
   }
+  mPostProcessingEffects.push_back(effect);
+}
 
-  std::shared_ptr<TextureRenderObject> renderObject =
-      std::make_shared<TextureRenderObject>(TextureRenderObject::kDefaultTextureTarget, qImage);
-  renderObject->setDisplayName(filename);
+void RenderObjectManager::removePostProcessingEffect(
+    const std::shared_ptr<PostProcessingEffect>& effect) {
+  mPostProcessingEffects.erase(
+      std::remove(mPostProcessingEffects.begin(), mPostProcessingEffects.end(), effect),
+      mPostProcessingEffects.end());
+}
 
+void RenderObjectManager::addRenderObject(const std::shared_ptr<RenderObject>& renderObject) {
   // add object to data structure
   mRenderObjectsList.emplace_back(renderObject);
+  mRenderQueue.add(renderObject);
+  // a transform node at the root, to be moved into groups
+  const auto node = mTransformGraph.addNode();
+  renderObject->setTransformNode(node);
+  mTransformNodeRenderObjects[node] = renderObject.get();
+  // indexed once it has bounds (see updateSpatialIndex)
+  QMutexLocker locker(&mSpatialIndexMutex);
+  mSpatialIndexEntries[renderObject.get()].renderObject = renderObject;
+}
+
+void RenderObjectManager::updateTransforms() {
+  // only the objects in changed subtrees get a new model matrix (and move in the render queue)
+  for (const auto node : mTransformGraph.update()) {
+    if (const auto iter = mTransformNodeRenderObjects.find(node);
+        iter != mTransformNodeRenderObjects.end()) {
+      iter->second->setModelMatrix(mTransformGraph.worldMatrix(node));
+    }
+  }
+}
+
+void RenderObjectManager::updateSpatialIndex() {
+  // the render queue collects the added objects and those whose transform or bounds changed
+  const auto& changedObjects = mRenderQueue.changedObjects();
+  if (changedObjects.empty()) {
+    return;
+  }
+  QMutexLocker locker(&mSpatialIndexMutex);
+  for (auto* renderObject : changedObjects) {
+    SpatialIndex::Box box;
+    const auto* key = mRenderQueue.keyOf(renderObject);
+    if (key == nullptr || !SpatialIndex::worldBox(*renderObject, &box)) continue;
+    auto& entry = mSpatialIndexEntries[renderObject];
+    if (entry.proxy == SpatialIndex::kNoProxy) {
+      entry.proxy = mSpatialIndex.insert(box, renderObject);
+    } else {
+      mSpatialIndex.move(entry.proxy, box);
+    }
+    entry.modelMatrix = renderObject->getModelMatrix();
+    entry.inverseModelMatrix = entry.modelMatrix.inverted();
+    renderObject->localBounds(entry.bounds);
+    entry.layer = key->layer;
+    entry.sequence = key->sequence;
+  }
+}
+
+void RenderObjectManager::updatePickableObjects(
+    const std::vector<RenderQueue::Entry>& renderQueue) {
+  QMutexLocker locker(&mSpatialIndexMutex);
+  for (size_t index = 0; index < renderQueue.size(); ++index) {
+    if (const auto iter = mSpatialIndexEntries.find(renderQueue[index].renderObject.get());
+        iter != mSpatialIndexEntries.end()) {
+      iter->second.isVisible = mVisibleRenderObjects[index] != 0;
+    }
+  }
+}
+
+std::vector<std::weak_ptr<RenderObject>> RenderObjectManager::renderObjectsAt(
+    const QPointF& point) const {
+  std::vector<SpatialIndex::ProxyId> proxies;
+  QMutexLocker locker(&mSpatialIndexMutex);
+  mSpatialIndex.queryPoint(point, &proxies);
+  return renderObjectsOf(proxies);
+}
+
+std::vector<std::weak_ptr<RenderObject>> RenderObjectManager::renderObjectsIn(
+    const QRectF& rect) const {
+  std::vector<SpatialIndex::ProxyId> proxies;
+  QMutexLocker locker(&mSpatialIndexMutex);
+  mSpatialIndex.queryRect(rect, &proxies);
+  return renderObjectsOf(proxies);
+}
+
+std::vector<std::weak_ptr<RenderObject>> RenderObjectManager::renderObjectsInFrustum(
+    const QMatrix4x4& viewProjection) const {
+  std::vector<SpatialIndex::ProxyId> proxies;
+  QMutexLocker locker(&mSpatialIndexMutex);
+  mSpatialIndex.queryFrustum(viewProjection, &proxies);
+  return renderObjectsOf(proxies);
+}
+
+std::vector<std::weak_ptr<RenderObject>> RenderObjectManager::renderObjectsOf(
+    const std::vector<SpatialIndex::ProxyId>& proxies) const {
+  std::vector<std::weak_ptr<RenderObject>> renderObjects;
+  renderObjects.reserve(proxies.size());
+  for (const auto proxy : proxies) {
+    const auto iter = mSpatialIndexEntries.find(mSpatialIndex.renderObject(proxy));
+    if (iter != mSpatialIndexEntries.end()) {
+      renderObjects.push_back(iter->second.renderObject);
+    }
+  }
+  return renderObjects;
+}
+
+RenderObjectManager::PickResult RenderObjectManager::pick(
+    const QMatrix4x4& viewProjection, const QPointF& normalizedDevicePosition,
+    bool alphaTest) const {
+  // hits where the object is less opaque are skipped by the alpha test
+  constexpr float kMinimumPickAlpha = 0.5f;
+  bool isInvertible = false;
+  const QMatrix4x4 inverseViewProjection = viewProjection.inverted(&isInvertible);
+  if (!isInvertible) {
+    SPDLOG_WARN("Cannot pick with a view/projection matrix that is not invertible");
+    return {};
+  }
+  // the ray from the near to the far plane through the position
+  const float x = static_cast<float>(normalizedDevicePosition.x());
+  const float y = static_cast<float>(normalizedDevicePosition.y());
+  const QVector3D start = inverseViewProjection.map(QVector3D(x, y, -1.f));
+  const QVector3D end = inverseViewProjection.map(QVector3D(x, y, 1.f));
+
+  PickResult result;
+  RenderQueue::SortKey resultKey;
+  std::vector<SpatialIndex::ProxyId> proxies;
+  QMutexLocker locker(&mSpatialIndexMutex);
+  mSpatialIndex.querySegment(start, end, &proxies);
+  for (const auto proxy : proxies) {
+    const auto& entry = mSpatialIndexEntries.at(mSpatialIndex.renderObject(proxy));
+    if (!entry.isVisible || entry.bounds[2] == 0.f || entry.bounds[3] == 0.f) continue;
+    // the draw order decides which object is in front (as in the render queue)
+    const QVector3D origin = (viewProjection * entry.modelMatrix).map(QVector3D());
+    const RenderQueue::SortKey key{entry.layer, origin.z(), entry.sequence};
+    if (result.renderObject != nullptr && key < resultKey) continue;
+    // the object is a rectangle in its model space's xy plane, the ray's parameter is kept by the
+    // affine model matrix
+    const QVector3D localStart = entry.inverseModelMatrix.map(start);
+    const QVector3D localDirection = entry.inverseModelMatrix.map(end) - localStart;
+    if (std::abs(localDirection.z()) < 1e-12f) continue;
+    const float t = -localStart.z() / localDirection.z();
+    if (t < 0.f || t > 1.f) continue;
+    const QVector3D localHit = localStart + t * localDirection;
+    const QPointF boundsPosition((localHit.x() - entry.bounds[0]) / entry.bounds[2],
+                                 (localHit.y() - entry.bounds[1]) / entry.bounds[3]);
+    if (boundsPosition.x() < 0. || boundsPosition.x() > 1. || boundsPosition.y() < 0. ||
+        boundsPosition.y() > 1.) {
+      continue;
+    }
+    // the object may be gone already if it is being removed
+    auto renderObject = entry.renderObject.lock();
+    if (!renderObject) continue;
+    if (alphaTest && renderObject->alphaAt(boundsPosition) < kMinimumPickAlpha) continue;
+    result = {std::move(renderObject), start + t * (end - start), boundsPosition};
+    resultKey = key;
+  }
+  return result;
+}
+
+bool RenderObjectManager::addTextureObject(const QString& filename) {
+  std::shared_ptr<TextureRenderObject> renderObject =
+      std::make_shared<TextureRenderObject>(TextureRenderObject::kDefaultTextureTarget);
+  renderObject->enableSeparateMask(false, false);
+  renderObject->initialize();
+  // decodes straight into the texture's upload buffer where possible, large images included
+  if (!ImageDecoder::decodeIntoTexture(filename, *renderObject)) {
+    return false;
+  }
+  renderObject->setDisplayName(filename);
+  mImageFileRefresher.watch(filename, renderObject);
+
+  addRenderObject(renderObject);
+  return true;
+}
+
+void RenderObjectManager::refreshTextureObjects(const QString& filename) {
+  if (!tryMakeOpenGlContextCurrent(false)) return;
+  mImageFileRefresher.refresh(filename);
+}
+
+void RenderObjectManager::addVideoObject(const QString& filename) {
+  if (!QFileInfo::exists(filename)) {
+    SPDLOG_ERROR("No video: {}", filename);
+    return;
+  }
+
+  std::shared_ptr<FrameSourceRenderObject> renderObject =
+      std::make_shared<FrameSourceRenderObject>(TextureRenderObject::kDefaultTextureTarget,
+                                                QUrl::fromLocalFile(filename));
+  renderObject->setDisplayName(filename);
+  renderObject->play();
+
+  addRenderObject(renderObject);
+}
+
+void RenderObjectManager::addImageSequenceObject(const QStringList& filenames,
+                                                  int framesPerSecond) {
+  if (filenames.isEmpty()) {
+    SPDLOG_ERROR("No images in sequence");
+    return;
+  }
+
+  std::shared_ptr<ImageSequenceRenderObject> renderObject =
+      std::make_shared<ImageSequenceRenderObject>(TextureRenderObject::kDefaultTextureTarget,
+                                                  filenames, framesPerSecond);
+  renderObject->setDisplayName(filenames.first());
+
+  addRenderObject(renderObject);
 }
 
 void RenderObjectManager::onOutputSettingsChanged() {
   tryMakeOpenGlContextCurrent(false);
   mCurrentOutputResolution = QSize(1080, 720);
 
-  // update render frame buffers (MSAA and texture), local storage and viewport
-  QOpenGLFramebufferObjectFormat fboMultisamplingFormat;
-  fboMultisamplingFormat.setAttachment(QOpenGLFramebufferObject::Attachment::NoAttachment);
-  fboMultisamplingFormat.setMipmap(true);
-  fboMultisamplingFormat.setSamples(8);
-  fboMultisamplingFormat.setInternalTextureFormat(GL_RGBA8);
-  fboMultisamplingFormat.setTextureTarget(TextureRenderObject::qGlTarget(mRenderFramebufferTarget));
-  mMultisampleFramebuffer = std::make_unique<QOpenGLFramebufferObject>(
-      mCurrentOutputResolution.width(), mCurrentOutputResolution.height(), fboMultisamplingFormat);
+  // update render frame buffers (scene and texture), local storage and viewport
+  const GLenum textureTarget = TextureRenderObject::qGlTarget(mRenderFramebufferTarget);
+  int samples = sampleCount(mAntiAliasing);
+  GLint maxSamples = 0;
+  mContext->functions()->glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  if (samples > maxSamples) {
+    SPDLOG_WARN("{} samples not supported, using {}", samples, maxSamples);
+    samples = maxSamples;
+  }
+  mSceneFramebuffer.reset();
+  mFramebufferByteCount = 0;
+  if (mAntiAliasing != AntiAliasing::Off) {
+    QOpenGLFramebufferObjectFormat fboSceneFormat;
+    // the depth buffer of the opaque pass
+    fboSceneFormat.setAttachment(QOpenGLFramebufferObject::Attachment::Depth);
+    fboSceneFormat.setSamples(samples);
+    fboSceneFormat.setInternalTextureFormat(GL_RGBA8);
+    fboSceneFormat.setTextureTarget(textureTarget);
+    mSceneFramebuffer = std::make_unique<QOpenGLFramebufferObject>(
+        mCurrentOutputResolution.width(), mCurrentOutputResolution.height(), fboSceneFormat);
+    mFramebufferByteCount +=
+        RenderTargetPool::byteCount({mCurrentOutputResolution, GL_RGBA8, textureTarget,
+                                     mSceneFramebuffer->format().samples(), true});
+  }
 
   QOpenGLFramebufferObjectFormat fboDownsampledFormat;
-  fboDownsampledFormat.setAttachment(QOpenGLFramebufferObject::Attachment::NoAttachment);
-  fboDownsampledFormat.setMipmap(false);
+  // the scene is drawn straight into the render framebuffer without anti-aliasing
+  const bool isSceneOutput = !mSceneFramebuffer;
+  if (isSceneOutput) {
+    fboDownsampledFormat.setAttachment(QOpenGLFramebufferObject::Attachment::Depth);
+  }
   fboDownsampledFormat.setInternalTextureFormat(GL_RGBA8);
-  fboDownsampledFormat.setTextureTarget(TextureRenderObject::qGlTarget(mRenderFramebufferTarget));
+  fboDownsampledFormat.setTextureTarget(textureTarget);
   mRenderFramebuffer = std::make_unique<QOpenGLFramebufferObject>(
       mCurrentOutputResolution.width(), mCurrentOutputResolution.height(), fboDownsampledFormat);
+  mFramebufferByteCount += RenderTargetPool::byteCount(
+      {mCurrentOutputResolution, GL_RGBA8, textureTarget, 0, isSceneOutput});
+  SPDLOG_INFO("Anti-aliasing: {}, framebuffers {:.1f} MB", name(mAntiAliasing),
+              mFramebufferByteCount / (1024.0 * 1024.0));
   glViewport(0, 0, mCurrentOutputResolution.width(), mCurrentOutputResolution.height());
+  // the new framebuffers have no content to keep
+  mDamageTracker.invalidate();
+}
+
+void RenderObjectManager::setDynamicResolutionEnabled(bool enabled, double frameTimeBudgetMs) {
+  mResolutionScaler.setFrameTimeBudget(frameTimeBudgetMs);
+  if (enabled == mDynamicResolutionEnabled) {
+    return;
+  }
+  mDynamicResolutionEnabled = enabled;
+  SPDLOG_INFO("Dynamic resolution {}, frame time budget {:.1f} ms",
+              enabled ? "enabled" : "disabled", frameTimeBudgetMs);
+  if (!enabled) {
+    // back to full resolution
+    const bool wasScaled = mResolutionScaler.scale() != 1.f;
+    mResolutionScaler.reset();
+    if (wasScaled) {
+      mResolutionScale = 1.f;
+      mDamageTracker.invalidate();
+      emit resolutionScaleChanged(1.f);
+    }
+  }
+}
+
+void RenderObjectManager::updateResolutionScale() {
+  if (!mDynamicResolutionEnabled) {
+    return;
+  }
+  // the frames in the order they were rendered, starting with the oldest
+  for (int offset = 0; offset < kFrameTimerCount; ++offset) {
+    auto& frameTimer = mFrameTimers[(mFrameTimerIndex + offset) % kFrameTimerCount];
+    if (!frameTimer.isPending || !frameTimer.query->isResultAvailable()) continue;
+    frameTimer.isPending = false;
+    const double frameTimeMs = frameTimer.query->waitForResult() / 1e6;
+    if (mResolutionScaler.addFrameTime(frameTimeMs)) {
+      mResolutionScale = mResolutionScaler.scale();
+      SPDLOG_INFO("Dynamic resolution: {:.1f}% (GPU frame time {:.1f} ms, budget {:.1f} ms)",
+                  100.0 * mResolutionScaler.scale(), frameTimeMs,
+                  mResolutionScaler.frameTimeBudgetMs());
+      // the scene framebuffer's content is of the previous scale
+      mDamageTracker.invalidate();
+      emit resolutionScaleChanged(mResolutionScaler.scale());
+    }
+  }
+}
+
+QOpenGLTimerQuery* RenderObjectManager::beginFrameTimer() {
+  if (!mDynamicResolutionEnabled) {
+    return nullptr;
+  }
+  auto& frameTimer = mFrameTimers[mFrameTimerIndex];
+  if (frameTimer.isPending) {
+    return nullptr;
+  }
+  if (!frameTimer.query) {
+    frameTimer.query = std::make_unique<QOpenGLTimerQuery>();
+    if (!frameTimer.query->create()) {
+      SPDLOG_WARN("Timer queries not supported, disabling dynamic resolution");
+      frameTimer.query.reset();
+      setDynamicResolutionEnabled(false, mResolutionScaler.frameTimeBudgetMs());
+      return nullptr;
+    }
+  }
+  mFrameTimerIndex = (mFrameTimerIndex + 1) % kFrameTimerCount;
+  frameTimer.query->begin();
+  frameTimer.isPending = true;
+  return frameTimer.query.get();
+}
+
+void RenderObjectManager::setAntiAliasing(AntiAliasing antiAliasing) {
+  if (antiAliasing == mAntiAliasing) {
+    return;
+  }
+  mAntiAliasing = antiAliasing;
+  if (isInitialized()) {
+    onOutputSettingsChanged();
+  }
+}
+
+int RenderObjectManager::sampleCount(AntiAliasing antiAliasing) {
+  switch (antiAliasing) {
+    case AntiAliasing::Msaa2x:
+      return 2;
+    case AntiAliasing::Msaa4x:
+      return 4;
+    case AntiAliasing::Msaa8x:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+QString RenderObjectManager::name(AntiAliasing antiAliasing) {
+  switch (antiAliasing) {
+    case AntiAliasing::Off:
+      return "off";
+    case AntiAliasing::Fxaa:
+      return "FXAA";
+    default:
+      return QString("%1x MSAA").arg(sampleCount(antiAliasing));
+  }
 }
 
 void RenderObjectManager::changeOpenGlDebugging(bool enabled) {
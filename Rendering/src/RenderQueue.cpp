@@ -0,0 +1,157 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/RenderQueue.h"
+
+#include <QtCore/QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+namespace nimagna {
+
+RenderQueue::~RenderQueue() {
+  clear();
+}
+
+void RenderQueue::add(const std::shared_ptr<RenderObject>& renderObject) {
+  RenderObject* object = renderObject.get();
+  if (mKeys.count(object) != 0) {
+    SPDLOG_WARN("Render object {} is already in the render queue", object->getDisplayName());
+    return;
+  }
+  const SortKey key = sortKey(*renderObject, mNextSequence++);
+  mEntries.insert(std::upper_bound(mEntries.begin(), mEntries.end(), key,
+                                   [](const SortKey& key, const Entry& entry) {
+                                     return key < entry.key;
+                                   }),
+                  Entry{renderObject, key});
+  mKeys[object] = key;
+  {
+    QMutexLocker locker(&mChangedMutex);
+    mChangedObjects.push_back(object);
+  }
+  // direct connection: the object is only remembered and moved on the next update
+  mConnections[object] =
+      QObject::connect(object, &RenderObject::propertiesChanged, [this, object]() {
+        QMutexLocker locker(&mChangedMutex);
+        mChangedObjects.push_back(object);
+      });
+}
+
+void RenderQueue::remove(const RenderObject* renderObject) {
+  const auto keyIter = mKeys.find(renderObject);
+  if (keyIter == mKeys.end()) {
+    return;
+  }
+  const auto compare = [](const Entry& entry, const SortKey& key) { return entry.key < key; };
+  const auto iter = std::lower_bound(mEntries.begin(), mEntries.end(), keyIter->second, compare);
+  if (iter != mEntries.end() && iter->renderObject.get() == renderObject) {
+    mEntries.erase(iter);
+  } else {
+    SPDLOG_ERROR("Render queue out of order for {}", renderObject->getDisplayName());
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                  [renderObject](const Entry& entry) {
+                                    return entry.renderObject.get() == renderObject;
+                                  }),
+                   mEntries.end());
+  }
+  mKeys.erase(keyIter);
+  const auto connectionIter = mConnections.find(renderObject);
+  if (connectionIter != mConnections.end()) {
+    QObject::disconnect(connectionIter->second);
+    mConnections.erase(connectionIter);
+  }
+  // pending changes of the object are skipped by update (see reinsert)
+}
+
+void RenderQueue::clear() {
+  for (const auto& [renderObject, connection] : mConnections) {
+    QObject::disconnect(connection);
+  }
+  mConnections.clear();
+  mEntries.clear();
+  mKeys.clear();
+  mUpdatedObjects.clear();
+  QMutexLocker locker(&mChangedMutex);
+  mChangedObjects.clear();
+}
+
+const std::vector<RenderQueue::Entry>& RenderQueue::update(const QMatrix4x4& viewProjection) {
+  {
+    QMutexLocker locker(&mChangedMutex);
+    mUpdatedObjects.swap(mChangedObjects);
+    mChangedObjects.clear();
+  }
+  std::sort(mUpdatedObjects.begin(), mUpdatedObjects.end());
+  mUpdatedObjects.erase(std::unique(mUpdatedObjects.begin(), mUpdatedObjects.end()),
+                        mUpdatedObjects.end());
+
+  if (viewProjection != mViewProjection) {
+    // all depths changed: update the keys in place and repair the order
+    mViewProjection = viewProjection;
+    for (auto& entry : mEntries) {
+      entry.key = sortKey(*entry.renderObject, entry.key.sequence);
+      mKeys[entry.renderObject.get()] = entry.key;
+    }
+    // insertion sort, linear for the nearly sorted order of a moving camera. A jump of the camera
+    // can reverse the order though: beyond n log n moves a full sort is cheaper.
+    const size_t count = mEntries.size();
+    const size_t moveBudget =
+        count * static_cast<size_t>(std::log2(static_cast<double>(std::max<size_t>(count, 2))));
+    size_t moves = 0;
+    for (size_t index = 1; index < count && moves <= moveBudget; ++index) {
+      if (!(mEntries[index].key < mEntries[index - 1].key)) continue;
+      Entry entry = std::move(mEntries[index]);
+      size_t position = index;
+      for (; position > 0 && entry.key < mEntries[position - 1].key; --position) {
+        mEntries[position] = std::move(mEntries[position - 1]);
+      }
+      mEntries[position] = std::move(entry);
+      moves += index - position;
+    }
+    if (moves > moveBudget) {
+      std::stable_sort(mEntries.begin(), mEntries.end(),
+                       [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    }
+    return mEntries;
+  }
+
+  // only the changed objects move
+  for (const auto* renderObject : mUpdatedObjects) {
+    reinsert(renderObject);
+  }
+  return mEntries;
+}
+
+const RenderQueue::SortKey* RenderQueue::keyOf(const RenderObject* renderObject) const {
+  const auto iter = mKeys.find(renderObject);
+  return iter != mKeys.end() ? &iter->second : nullptr;
+}
+
+RenderQueue::SortKey RenderQueue::sortKey(const RenderObject& renderObject,
+                                          uint64_t sequence) const {
+  // the depth of the object's origin, objects are sorted as a whole
+  const QVector3D origin = (mViewProjection * renderObject.getModelMatrix()).map(QVector3D());
+  return {renderObject.layer(), origin.z(), sequence};
+}
+
+void RenderQueue::reinsert(const RenderObject* renderObject) {
+  const auto keyIter = mKeys.find(renderObject);
+  if (keyIter == mKeys.end()) {
+    // removed meanwhile
+    return;
+  }
+  const auto compare = [](const Entry& entry, const SortKey& key) { return entry.key < key; };
+  const auto iter = std::lower_bound(mEntries.begin(), mEntries.end(), keyIter->second, compare);
+  if (iter == mEntries.end() || iter->renderObject.get() != renderObject) {
+    SPDLOG_ERROR("Render queue out of order for {}", renderObject->getDisplayName());
+    return;
+  }
+  Entry entry = std::move(*iter);
+  mEntries.erase(iter);
+  entry.key = sortKey(*entry.renderObject, entry.key.sequence);
+  keyIter->second = entry.key;
+  mEntries.insert(std::lower_bound(mEntries.begin(), mEntries.end(), entry.key, compare),
+                  std::move(entry));
+}
+
+}  // namespace nimagna
@@ -0,0 +1,101 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/RenderTargetPool.h"
+
+#include <algorithm>
+
+#include "Rendering/PerContext.h"
+
+namespace nimagna {
+
+namespace {
+// the pool of each context
+PerContext<RenderTargetPool> pools;
+
+int bytesPerPixel(GLenum internalFormat) {
+  switch (internalFormat) {
+    case GL_R8:
+      return 1;
+    case GL_RG8:
+    case GL_R16F:
+      return 2;
+    case GL_RGBA16F:
+      return 8;
+    case GL_RGBA32F:
+      return 16;
+    default:
+      return 4;
+  }
+}
+}  // namespace
+
+RenderTargetPool& RenderTargetPool::forCurrentContext() {
+  return pools.forCurrentContext();
+}
+
+void RenderTargetPool::release(QOpenGLContext* context) {
+  pools.release(context);
+}
+
+qint64 RenderTargetPool::byteCount(const Description& description) {
+  const qint64 pixelCount =
+      static_cast<qint64>(description.size.width()) * description.size.height();
+  const qint64 colorBytes =
+      pixelCount * bytesPerPixel(description.internalFormat) * std::max(description.samples, 1);
+  // a packed 24 bit depth and 8 bit stencil buffer per sample
+  const qint64 depthBytes = description.hasDepth ? pixelCount * 4 * std::max(description.samples, 1)
+                                                 : 0;
+  return colorBytes + depthBytes;
+}
+
+QOpenGLFramebufferObject* RenderTargetPool::acquire(const Description& description) {
+  for (auto& target : mTargets) {
+    if (target.isFree && !(target.description < description) &&
+        !(description < target.description)) {
+      target.isFree = false;
+      target.unusedFrameCount = 0;
+      return target.framebuffer.get();
+    }
+  }
+  QOpenGLFramebufferObjectFormat format;
+  format.setInternalTextureFormat(description.internalFormat);
+  format.setTextureTarget(description.textureTarget);
+  format.setSamples(description.samples);
+  format.setAttachment(description.hasDepth ? QOpenGLFramebufferObject::Attachment::Depth
+                                            : QOpenGLFramebufferObject::Attachment::NoAttachment);
+  auto framebuffer = std::make_unique<QOpenGLFramebufferObject>(description.size, format);
+  if (!framebuffer->isValid()) {
+    SPDLOG_ERROR("Failed to create a {}x{} render target", description.size.width(),
+                 description.size.height());
+  }
+  ++mStatistics.createdCount;
+  ++mStatistics.targetCount;
+  mStatistics.byteCount += byteCount(description);
+  mTargets.push_back({std::move(framebuffer), description});
+  return mTargets.back().framebuffer.get();
+}
+
+void RenderTargetPool::recycle(QOpenGLFramebufferObject* target) {
+  const auto iter =
+      std::find_if(mTargets.begin(), mTargets.end(),
+                   [target](const Target& pooled) { return pooled.framebuffer.get() == target; });
+  if (iter == mTargets.end()) {
+    SPDLOG_ERROR("Recycle a render target not from the pool");
+    return;
+  }
+  iter->isFree = true;
+}
+
+void RenderTargetPool::endFrame() {
+  for (auto iter = mTargets.begin(); iter != mTargets.end();) {
+    if (iter->isFree && ++iter->unusedFrameCount > kMaxUnusedFrameCount) {
+      --mStatistics.targetCount;
+      mStatistics.byteCount -= byteCount(iter->description);
+      iter = mTargets.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}  // namespace nimagna
@@ -2,6 +2,8 @@
 
 #include "Rendering/Renderer.h"
 
+#include "Rendering/RenderBenchmarks.h"
+
 namespace nimagna {
 
 /* ******************************************************************
@@ -18,6 +20,8 @@ void RenderWorker::initializeRendering() {
   SPDLOG_INFO("Create ROM");
   // create the render object manager in the rendering thread...
   mRenderObjectManager = std::make_shared<RenderObjectManager>();
+  connect(mRenderObjectManager.get(), &RenderObjectManager::resolutionScaleChanged, this,
+          &RenderWorker::resolutionScaleChanged);
 }
 
 void RenderWorker::startRendering(std::shared_ptr<QOpenGLContext> context,
@@ -49,7 +53,65 @@ void RenderWorker::stopRendering() {
 
 void RenderWorker::loadImage(QString filename) {
   if (!mRenderObjectManager) return;
-  mRenderObjectManager->addTextureObject(filename);
+  if (mRenderObjectManager->addTextureObject(filename)) {
+    emit imageLoaded(filename);
+  }
+}
+
+void RenderWorker::refreshImage(QString filename) {
+  if (!mRenderObjectManager) return;
+  mRenderObjectManager->refreshTextureObjects(filename);
+}
+
+void RenderWorker::loadVideo(QString filename) {
+  if (!mRenderObjectManager) return;
+  mRenderObjectManager->addVideoObject(filename);
+}
+
+void RenderWorker::loadImageSequence(QStringList filenames) {
+  if (!mRenderObjectManager) return;
+  mRenderObjectManager->addImageSequenceObject(filenames, kOutputFps);
+}
+
+void RenderWorker::benchmarkShaderVariants() {
+  if (!mRenderObjectManager || !mRenderObjectManager->tryMakeOpenGlContextCurrent(false)) return;
+  RenderBenchmarks::shaderVariantFillRate();
+}
+
+void RenderWorker::benchmarkOpaquePass(QStringList filenames) {
+  if (!mRenderObjectManager || !mRenderObjectManager->isInitialized() ||
+      !mRenderObjectManager->tryMakeOpenGlContextCurrent(false)) {
+    return;
+  }
+  RenderBenchmarks::opaquePassFillRate(*mRenderObjectManager, filenames);
+}
+
+void RenderWorker::benchmarkMaskBlur() {
+  if (!mRenderObjectManager || !mRenderObjectManager->tryMakeOpenGlContextCurrent(false)) return;
+  RenderBenchmarks::maskBlurFillRate();
+}
+
+void RenderWorker::benchmarkBatchedDraws() {
+  if (!mRenderObjectManager || !mRenderObjectManager->tryMakeOpenGlContextCurrent(false)) return;
+  RenderBenchmarks::batchedDraws();
+}
+
+void RenderWorker::benchmarkAntiAliasing() {
+  if (!mRenderObjectManager || !mRenderObjectManager->isInitialized() ||
+      !mRenderObjectManager->tryMakeOpenGlContextCurrent(false)) {
+    return;
+  }
+  RenderBenchmarks::antiAliasingModes(*mRenderObjectManager);
+}
+
+void RenderWorker::changeAntiAliasing(RenderObjectManager::AntiAliasing antiAliasing) {
+  if (!mRenderObjectManager) return;
+  mRenderObjectManager->setAntiAliasing(antiAliasing);
+}
+
+void RenderWorker::changeDynamicResolution(bool enabled) {
+  if (!mRenderObjectManager) return;
+  mRenderObjectManager->setDynamicResolutionEnabled(enabled, 1000.0 / kOutputFps);
 }
 
 void RenderWorker::render() {
@@ -72,9 +134,8 @@ void RenderWorker::createAndStartTimerIfNeeded() {
 }
 
 void RenderWorker::udpateOutputFps() {
-  auto outputFps = 30;
-  SPDLOG_INFO("Set renderer FPS to {}", outputFps);
-  mTimer->setInterval(1000 / outputFps);
+  SPDLOG_INFO("Set renderer FPS to {}", kOutputFps);
+  mTimer->setInterval(1000 / kOutputFps);
 }
 
 /* ******************************************************************
@@ -90,8 +151,29 @@ Renderer::Renderer() {
   connect(this, &Renderer::startRenderer, mRenderWorker.get(), &RenderWorker::startRendering);
   connect(this, &Renderer::stopRenderer, mRenderWorker.get(), &RenderWorker::stopRendering);
   connect(this, &Renderer::loadImage, mRenderWorker.get(), &RenderWorker::loadImage);
+  connect(this, &Renderer::refreshImage, mRenderWorker.get(), &RenderWorker::refreshImage);
+  connect(this, &Renderer::loadVideo, mRenderWorker.get(), &RenderWorker::loadVideo);
+  connect(this, &Renderer::loadImageSequence, mRenderWorker.get(),
+          &RenderWorker::loadImageSequence);
+  connect(this, &Renderer::benchmarkShaderVariants, mRenderWorker.get(),
+          &RenderWorker::benchmarkShaderVariants);
+  connect(this, &Renderer::benchmarkOpaquePass, mRenderWorker.get(),
+          &RenderWorker::benchmarkOpaquePass);
+  connect(this, &Renderer::benchmarkMaskBlur, mRenderWorker.get(),
+          &RenderWorker::benchmarkMaskBlur);
+  connect(this, &Renderer::benchmarkBatchedDraws, mRenderWorker.get(),
+          &RenderWorker::benchmarkBatchedDraws);
+  connect(this, &Renderer::benchmarkAntiAliasing, mRenderWorker.get(),
+          &RenderWorker::benchmarkAntiAliasing);
+  connect(this, &Renderer::changeAntiAliasing, mRenderWorker.get(),
+          &RenderWorker::changeAntiAliasing);
+  connect(this, &Renderer::changeDynamicResolution, mRenderWorker.get(),
+          &RenderWorker::changeDynamicResolution);
   connect(mRenderWorker.get(), &RenderWorker::renderFrameReady, this,
           &Renderer::renderFrameUpdated);
+  connect(mRenderWorker.get(), &RenderWorker::resolutionScaleChanged, this,
+          &Renderer::resolutionScaleChanged);
+  connect(mRenderWorker.get(), &RenderWorker::imageLoaded, this, &Renderer::imageLoaded);
 
   const auto isThreaded = true;
   if (isThreaded) {
@@ -117,7 +199,9 @@ void Renderer::start(QOpenGLContext* shareContext) {
   SPDLOG_INFO("Start Renderer..");
   // the desired format
   QSurfaceFormat format = QSurfaceFormat::defaultFormat();
-  format.setSamples(8);
+  // everything is rendered into framebuffer objects, the offscreen surface needs no samples (see
+  // RenderObjectManager::AntiAliasing)
+  format.setSamples(0);
 #ifdef NIMAGNA_DEBUG
   format.setOption(QSurfaceFormat::DebugContext);
 #endif
@@ -200,4 +284,40 @@ void Renderer::addImage(QString filename) {
   emit loadImage(filename);
 }
 
+void Renderer::addVideo(QString filename) {
+  emit loadVideo(filename);
+}
+
+void Renderer::addImageSequence(QStringList filenames) {
+  emit loadImageSequence(filenames);
+}
+
+void Renderer::runShaderVariantBenchmark() {
+  emit benchmarkShaderVariants();
+}
+
+void Renderer::runOpaquePassBenchmark(const QStringList& filenames) {
+  emit benchmarkOpaquePass(filenames);
+}
+
+void Renderer::runMaskBlurBenchmark() {
+  emit benchmarkMaskBlur();
+}
+
+void Renderer::runBatchedDrawsBenchmark() {
+  emit benchmarkBatchedDraws();
+}
+
+void Renderer::runAntiAliasingBenchmark() {
+  emit benchmarkAntiAliasing();
+}
+
+void Renderer::setAntiAliasing(RenderObjectManager::AntiAliasing antiAliasing) {
+  emit changeAntiAliasing(antiAliasing);
+}
+
+void Renderer::setDynamicResolutionEnabled(bool enabled) {
+  emit changeDynamicResolution(enabled);
+}
+
 }  // namespace nimagna
@@ -0,0 +1,62 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/ResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nimagna {
+
+bool ResolutionScaler::addFrameTime(double frameTimeMs) {
+  if (!mHasFrameTime) {
+    mAverageFrameTimeMs = frameTimeMs;
+    mHasFrameTime = true;
+  } else {
+    mAverageFrameTimeMs += kSmoothing * (frameTimeMs - mAverageFrameTimeMs);
+  }
+
+  const float upscaledScale = std::min(mScale + kScaleStep, 1.f);
+  const double upscaledFrameTimeMs =
+      mAverageFrameTimeMs * (upscaledScale * upscaledScale) / (mScale * mScale);
+  if (mScale > kMinScale && mAverageFrameTimeMs > kDownscaleThreshold * mFrameTimeBudgetMs) {
+    mUnderBudgetFrameCount = 0;
+    if (++mOverBudgetFrameCount >= kDownscaleFrameCount) {
+      changeScale(std::max(mScale - kScaleStep, kMinScale));
+      return true;
+    }
+  } else if (mScale < 1.f && upscaledFrameTimeMs < kUpscaleThreshold * mFrameTimeBudgetMs) {
+    mOverBudgetFrameCount = 0;
+    if (++mUnderBudgetFrameCount >= kUpscaleFrameCount) {
+      changeScale(upscaledScale);
+      return true;
+    }
+  } else {
+    mOverBudgetFrameCount = 0;
+    mUnderBudgetFrameCount = 0;
+  }
+  return false;
+}
+
+void ResolutionScaler::reset() {
+  mScale = 1.f;
+  mAverageFrameTimeMs = 0.0;
+  mHasFrameTime = false;
+  mOverBudgetFrameCount = 0;
+  mUnderBudgetFrameCount = 0;
+}
+
+QSize ResolutionScaler::scaledSize(const QSize& size) const {
+  return QSize(std::max(static_cast<int>(std::lround(size.width() * mScale)), 1),
+               std::max(static_cast<int>(std::lround(size.height() * mScale)), 1));
+}
+
+void ResolutionScaler::changeScale(float scale) {
+  // the frames measured so far predict the time at the new scale, such that the next step waits
+  // for frames at the new scale
+  mAverageFrameTimeMs *= (scale * scale) / (mScale * mScale);
+  mScale = scale;
+  mOverBudgetFrameCount = 0;
+  mUnderBudgetFrameCount = 0;
+}
+
+}  // namespace nimagna
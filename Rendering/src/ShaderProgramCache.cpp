@@ -0,0 +1,394 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/ShaderProgramCache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <algorithm>
+
+namespace nimagna {
+
+std::shared_ptr<QOpenGLShaderProgram> ShaderProgramCache::program(const Key& key,
+                                                                  const Initializer& initializer) {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  if (context == nullptr) {
+    SPDLOG_ERROR("No current context to get shader program {}", key.fragmentShaderFile);
+    assert(false);
+    return nullptr;
+  }
+
+  // thread critical section
+  QMutexLocker locker(&mMutex);
+  auto& programs = mPrograms[context];
+  if (programs.empty()) {
+    watchContext(context);
+  }
+  auto iter = programs.find(key);
+  if (iter != programs.end()) {
+    ++mStatistics.cacheHitCount;
+  } else {
+    // not warmed up: compile synchronously
+    QElapsedTimer timer;
+    timer.start();
+    auto pendingProgram = beginCompile(key);
+    if (!pendingProgram || !finishCompile(*pendingProgram)) {
+      return nullptr;
+    }
+    recordCompletion(*pendingProgram, timer.nsecsElapsed() / 1000);
+    iter = programs.emplace(key, Entry{pendingProgram->program}).first;
+    ++mStatistics.programCount;
+  }
+
+  auto& entry = iter->second;
+  if (!entry.isInitialized && initializer) {
+    if (!entry.program->bind()) {
+      SPDLOG_ERROR("Failed to bind shader program! {}", entry.program->log());
+      return nullptr;
+    }
+    initializer(*entry.program);
+    entry.program->release();
+    entry.isInitialized = true;
+  }
+  return entry.program;
+}
+
+void ShaderProgramCache::warmUp(const std::vector<Key>& keys) {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  if (context == nullptr) {
+    SPDLOG_ERROR("No current context to warm up shader programs");
+    return;
+  }
+
+  // thread critical section
+  QMutexLocker locker(&mMutex);
+  auto& programs = mPrograms[context];
+  if (programs.empty()) {
+    watchContext(context);
+  }
+  enableParallelCompilation();
+
+  QElapsedTimer timer;
+  timer.start();
+  // first issue everything...
+  std::vector<PendingProgram> pendingPrograms;
+  for (const auto& key : keys) {
+    if (programs.count(key) > 0) continue;
+    if (auto pendingProgram = beginCompile(key)) {
+      pendingPrograms.push_back(std::move(*pendingProgram));
+    }
+  }
+  // ... then wait for the results
+  std::vector<PendingProgram*> finishedPrograms;
+  for (auto& pendingProgram : pendingPrograms) {
+    if (finishCompile(pendingProgram)) {
+      finishedPrograms.push_back(&pendingProgram);
+    }
+  }
+  if (finishedPrograms.empty()) {
+    return;
+  }
+
+  // the programs were compiled in parallel: attribute the time evenly
+  const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+  const qint64 programTimeUs = elapsedUs / static_cast<qint64>(finishedPrograms.size());
+  const auto statisticsBefore = mStatistics;
+  for (auto* pendingProgram : finishedPrograms) {
+    recordCompletion(*pendingProgram, programTimeUs);
+    programs.emplace(pendingProgram->key, Entry{pendingProgram->program});
+    ++mStatistics.programCount;
+  }
+  const int loadedCount = mStatistics.binaryLoadCount - statisticsBefore.binaryLoadCount;
+  const qint64 savedUs = (mStatistics.savedCompileTimeUs - statisticsBefore.savedCompileTimeUs) -
+                         (mStatistics.binaryLoadTimeUs - statisticsBefore.binaryLoadTimeUs);
+  SPDLOG_INFO(
+      "Shader warm-up: {} programs in {:.1f} ms, {} compiled, {} loaded from the binary cache "
+      "(saved {:.1f} ms)",
+      finishedPrograms.size(), elapsedUs / 1000.0,
+      static_cast<int>(finishedPrograms.size()) - loadedCount,
+      loadedCount, savedUs / 1000.0);
+}
+
+void ShaderProgramCache::releasePrograms(QOpenGLContext* context) {
+  // thread critical section
+  QMutexLocker locker(&mMutex);
+  if (const auto iter = mPrograms.find(context); iter != mPrograms.end()) {
+    mStatistics.programCount -= static_cast<int>(iter->second.size());
+    mPrograms.erase(iter);
+  }
+}
+
+ShaderProgramCache::Statistics ShaderProgramCache::statistics() {
+  // thread critical section
+  QMutexLocker locker(&mMutex);
+  return mStatistics;
+}
+
+QString ShaderProgramCache::binaryCacheDirectory() {
+  return QStringLiteral("%1/shaders/v%2")
+      .arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+      .arg(kBinaryCacheVersion);
+}
+
+std::optional<ShaderProgramCache::PendingProgram> ShaderProgramCache::beginCompile(
+    const Key& key) {
+  QFile vertexShaderFile(key.vertexShaderFile);
+  QFile fragmentShaderFile(key.fragmentShaderFile);
+  if (!vertexShaderFile.open(QIODevice::ReadOnly) ||
+      !fragmentShaderFile.open(QIODevice::ReadOnly)) {
+    SPDLOG_ERROR("Unable to read shaders {} and {}", key.vertexShaderFile,
+                 key.fragmentShaderFile);
+    return std::nullopt;
+  }
+  const QByteArray vertexSource = withDefines(vertexShaderFile.readAll(), key.features);
+  const QByteArray fragmentSource = withDefines(fragmentShaderFile.readAll(), key.features);
+
+  PendingProgram pendingProgram{key, std::make_shared<QOpenGLShaderProgram>()};
+  auto& program = *pendingProgram.program;
+  if (!program.create()) {
+    SPDLOG_ERROR("Failed to create shader program! {}", program.log());
+    return std::nullopt;
+  }
+
+  const bool isBinaryCacheEnabled = isBinaryCacheSupported();
+  if (isBinaryCacheEnabled) {
+    pendingProgram.binaryCacheFile = binaryCacheFile(key, vertexSource, fragmentSource);
+    qint64 compileTimeUs = 0;
+    if (loadBinary(program, pendingProgram.binaryCacheFile, &compileTimeUs)) {
+      pendingProgram.binaryCompileTimeUs = compileTimeUs;
+      return pendingProgram;
+    }
+  }
+
+  // compile and link without querying the status, which would wait for the driver
+  auto* functions = QOpenGLContext::currentContext()->extraFunctions();
+  const GLuint programId = program.programId();
+  const std::pair<GLenum, const QByteArray*> stages[] = {{GL_VERTEX_SHADER, &vertexSource},
+                                                         {GL_FRAGMENT_SHADER, &fragmentSource}};
+  for (const auto& [stage, source] : stages) {
+    const GLuint shader = functions->glCreateShader(stage);
+    const char* sourceData = source->constData();
+    const GLint sourceLength = static_cast<GLint>(source->size());
+    functions->glShaderSource(shader, 1, &sourceData, &sourceLength);
+    functions->glCompileShader(shader);
+    functions->glAttachShader(programId, shader);
+    pendingProgram.shaders.push_back(shader);
+  }
+  if (isBinaryCacheEnabled) {
+    functions->glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  functions->glLinkProgram(programId);
+  return pendingProgram;
+}
+
+bool ShaderProgramCache::finishCompile(PendingProgram& pendingProgram) {
+  if (pendingProgram.shaders.empty()) {
+    // loaded from a binary and already linked
+    return true;
+  }
+  auto* functions = QOpenGLContext::currentContext()->extraFunctions();
+  const GLuint programId = pendingProgram.program->programId();
+  // waits for the driver to finish compiling and linking
+  GLint linkStatus = GL_FALSE;
+  functions->glGetProgramiv(programId, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus != GL_TRUE) {
+    for (const GLuint shader : pendingProgram.shaders) {
+      GLint compileStatus = GL_FALSE;
+      functions->glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+      if (compileStatus != GL_TRUE) {
+        GLint logLength = 0;
+        functions->glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        QByteArray log(std::max(logLength, 1), '\0');
+        functions->glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+        SPDLOG_ERROR("Shader error in {}! {}", pendingProgram.key.fragmentShaderFile,
+                     log.toStdString());
+      }
+    }
+    GLint logLength = 0;
+    functions->glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &logLength);
+    QByteArray log(std::max(logLength, 1), '\0');
+    functions->glGetProgramInfoLog(programId, logLength, nullptr, log.data());
+    SPDLOG_ERROR("Shader linker error! {}", log.toStdString());
+  }
+  for (const GLuint shader : pendingProgram.shaders) {
+    functions->glDetachShader(programId, shader);
+    functions->glDeleteShader(shader);
+  }
+  pendingProgram.shaders.clear();
+  // without shaders attached, QOpenGLShaderProgram adopts the program's link status
+  return linkStatus == GL_TRUE && pendingProgram.program->link();
+}
+
+void ShaderProgramCache::recordCompletion(PendingProgram& pendingProgram, qint64 elapsedUs) {
+  if (pendingProgram.binaryCompileTimeUs) {
+    ++mStatistics.binaryLoadCount;
+    mStatistics.binaryLoadTimeUs += elapsedUs;
+    mStatistics.savedCompileTimeUs += *pendingProgram.binaryCompileTimeUs;
+    SPDLOG_DEBUG("Loaded shader program {} [{}] in {:.1f} ms",
+                 pendingProgram.key.fragmentShaderFile, pendingProgram.key.features.join(", "),
+                 elapsedUs / 1000.0);
+    return;
+  }
+  ++mStatistics.compileCount;
+  mStatistics.compileTimeUs += elapsedUs;
+  SPDLOG_INFO("Compiled shader program {} [{}] in {:.1f} ms ({} compiled, {:.1f} ms in total)",
+              pendingProgram.key.fragmentShaderFile, pendingProgram.key.features.join(", "),
+              elapsedUs / 1000.0, mStatistics.compileCount, mStatistics.compileTimeUs / 1000.0);
+  if (!pendingProgram.binaryCacheFile.isEmpty()) {
+    storeBinary(*pendingProgram.program, pendingProgram.binaryCacheFile, elapsedUs);
+  }
+}
+
+QByteArray ShaderProgramCache::withDefines(const QByteArray& source, const QStringList& defines) {
+  if (defines.isEmpty()) {
+    return source;
+  }
+  // the defines must follow the version directive
+  const auto versionIndex = source.indexOf("#version");
+  const auto lineEnd = versionIndex < 0 ? -1 : source.indexOf('\n', versionIndex);
+  if (lineEnd < 0) {
+    SPDLOG_ERROR("Shader without version directive, cannot define {}", defines.join(", "));
+    return source;
+  }
+  QByteArray definesBlock;
+  for (const auto& define : defines) {
+    definesBlock += "#define " + define.toUtf8() + '\n';
+  }
+  // keep the line numbers of compiler messages matching the file
+  const int nextLine = static_cast<int>(source.left(lineEnd).count('\n')) + 2;
+  definesBlock += "#line " + QByteArray::number(nextLine) + '\n';
+  return QByteArray(source).insert(lineEnd + 1, definesBlock);
+}
+
+QString ShaderProgramCache::binaryCacheFile(const Key& key, const QByteArray& vertexSource,
+                                            const QByteArray& fragmentSource) {
+  auto* functions = QOpenGLContext::currentContext()->functions();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(vertexSource);
+  hash.addData(fragmentSource);
+  hash.addData(key.features.join(',').toUtf8());
+  // a driver update invalidates the binaries
+  for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    hash.addData(QByteArray(reinterpret_cast<const char*>(functions->glGetString(name))));
+  }
+  return QStringLiteral("%1/%2.bin").arg(binaryCacheDirectory(), hash.result().toHex());
+}
+
+bool ShaderProgramCache::loadBinary(QOpenGLShaderProgram& program, const QString& filename,
+                                    qint64* compileTimeUs) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    // not cached yet
+    return false;
+  }
+  QDataStream stream(&file);
+  quint32 magic = 0;
+  quint32 version = 0;
+  quint32 binaryFormat = 0;
+  QByteArray binary;
+  stream >> magic >> version >> binaryFormat >> *compileTimeUs >> binary;
+  if (stream.status() != QDataStream::Ok || magic != kBinaryCacheMagic ||
+      version != kBinaryCacheVersion || binary.isEmpty()) {
+    SPDLOG_WARN("Invalid program binary {}", filename);
+    file.remove();
+    return false;
+  }
+
+  auto* functions = QOpenGLContext::currentContext()->extraFunctions();
+  const GLuint programId = program.programId();
+  functions->glProgramBinary(programId, binaryFormat, binary.constData(),
+                             static_cast<GLsizei>(binary.size()));
+  GLint linkStatus = GL_FALSE;
+  functions->glGetProgramiv(programId, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus != GL_TRUE) {
+    // e.g. the driver changed without changing its version string
+    SPDLOG_WARN("Driver rejected program binary {}, compiling from source", filename);
+    file.remove();
+    return false;
+  }
+  // without shaders attached, QOpenGLShaderProgram adopts the program's link status
+  return program.link();
+}
+
+void ShaderProgramCache::storeBinary(QOpenGLShaderProgram& program, const QString& filename,
+                                     qint64 compileTimeUs) {
+  auto* functions = QOpenGLContext::currentContext()->extraFunctions();
+  const GLuint programId = program.programId();
+  GLint binaryLength = 0;
+  functions->glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+  if (binaryLength <= 0) {
+    return;
+  }
+  QByteArray binary(binaryLength, '\0');
+  GLenum binaryFormat = 0;
+  functions->glGetProgramBinary(programId, binaryLength, nullptr, &binaryFormat, binary.data());
+
+  QDir().mkpath(binaryCacheDirectory());
+  // written atomically: a concurrently starting instance never reads a partial binary
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    SPDLOG_WARN("Unable to write program binary {}", filename);
+    return;
+  }
+  QDataStream stream(&file);
+  stream << kBinaryCacheMagic << kBinaryCacheVersion << static_cast<quint32>(binaryFormat)
+         << compileTimeUs << binary;
+  if (!file.commit()) {
+    SPDLOG_WARN("Unable to write program binary {}", filename);
+    return;
+  }
+  SPDLOG_DEBUG("Stored program binary {} ({} bytes)", filename, binaryLength);
+}
+
+bool ShaderProgramCache::isBinaryCacheSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  if (context->format().version() < qMakePair(4, 1) &&
+      !context->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+    return false;
+  }
+  GLint binaryFormatCount = 0;
+  context->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+  return binaryFormatCount > 0;
+}
+
+void ShaderProgramCache::enableParallelCompilation() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  const char* functionName = nullptr;
+  if (context->hasExtension(QByteArrayLiteral("GL_KHR_parallel_shader_compile"))) {
+    functionName = "glMaxShaderCompilerThreadsKHR";
+  } else if (context->hasExtension(QByteArrayLiteral("GL_ARB_parallel_shader_compile"))) {
+    functionName = "glMaxShaderCompilerThreadsARB";
+  } else {
+    // many drivers still compile on a background thread until the status is queried
+    return;
+  }
+  using MaxShaderCompilerThreads = void(QOPENGLF_APIENTRYP)(GLuint count);
+  if (const auto maxShaderCompilerThreads =
+          reinterpret_cast<MaxShaderCompilerThreads>(context->getProcAddress(functionName))) {
+    // 0xFFFFFFFF lets the driver choose the number of threads
+    maxShaderCompilerThreads(0xFFFFFFFF);
+    SPDLOG_DEBUG("Enabled parallel shader compilation");
+  }
+}
+
+void ShaderProgramCache::watchContext(QOpenGLContext* context) {
+  // the program map of a context is empty again after a failed compile or releasePrograms
+  if (!mWatchedContexts.insert(context).second) {
+    return;
+  }
+  // forget the programs if the context gets destroyed without releasing them. Qt frees them once
+  // another context of the share group is current.
+  QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, context, [context]() {
+    releasePrograms(context);
+    QMutexLocker locker(&mMutex);
+    mWatchedContexts.erase(context);
+  });
+}
+
+}  // namespace nimagna
@@ -0,0 +1,355 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/SpatialIndex.h"
+
+#include <QtGui/QVector4D>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace nimagna {
+
+namespace {
+
+QVector3D minimum(const QVector3D& a, const QVector3D& b) {
+  return {std::min(a.x(), b.x()), std::min(a.y(), b.y()), std::min(a.z(), b.z())};
+}
+
+QVector3D maximum(const QVector3D& a, const QVector3D& b) {
+  return {std::max(a.x(), b.x()), std::max(a.y(), b.y()), std::max(a.z(), b.z())};
+}
+
+}  // namespace
+
+bool SpatialIndex::Box::contains(const Box& other) const {
+  return minimum.x() <= other.minimum.x() && minimum.y() <= other.minimum.y() &&
+         minimum.z() <= other.minimum.z() && other.maximum.x() <= maximum.x() &&
+         other.maximum.y() <= maximum.y() && other.maximum.z() <= maximum.z();
+}
+
+bool SpatialIndex::Box::overlaps(const Box& other) const {
+  return minimum.x() <= other.maximum.x() && other.minimum.x() <= maximum.x() &&
+         minimum.y() <= other.maximum.y() && other.minimum.y() <= maximum.y() &&
+         minimum.z() <= other.maximum.z() && other.minimum.z() <= maximum.z();
+}
+
+SpatialIndex::Box SpatialIndex::Box::united(const Box& other) const {
+  return {nimagna::minimum(minimum, other.minimum), nimagna::maximum(maximum, other.maximum)};
+}
+
+float SpatialIndex::Box::extentSum() const {
+  const QVector3D extent = maximum - minimum;
+  return extent.x() + extent.y() + extent.z();
+}
+
+bool SpatialIndex::worldBox(const RenderObject& renderObject, Box* box) {
+  float rect[4];
+  if (!renderObject.localBounds(rect)) {
+    return false;
+  }
+  const QMatrix4x4& model = renderObject.getModelMatrix();
+  for (int corner = 0; corner < 4; ++corner) {
+    const QVector3D position = model.map(QVector3D(rect[0] + ((corner & 1) ? rect[2] : 0.f),
+                                                   rect[1] + ((corner & 2) ? rect[3] : 0.f), 0.f));
+    box->minimum = corner == 0 ? position : minimum(box->minimum, position);
+    box->maximum = corner == 0 ? position : maximum(box->maximum, position);
+  }
+  return true;
+}
+
+SpatialIndex::ProxyId SpatialIndex::insert(const Box& box, RenderObject* renderObject) {
+  const int leaf = allocateNode();
+  mNodes[leaf].box = fatBox(box);
+  mNodes[leaf].bounds = box;
+  mNodes[leaf].renderObject = renderObject;
+  mNodes[leaf].height = 0;
+  insertLeaf(leaf);
+  ++mProxyCount;
+  return leaf;
+}
+
+void SpatialIndex::remove(ProxyId proxy) {
+  if (proxy < 0 || proxy >= static_cast<int>(mNodes.size()) || !mNodes[proxy].isLeaf() ||
+      mNodes[proxy].height != 0) {
+    SPDLOG_ERROR("Remove invalid spatial index proxy {}", proxy);
+    return;
+  }
+  removeLeaf(proxy);
+  freeNode(proxy);
+  --mProxyCount;
+}
+
+bool SpatialIndex::move(ProxyId proxy, const Box& box) {
+  mNodes[proxy].bounds = box;
+  if (mNodes[proxy].box.contains(box)) {
+    return false;
+  }
+  removeLeaf(proxy);
+  mNodes[proxy].box = fatBox(box);
+  insertLeaf(proxy);
+  return true;
+}
+
+void SpatialIndex::clear() {
+  mNodes.clear();
+  mRoot = kNoNode;
+  mFreeNode = kNoNode;
+  mProxyCount = 0;
+}
+
+void SpatialIndex::queryFrustum(const QMatrix4x4& viewProjection,
+                                std::vector<ProxyId>* proxies) const {
+  // the planes of the clip volume (-w <= x,y,z <= w) in world space, inside is positive
+  std::array<QVector4D, 6> planes;
+  for (int axis = 0; axis < 3; ++axis) {
+    planes[2 * axis] = viewProjection.row(3) + viewProjection.row(axis);
+    planes[2 * axis + 1] = viewProjection.row(3) - viewProjection.row(axis);
+  }
+  query(
+      [&planes](const Box& box) {
+        for (const auto& plane : planes) {
+          // the corner farthest along the plane's normal
+          const QVector4D corner(plane.x() >= 0.f ? box.maximum.x() : box.minimum.x(),
+                                 plane.y() >= 0.f ? box.maximum.y() : box.minimum.y(),
+                                 plane.z() >= 0.f ? box.maximum.z() : box.minimum.z(), 1.f);
+          if (QVector4D::dotProduct(plane, corner) < 0.f) {
+            return false;
+          }
+        }
+        return true;
+      },
+      proxies);
+}
+
+void SpatialIndex::queryPoint(const QPointF& point, std::vector<ProxyId>* proxies) const {
+  const float x = static_cast<float>(point.x());
+  const float y = static_cast<float>(point.y());
+  query(
+      [x, y](const Box& box) {
+        return box.minimum.x() <= x && x <= box.maximum.x() && box.minimum.y() <= y &&
+               y <= box.maximum.y();
+      },
+      proxies);
+}
+
+void SpatialIndex::queryRect(const QRectF& rect, std::vector<ProxyId>* proxies) const {
+  const QRectF normalized = rect.normalized();
+  query(
+      [&normalized](const Box& box) {
+        return box.minimum.x() <= normalized.right() && normalized.left() <= box.maximum.x() &&
+               box.minimum.y() <= normalized.bottom() && normalized.top() <= box.maximum.y();
+      },
+      proxies);
+}
+
+void SpatialIndex::querySegment(const QVector3D& start, const QVector3D& end,
+                                std::vector<ProxyId>* proxies) const {
+  const QVector3D direction = end - start;
+  query(
+      [&start, &direction](const Box& box) {
+        // clip the segment's parameter range by the slabs of the three axes
+        float minimumT = 0.f;
+        float maximumT = 1.f;
+        for (int axis = 0; axis < 3; ++axis) {
+          if (std::abs(direction[axis]) < 1e-12f) {
+            if (start[axis] < box.minimum[axis] || start[axis] > box.maximum[axis]) return false;
+            continue;
+          }
+          const float inverse = 1.f / direction[axis];
+          float t1 = (box.minimum[axis] - start[axis]) * inverse;
+          float t2 = (box.maximum[axis] - start[axis]) * inverse;
+          if (t1 > t2) std::swap(t1, t2);
+          minimumT = std::max(minimumT, t1);
+          maximumT = std::min(maximumT, t2);
+          if (minimumT > maximumT) return false;
+        }
+        return true;
+      },
+      proxies);
+}
+
+template <typename Predicate>
+void SpatialIndex::query(const Predicate& overlaps, std::vector<ProxyId>* proxies) const {
+  if (mRoot == kNoNode) {
+    return;
+  }
+  std::vector<int> stack;
+  stack.reserve(64);
+  stack.push_back(mRoot);
+  while (!stack.empty()) {
+    const int nodeIndex = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[nodeIndex];
+    if (!overlaps(node.box)) continue;
+    if (node.isLeaf()) {
+      if (overlaps(node.bounds)) {
+        proxies->push_back(nodeIndex);
+      }
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+SpatialIndex::Box SpatialIndex::fatBox(const Box& box) {
+  // enlarged such that small movements stay within
+  const QVector3D margin = 0.1f * (box.maximum - box.minimum) + QVector3D(1e-3f, 1e-3f, 1e-3f);
+  return {box.minimum - margin, box.maximum + margin};
+}
+
+int SpatialIndex::allocateNode() {
+  if (mFreeNode == kNoNode) {
+    mNodes.emplace_back();
+    mNodes.back().height = -1;
+    mNodes.back().parent = kNoNode;
+    mFreeNode = static_cast<int>(mNodes.size()) - 1;
+  }
+  const int node = mFreeNode;
+  // free nodes are chained through their parent index
+  mFreeNode = mNodes[node].parent;
+  mNodes[node] = Node();
+  return node;
+}
+
+void SpatialIndex::freeNode(int node) {
+  mNodes[node] = Node();
+  mNodes[node].height = -1;
+  mNodes[node].parent = mFreeNode;
+  mFreeNode = node;
+}
+
+void SpatialIndex::insertLeaf(int leaf) {
+  if (mRoot == kNoNode) {
+    mRoot = leaf;
+    mNodes[leaf].parent = kNoNode;
+    return;
+  }
+
+  // find the sibling whose union with the leaf costs the least
+  const Box leafBox = mNodes[leaf].box;
+  int index = mRoot;
+  while (!mNodes[index].isLeaf()) {
+    const Node& node = mNodes[index];
+    const float extentSum = node.box.extentSum();
+    const float combinedExtentSum = node.box.united(leafBox).extentSum();
+    // pairing with this node creates a new parent, descending enlarges this node
+    const float cost = 2.f * combinedExtentSum;
+    const float inheritanceCost = 2.f * (combinedExtentSum - extentSum);
+    const auto descendCost = [&](int child) {
+      const Box united = leafBox.united(mNodes[child].box);
+      const float childCost = mNodes[child].isLeaf()
+                                  ? united.extentSum()
+                                  : united.extentSum() - mNodes[child].box.extentSum();
+      return childCost + inheritanceCost;
+    };
+    const float cost1 = descendCost(node.child1);
+    const float cost2 = descendCost(node.child2);
+    if (cost < cost1 && cost < cost2) break;
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  // a new parent for the sibling and the leaf
+  const int sibling = index;
+  const int oldParent = mNodes[sibling].parent;
+  const int newParent = allocateNode();
+  mNodes[newParent].parent = oldParent;
+  mNodes[newParent].box = leafBox.united(mNodes[sibling].box);
+  mNodes[newParent].height = mNodes[sibling].height + 1;
+  mNodes[newParent].child1 = sibling;
+  mNodes[newParent].child2 = leaf;
+  mNodes[sibling].parent = newParent;
+  mNodes[leaf].parent = newParent;
+  if (oldParent == kNoNode) {
+    mRoot = newParent;
+  } else if (mNodes[oldParent].child1 == sibling) {
+    mNodes[oldParent].child1 = newParent;
+  } else {
+    mNodes[oldParent].child2 = newParent;
+  }
+  refit(mNodes[leaf].parent);
+}
+
+void SpatialIndex::removeLeaf(int leaf) {
+  if (leaf == mRoot) {
+    mRoot = kNoNode;
+    return;
+  }
+  const int parent = mNodes[leaf].parent;
+  const int grandParent = mNodes[parent].parent;
+  const int sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+  if (grandParent == kNoNode) {
+    mRoot = sibling;
+    mNodes[sibling].parent = kNoNode;
+    freeNode(parent);
+  } else {
+    // the sibling takes the parent's place
+    if (mNodes[grandParent].child1 == parent) {
+      mNodes[grandParent].child1 = sibling;
+    } else {
+      mNodes[grandParent].child2 = sibling;
+    }
+    mNodes[sibling].parent = grandParent;
+    freeNode(parent);
+    refit(grandParent);
+  }
+  mNodes[leaf].parent = kNoNode;
+}
+
+void SpatialIndex::refit(int node) {
+  for (int index = node; index != kNoNode; index = mNodes[index].parent) {
+    index = balance(index);
+    Node& current = mNodes[index];
+    current.height = 1 + std::max(mNodes[current.child1].height, mNodes[current.child2].height);
+    current.box = mNodes[current.child1].box.united(mNodes[current.child2].box);
+  }
+}
+
+int SpatialIndex::balance(int a) {
+  Node& nodeA = mNodes[a];
+  if (nodeA.isLeaf() || nodeA.height < 2) {
+    return a;
+  }
+  const int b = nodeA.child1;
+  const int c = nodeA.child2;
+  const int heightDifference = mNodes[c].height - mNodes[b].height;
+  if (heightDifference >= -1 && heightDifference <= 1) {
+    return a;
+  }
+
+  // promotes the higher child of a (x) to a's place: a takes x's lower child, x keeps the higher
+  const auto rotate = [this, a](int x, int other) {
+    Node& nodeA = mNodes[a];
+    Node& nodeX = mNodes[x];
+    const int f = nodeX.child1;
+    const int g = nodeX.child2;
+    nodeX.child1 = a;
+    nodeX.parent = nodeA.parent;
+    nodeA.parent = x;
+    if (nodeX.parent == kNoNode) {
+      mRoot = x;
+    } else if (mNodes[nodeX.parent].child1 == a) {
+      mNodes[nodeX.parent].child1 = x;
+    } else {
+      mNodes[nodeX.parent].child2 = x;
+    }
+    const int higher = mNodes[f].height > mNodes[g].height ? f : g;
+    const int lower = higher == f ? g : f;
+    nodeX.child2 = higher;
+    if (nodeA.child1 == x) {
+      nodeA.child1 = lower;
+    } else {
+      nodeA.child2 = lower;
+    }
+    mNodes[lower].parent = a;
+    nodeA.box = mNodes[other].box.united(mNodes[lower].box);
+    nodeA.height = 1 + std::max(mNodes[other].height, mNodes[lower].height);
+    nodeX.box = nodeA.box.united(mNodes[higher].box);
+    nodeX.height = 1 + std::max(nodeA.height, mNodes[higher].height);
+    return x;
+  };
+  return heightDifference > 1 ? rotate(c, b) : rotate(b, c);
+}
+
+}  // namespace nimagna
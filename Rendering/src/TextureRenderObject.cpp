@@ -6,7 +6,14 @@
 #include <QtCore/QRandomGenerator>
 #include <QtCore/QThread>
 #include <QtGui/QOpenGLFunctions>
+#include <QtGui/QPixelFormat>
 #include <QtOpenGL/QOpenGLPixelTransferOptions>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+
+#include "Rendering/UniformBufferRing.h"
 
 namespace nimagna {
 
@@ -30,11 +37,11 @@ TextureRenderObject::TextureRenderObject(TextureTarget type, const QImage& textu
 }
 
 TextureRenderObject::~TextureRenderObject() {
-  mVAO.destroy();
-  mVBO.destroy();
-  mIBO.destroy();
+  mStreamingBuffer.destroy();
   mTexture.reset();
   mMaskTexture.reset();
+  mRetiredTextures.clear();
+  mBlurredMask.reset();
   mShaderProgram.reset();
 }
 
@@ -43,154 +50,105 @@ void TextureRenderObject::initialize() {
 
   SPDLOG_DEBUG("Initializing TextureRenderObject");
 
-  // Set up vertex data (and buffer(s)) and configure vertex attributes
-  // create a new buffer for the vertices and colors, interleaved storage
-  mVBO = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-  if (!mVBO.create()) {
-    SPDLOG_ERROR("Failed to create VertexBufferObject");
-  }
-  mVBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
-
-  // Vertex data structure is as follows:
-  // there are 4 vertices (see mVBD size), each vertex has: 3 positions, 2 texture coordinates, and
-  // 2 mask texture coordinates stored in a vertexData struct, resulting in [p p p t t mt mt] per
-  // vertex. See also shader program setup.
-  const int vertexCount = 4;
-  mVBD.resize(vertexCount);
-
-  // updates the texture coordinates and uploads the VBO
-  updateTextureCoordinates();
-  updateMaskTextureCoordinates();
-
-  // Create and bind Vertex Array Object
-  // must be bound *before* the element buffer is bound,
-  // because the VAO remembers and manages element buffers as well
-  if (!mVAO.isCreated()) {
-    SPDLOG_DEBUG("Creating VertexArrayObject");
-    mVAO.create();
-  }
-  mVAO.bind();
-
-  // The index buffer
-  const unsigned int indices[] = {
-      // note that we start from 0!
-      0, 1, 2,  // first triangle
-      2, 3, 0   // second triangle
-  };
-
-  // Create a new buffer for the indexes
-  mIBO = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);  // Mind: use 'IndexBuffer' here
-  if (!mIBO.create()) {
-    SPDLOG_ERROR("Failed to create IndexBufferObject");
-  }
-  mIBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
-  if (!mIBO.bind()) {
-    SPDLOG_ERROR("Failed to bind IndexBufferObject");
+  {
+    // thread critical section
+    QMutexLocker locker(&mAccessMutex);
+    // the geometry is the shared unit quad, mapped to the rectangles computed here
+    updateTextureCoordinates();
+    updateMaskTextureCoordinates();
+    publishDrawState();
   }
-  mIBO.allocate(indices, sizeof(indices));
 
-  // Finally, build and compile the shader program
-  setupShaderProgram();
+  // get the shader program variant, compiled once per context
+  selectShaderProgramVariant(mSeparateMaskTextureEnabled, false,
+                             mSourcePixelFormat == SourcePixelFormat::BGRA);
 
   // Done
   RenderObject::initialize();
 }
 
-void TextureRenderObject::setupShaderProgram() {
-  //////////////////////////////////////////////////////////////////////////
-  // Create, initialize, and link
-  //////////////////////////////////////////////////////////////////////////
-
-  // create shader program
-  mShaderProgram = std::make_unique<QOpenGLShaderProgram>();
-  // read the shader programs from the resources
-  if (!mShaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, mVertexShaderFile)) {
-    SPDLOG_ERROR("Vertex shader error! {}", mShaderProgram->log().toStdString());
-  }
-  if (!mShaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment,
-                                                        mFragmentShaderFile.at(mTextureTarget))) {
-    SPDLOG_ERROR("Fragment shader error! {}", mShaderProgram->log().toStdString());
-  }
-  // link
-  if (!mShaderProgram->link()) {
-    SPDLOG_ERROR("Shader linker error! {}", mShaderProgram->log().toStdString());
-  }
-  // and bind
-  if (!mShaderProgram->bind()) {
-    SPDLOG_ERROR("Failed to bind texture program! {}", mShaderProgram->log().toStdString());
-  }
-
-  //////////////////////////////////////////////////////////////////////////
-  // Set values
-  //////////////////////////////////////////////////////////////////////////
-
-  // set projection matrix to identity
-  mWorldTransformationShaderPosition = mShaderProgram->uniformLocation("worldToView");
-  if (mWorldTransformationShaderPosition == -1) {
-    SPDLOG_ERROR("Invalid world transformation ID: {}", mShaderProgram->log().toStdString());
-  }
-  QMatrix4x4 projectionMatrix;
-  projectionMatrix.setToIdentity();
-  mShaderProgram->setUniformValue(mWorldTransformationShaderPosition, projectionMatrix);
-
+void TextureRenderObject::setTextureUnits(QOpenGLShaderProgram& program, TextureTarget target,
+                                          bool separateMaskEnabled) {
+  // slot i samples TEXTURE0 + mColorTextureUnit + i (and TEXTURE0 + mMaskTextureUnit + i)
+  std::array<GLint, RenderBatcher::kTextureSlotCount> units;
+  std::iota(units.begin(), units.end(), mColorTextureUnit);
   // Get color texture location
-  // Note: Textures will be created in changeTextureSize
-  const int textureLocationInShader = mShaderProgram->uniformLocation(
-      mTextureTarget == TextureTarget::TargetRectangle ? "imageTextureRect" : "imageTexture");
+  const int textureLocationInShader = program.uniformLocation(
+      target == TextureTarget::TargetRectangle ? "imageTexturesRect" : "imageTextures");
   if (textureLocationInShader == -1) {
-    SPDLOG_ERROR("Invalid texture ID: {}", mShaderProgram->log().toStdString());
+    SPDLOG_ERROR("Invalid texture ID: {}", program.log().toStdString());
   }
-  // Associate TEXTURE0 + mColorTextureUnit in shader
-  mShaderProgram->setUniformValue(textureLocationInShader, mColorTextureUnit);
+  program.setUniformValueArray(textureLocationInShader, units.data(),
+                               RenderBatcher::kTextureSlotCount);
 
-  if (mSeparateMaskTextureEnabled) {
+  if (separateMaskEnabled) {
     SPDLOG_DEBUG("> Enabling separate mask texture");
     // set texture location
-    const int keyingLocationInShader = mShaderProgram->uniformLocation(
-        mTextureTarget == TextureTarget::TargetRectangle ? "maskTextureRect" : "maskTexture");
+    const int keyingLocationInShader = program.uniformLocation(
+        target == TextureTarget::TargetRectangle ? "maskTexturesRect" : "maskTextures");
     if (keyingLocationInShader == -1) {
-      SPDLOG_ERROR("Invalid keying texture ID: {}", mShaderProgram->log().toStdString());
+      SPDLOG_ERROR("Invalid keying texture ID: {}", program.log().toStdString());
     }
-
-    // associate TEXTURE0 + mMaskTextureUnit in shader
-    mShaderProgram->setUniformValue(keyingLocationInShader, mMaskTextureUnit);
+    std::iota(units.begin(), units.end(), mMaskTextureUnit);
+    program.setUniformValueArray(keyingLocationInShader, units.data(),
+                                 RenderBatcher::kTextureSlotCount);
+  }
+}
+
+bool TextureRenderObject::selectShaderProgramVariant(bool separateMaskEnabled, bool blurredMask,
+                                                     bool swapRGB) {
+  // the variant depends on the mask and the source pixel format which can change at any time
+  const auto key = shaderProgramKey(mTextureTarget, separateMaskEnabled, blurredMask, swapRGB);
+  if (mShaderProgram && key.features == mShaderProgramKey.features) {
+    return true;
+  }
+  const auto textureTarget = mTextureTarget;
+  mShaderProgram = ShaderProgramCache::program(key, [textureTarget, separateMaskEnabled](
+                                                        QOpenGLShaderProgram& program) {
+    // the matrices and the alpha transparency are read from the uniform buffer ring
+    UniformBufferRing::bindBlocks(program);
+    // Note: Textures will be created in changeTextureSize
+    setTextureUnits(program, textureTarget, separateMaskEnabled);
+  });
+  if (!mShaderProgram) {
+    SPDLOG_CRITICAL("No texture program!");
+    assert(false);
+    return false;
   }
+  mShaderProgramKey = key;
+  return true;
+}
 
-  // blurring for separate (camera) masks
-  mShaderProgram->setUniformValue(
-      "doBlurring", false);
-
-  //////////////////////////////////////////////////////////////////////////
-  // Define the format/assign the vertex data to the buffer indices
-  //////////////////////////////////////////////////////////////////////////
-
-  // Vertex data structure is as follows:
-  // there are 4 vertices (see mVBD size)
-  // - each vertex has: pos (3xfloat) + texture (2xfloat) + mask texture (2xfloat), stored in a
-  // vertexData struct
-  // - data is stored per vertex, resulting in: [p p p t t mt mt] per vertex
-
-  const int positionCount = 3;
-  const int textureCount = 2;
-  const int maskTextureCount = 2;
-
-  // layout location 0 - vec3 with coordinates
-  mShaderProgram->enableAttributeArray(0);
-  const int positionOffsetBytes = 0;
-  mShaderProgram->setAttributeBuffer(0, GL_FLOAT, positionOffsetBytes, positionCount,
-                                     sizeof(vertexData));
-
-  // layout location 1 - vec2 with texture coordinates
-  mShaderProgram->enableAttributeArray(1);
-  const int textureOffsetBytes = positionCount * sizeof(float);
-  mShaderProgram->setAttributeBuffer(1, GL_FLOAT, textureOffsetBytes, textureCount,
-                                     sizeof(vertexData));
+ShaderProgramCache::Key TextureRenderObject::shaderProgramKey(TextureTarget target,
+                                                              bool separateMaskEnabled,
+                                                              bool blurredMask, bool swapRGB) {
+  // the features are the shader's defines (in sorted order)
+  ShaderProgramCache::Key key{mVertexShaderFile, mFragmentShaderFile.at(target), {}};
+  if (separateMaskEnabled && blurredMask) {
+    key.features << "DO_BLURRING";
+  }
+  if (swapRGB) {
+    key.features << "SWAP_RGB";
+  }
+  if (separateMaskEnabled) {
+    key.features << "USE_MASK_TEXTURE";
+  }
+  return key;
+}
 
-  // layout location 2 - vec2 with mask texture coordinates
-  mShaderProgram->enableAttributeArray(2);
-  const int maskTextureOffsetBytes = textureOffsetBytes + textureCount * sizeof(float);
-  mShaderProgram->setAttributeBuffer(2, GL_FLOAT, maskTextureOffsetBytes, maskTextureCount,
-                                     sizeof(vertexData));
+std::vector<ShaderProgramCache::Key> TextureRenderObject::shaderProgramKeys() {
+  std::vector<ShaderProgramCache::Key> keys;
+  for (const auto target : {TextureTarget::Target2D, TextureTarget::TargetRectangle}) {
+    for (const bool separateMaskEnabled : {false, true}) {
+      for (const bool swapRGB : {false, true}) {
+        keys.push_back(shaderProgramKey(target, separateMaskEnabled, false, swapRGB));
+        if (separateMaskEnabled) {
+          keys.push_back(shaderProgramKey(target, separateMaskEnabled, true, swapRGB));
+        }
+      }
+    }
+  }
+  return keys;
 }
 
 bool TextureRenderObject::hasSeparateMask() const {
@@ -206,79 +164,152 @@ void TextureRenderObject::enableSeparateMask(bool separateMaskEnabled, bool blur
       mCameraMaskBlurring = blurEnabled;
     }
     initialize();
+  } else if (mSeparateMaskTextureEnabled && mCameraMaskBlurring != blurEnabled) {
+    // thread critical section
+    QMutexLocker locker(&mAccessMutex);
+    mCameraMaskBlurring = blurEnabled;
+    publishDrawState();
   }
 }
 
-void TextureRenderObject::draw() {
-  if (isEmpty()) {
+void TextureRenderObject::setMaskBlur(const MaskBlur::Parameters& parameters) {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
+  const MaskBlur::Parameters maskBlur{std::clamp(parameters.radius, 0, kMaxMaskBlurRadius),
+                                      parameters.sharpness};
+  if (maskBlur == mMaskBlur) {
     return;
   }
-  if (!mTexture) {
-    SPDLOG_WARN("Draw static source without a texture");
-    return;
+  mMaskBlur = maskBlur;
+  ++mMaskVersion;
+  publishDrawState();
+}
+
+void TextureRenderObject::prepare(const QMatrix4x4& vp, qint64 renderTimestampUs) {
+  RenderObject::prepare(vp, renderTimestampUs);
+  // the last frame's state is drawn, the textures it named are no longer used
+  std::vector<std::unique_ptr<QOpenGLTexture>> retiredTextures;
+  {
+    QMutexLocker locker(&mRetiredTexturesMutex);
+    retiredTextures.swap(mRetiredTextures);
   }
-  // thread critical section
-  QMutexLocker locker(&mAccessMutex);
-  // use the shader program
-  if (!mShaderProgram->bind()) {
-    SPDLOG_ERROR("Failed to bind texture program");
+  retiredTextures.clear();
+  mDrawState.acquire();
+}
+
+void TextureRenderObject::retireTexture(std::unique_ptr<QOpenGLTexture> texture) {
+  if (!texture) {
+    return;
   }
+  QMutexLocker locker(&mRetiredTexturesMutex);
+  mRetiredTextures.push_back(std::move(texture));
+}
+
+void TextureRenderObject::updateContent(bool isVisible) {
+  updateTexture(isVisible);
+  // the upload may have changed the size or format
+  mFrameContentVersion = contentVersion();
+  mDrawState.acquire();
+}
 
-  // set projection matrix
-  const QMatrix4x4 mvp = mViewProjectionMatrix * getModelMatrix();
-  mShaderProgram->setUniformValue(mWorldTransformationShaderPosition, mvp);
+void TextureRenderObject::addPasses(RenderGraph& renderGraph,
+                                    std::vector<RenderGraph::TargetId>* inputs) {
+  const DrawState& state = mDrawState.read();
+  if (!state.separateMaskEnabled || !state.maskBlurEnabled || state.useExternalTexture ||
+      state.maskTexture == 0 || state.maskSize.isEmpty()) {
+    mBlurredMask.reset();
+    return;
+  }
+  if (mBlurredMask && mBlurredMask->size() == state.maskSize &&
+      mBlurredMaskVersion == state.maskVersion) {
+    // still blurred from the same mask data and blur, e.g. of a still image
+    return;
+  }
+  const auto textureTarget = static_cast<GLenum>(glTarget());
+  if (!mBlurredMask || mBlurredMask->size() != state.maskSize) {
+    mBlurredMask = MaskBlur::createTarget(state.maskSize, textureTarget);
+  }
+  // the passes writing an imported target are never culled, the mask is blurred in this frame
+  const auto blurredMask = renderGraph.importTarget("blurred mask", mBlurredMask.get());
+  MaskBlur::addPasses(renderGraph, state.maskTexture, textureTarget, state.maskSize,
+                      state.maskBlur, blurredMask);
+  mBlurredMaskVersion = state.maskVersion;
+  inputs->push_back(blurredMask);
+}
 
-  // set alpha transparency value [0.0, 1.0]
-  mShaderProgram->setUniformValue("alphaTransparency", static_cast<GLfloat>(alpha()));
-  // need to swap R and B channel for BGRA source
-  mShaderProgram->setUniformValue(
-      "swapRGB",
-      static_cast<GLboolean>(sourcePixelFormat() == SourcePixelFormat::BGRA));
+void TextureRenderObject::draw() {
+  // a batch of its own
+  updateContent(true);
+  RenderBatcher batcher;
+  submit(batcher);
+  batcher.flush();
+}
 
-  // use separate mask texture?
-  mShaderProgram->setUniformValue("useMaskTexture", static_cast<int>(hasSeparateMask()));
+void TextureRenderObject::submit(RenderBatcher& batcher) {
+  RenderBatcher::Item item;
+  if (batchItem(&item)) {
+    batcher.add(item);
+  }
+}
 
-  // bind the vertex array object (which uses the vertex buffer object)
-  mVAO.bind();
-  if (!mUseExternalTexture) {
+bool TextureRenderObject::batchItem(RenderBatcher::Item* item) {
+  // no lock: the snapshot is complete and owned by the render thread until the next acquire
+  const DrawState& state = mDrawState.read();
+  if (state.texture == 0) {
+    return false;
+  }
+  // use the shader program variant matching the state, the mask is used as is unless its blur
+  // is up to date (e.g. not when drawn directly after the mask changed)
+  const bool blurredMask = state.separateMaskEnabled && state.maskBlurEnabled && mBlurredMask &&
+                           mBlurredMaskVersion == state.maskVersion;
+  if (!selectShaderProgramVariant(state.separateMaskEnabled, blurredMask,
+                                  state.sourcePixelFormat == SourcePixelFormat::BGRA)) {
+    return false;
+  }
+  item->program = mShaderProgram.get();
+  item->textureTarget = static_cast<GLenum>(glTarget());
+  if (!state.useExternalTexture) {
     // bind the textures only if no external texture is used
-    // use color texture unit
-    glActiveTexture(GL_TEXTURE0 + mColorTextureUnit);
-    // static texture
-    mTexture->bind();
-    if (hasSeparateMask()) {
-      // enable the keying texture on mask texture unit
-      glActiveTexture(GL_TEXTURE0 + mMaskTextureUnit);
-      if (mMaskTexture != nullptr) {
-        // static mask texture
-        mMaskTexture->bind();
-      } 
-      glActiveTexture(GL_TEXTURE0 + mColorTextureUnit);
+    item->texture = state.texture;
+    if (state.separateMaskEnabled) {
+      item->maskTexture = blurredMask ? mBlurredMask->texture() : state.maskTexture;
     }
   }
-  // draw the two triangles
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-
-  // release (for completeness)
-  if (!mUseExternalTexture) {
-    // static texture
-    mTexture->release();
-    if (hasSeparateMask()) {
-      glActiveTexture(GL_TEXTURE0 + mMaskTextureUnit);
-      if (mMaskTexture != nullptr) {
-        // static mask texture
-        mMaskTexture->release();
-      } 
-      glActiveTexture(GL_TEXTURE0 + mColorTextureUnit);
-    }
+  // the rectangles, model matrix, and alpha transparency value [0.0, 1.0], the view/projection
+  // matrix is bound once per frame
+  item->uniforms = state.uniforms;
+  std::memcpy(item->uniforms.model, getModelMatrix().constData(), sizeof(item->uniforms.model));
+  item->uniforms.alphaTransparency = alpha();
+  return true;
+}
+
+void TextureRenderObject::publishDrawState() {
+  DrawState state;
+  if (!isEmpty() && mTexture) {
+    state.texture = mTexture->textureId();
   }
-  mVAO.release();
-  mShaderProgram->release();
+  if (mMaskTexture) {
+    state.maskTexture = mMaskTexture->textureId();
+  }
+  state.sourcePixelFormat = mSourcePixelFormat;
+  state.sourceAlphaOpaque = mSourceAlphaOpaque;
+  state.separateMaskEnabled = mSeparateMaskTextureEnabled;
+  state.useExternalTexture = mUseExternalTexture;
+  state.maskSize = mMaskSize;
+  state.maskBlurEnabled = mSeparateMaskTextureEnabled && mCameraMaskBlurring;
+  state.maskBlur = mMaskBlur;
+  state.maskVersion = mMaskVersion;
+  state.uniforms = mObjectUniforms;
+  mDrawState.publish(state);
+  markContentChanged();
 }
 
 void TextureRenderObject::useExternalTexture(bool useExternal) {
   SPDLOG_DEBUG("Using external texture for rendering");
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
   mUseExternalTexture = useExternal;
+  publishDrawState();
 }
 
 bool TextureRenderObject::isEmpty() const {
@@ -305,30 +336,111 @@ TextureRenderObject::SourcePixelFormat TextureRenderObject::sourcePixelFormat()
   return mSourcePixelFormat;
 }
 
-bool TextureRenderObject::isVisible() const {
-  // find the limits of the object, for 2D is enough to decide whether it is visible or not
-  const QMatrix4x4 mvp = mViewProjectionMatrix * getModelMatrix();
-  QVector3D firstVertexPosition(mVBD[0].position[0], mVBD[0].position[1], mVBD[0].position[2]);
-  QVector3D firstVertexScreenPosition = mvp.map(firstVertexPosition);
-  float minX = firstVertexScreenPosition.x();
-  float maxX = firstVertexScreenPosition.x();
-  float minY = firstVertexScreenPosition.y();
-  float maxY = firstVertexScreenPosition.y();
-  float minZ = firstVertexScreenPosition.z();
-  float maxZ = firstVertexScreenPosition.z();
-  for (int v = 1; v < 4; ++v) {
-    QVector3D vertexPosition(mVBD[v].position[0], mVBD[v].position[1], mVBD[v].position[2]);
-    QVector3D vertexScreenPosition = mvp.map(vertexPosition);
-    minX = (vertexScreenPosition.x() < minX) ? vertexScreenPosition.x() : minX;
-    maxX = (vertexScreenPosition.x() > maxX) ? vertexScreenPosition.x() : maxX;
-    minY = (vertexScreenPosition.y() < minY) ? vertexScreenPosition.y() : minY;
-    maxY = (vertexScreenPosition.y() > maxY) ? vertexScreenPosition.y() : maxY;
-    minZ = (vertexScreenPosition.z() < minZ) ? vertexScreenPosition.z() : minZ;
-    maxZ = (vertexScreenPosition.z() > maxZ) ? vertexScreenPosition.z() : maxZ;
-  }
-  // check if any of the limits found are within a cube of [-1,-1,-1] to [1,1,1]
-  // works for both the 2D orthographic projection and the 3D perspective projections
-  return maxX > -1.0f && minX < 1.0f && maxY > -1.0f && minY < 1.0f && maxZ > -1.0f && minZ < 1.0f;
+void TextureRenderObject::setSourceAlphaOpaque(bool opaque) {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
+  opaque = opaque || mSourcePixelFormat == SourcePixelFormat::RGB;
+  if (opaque == mSourceAlphaOpaque) {
+    return;
+  }
+  mSourceAlphaOpaque = opaque;
+  publishDrawState();
+}
+
+bool TextureRenderObject::isSourceAlphaOpaque() const {
+  return mSourceAlphaOpaque;
+}
+
+bool TextureRenderObject::hasOpaqueAlpha(QImage::Format format) {
+  // e.g. RGB32 is stored as 0xffRRGGBB, RGB888 has no alpha at all
+  return format != QImage::Format_Invalid &&
+         QImage::toPixelFormat(format).alphaUsage() == QPixelFormat::IgnoresAlpha;
+}
+
+bool TextureRenderObject::localBounds(float (&rect)[4]) const {
+  const auto& positionRect = mDrawState.read().uniforms.positionRect;
+  std::copy(std::begin(positionRect), std::end(positionRect), rect);
+  return true;
+}
+
+bool TextureRenderObject::isOpaque() const {
+  const DrawState& state = mDrawState.read();
+  return state.texture != 0 && !state.useExternalTexture &&
+         state.sourceAlphaOpaque && !state.separateMaskEnabled &&
+         alpha() >= 1.f;
+}
+
+float TextureRenderObject::alphaAt(const QPointF& boundsPosition) const {
+  QMutexLocker locker(&mPickingAlphaMutex);
+  if (mPickingAlpha.isNull()) {
+    return 1.f;
+  }
+  // the bounds' bottom left corner shows the first row unless flipped (see updateTextureRect)
+  const qreal u = mPickingFlipHorizontally ? 1. - boundsPosition.x() : boundsPosition.x();
+  const qreal v = mPickingFlipVertically ? 1. - boundsPosition.y() : boundsPosition.y();
+  const int x = std::clamp(static_cast<int>(u * mPickingAlpha.width()), 0,
+                           mPickingAlpha.width() - 1);
+  const int y = std::clamp(static_cast<int>(v * mPickingAlpha.height()), 0,
+                           mPickingAlpha.height() - 1);
+  return mPickingAlpha.constScanLine(y)[x] / 255.f;
+}
+
+QSize TextureRenderObject::pickingAlphaSize(const QSize& sourceSize) {
+  const int longerSide = std::max(sourceSize.width(), sourceSize.height());
+  if (longerSide <= kPickingAlphaSize) {
+    return sourceSize;
+  }
+  return {std::max(1, sourceSize.width() * kPickingAlphaSize / longerSide),
+          std::max(1, sourceSize.height() * kPickingAlphaSize / longerSide)};
+}
+
+void TextureRenderObject::updatePickingAlpha(const uchar* data, int bytesPerLine,
+                                             const QRect& region, const QSize& sourceSize,
+                                             int pixelBytes, int alphaOffset) {
+  const QSize size = pickingAlphaSize(sourceSize);
+  if (size.isEmpty()) {
+    return;
+  }
+  QMutexLocker locker(&mPickingAlphaMutex);
+  if (mPickingAlpha.size() != size) {
+    // regions not written yet count as opaque
+    mPickingAlpha = QImage(size, QImage::Format_Alpha8);
+    mPickingAlpha.fill(255);
+  }
+  // nearest neighbour: the source pixel at the center of each copy pixel
+  for (int y = 0; y < size.height(); ++y) {
+    const int sourceY = (2 * y + 1) * sourceSize.height() / (2 * size.height());
+    if (sourceY < region.top() || sourceY > region.bottom()) continue;
+    const uchar* row = data + static_cast<qsizetype>(sourceY - region.top()) * bytesPerLine;
+    uchar* alphaRow = mPickingAlpha.scanLine(y);
+    for (int x = 0; x < size.width(); ++x) {
+      const int sourceX = (2 * x + 1) * sourceSize.width() / (2 * size.width());
+      if (sourceX < region.left() || sourceX > region.right()) continue;
+      alphaRow[x] = row[(sourceX - region.left()) * pixelBytes + alphaOffset];
+    }
+  }
+}
+
+void TextureRenderObject::setPickingAlpha(const QImage& image) {
+  if (image.isNull()) {
+    return;
+  }
+  const QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+  updatePickingAlpha(rgba.constBits(), rgba.bytesPerLine(), rgba.rect(), rgba.size(), 4, 3);
+}
+
+void TextureRenderObject::updatePickingAlphaFromTexture(const uchar* data, int bytesPerLine,
+                                                        const QRect& region) {
+  if (mSeparateMaskTextureEnabled) {
+    return;
+  }
+  if (mSourcePixelFormat == SourcePixelFormat::RGB) {
+    QMutexLocker locker(&mPickingAlphaMutex);
+    mPickingAlpha = QImage();
+    return;
+  }
+  // the alpha is the fourth byte of RGBA and BGRA pixels
+  updatePickingAlpha(data, bytesPerLine, region, mTextureSourceSize, 4, 3);
 }
 
 const QOpenGLTexture::Target TextureRenderObject::qGlTarget() const {
@@ -394,10 +506,8 @@ QImage::Format TextureRenderObject::qImageFormatFromSourcePixelFormat(SourcePixe
   return kSourcePixelFormatToQImageFormatMap.at(format);
 }
 
-void TextureRenderObject::uploadVertexData() {
-  // upload to GPU
-  mVBO.bind();
-  mVBO.allocate(mVBD.data(), static_cast<int>(mVBD.size() * sizeof(vertexData)));
+int TextureRenderObject::bytesPerPixel(SourcePixelFormat format) {
+  return format == SourcePixelFormat::RGB ? 3 : 4;
 }
 
 void TextureRenderObject::changeTextureSizeAndFormat(QSize size,
@@ -432,12 +542,15 @@ void TextureRenderObject::changeTextureSizeAndFormat(QSize size,
   }
 
   mTextureSize = newTextureSize;
+  if (srcPixelFormat != mSourcePixelFormat) {
+    // the new source declares its opaque alpha again (see setSourceAlphaOpaque)
+    mSourceAlphaOpaque = srcPixelFormat == SourcePixelFormat::RGB;
+  }
   mSourcePixelFormat = srcPixelFormat;
 
-  if (isEmpty()) {
-    if (mTexture) mTexture->destroy();
-    mTexture.reset(nullptr);
-  } else {
+  // the render thread may still draw the published state with the previous texture
+  retireTexture(std::move(mTexture));
+  if (!isEmpty()) {
     // create new texture and allocate memory on GPU
     mTexture = std::make_unique<QOpenGLTexture>(qGlTarget());
     if (!mTexture->create()) {
@@ -455,6 +568,10 @@ void TextureRenderObject::changeTextureSizeAndFormat(QSize size,
     mTexture->setBorderColor(Qt::transparent);
   }
   updateTextureCoordinates();
+  publishDrawState();
+  // the bounds changed (e.g. for the spatial index), notify without holding the lock
+  locker.unlock();
+  emit propertiesChanged();
 }
 
 void TextureRenderObject::changeMaskSize(QSize size) {
@@ -499,6 +616,7 @@ void TextureRenderObject::changeMaskSize(QSize size) {
   const auto maskWidth = mMaskSize.width();
   const auto maskHeight = mMaskSize.height();
 
+  retireTexture(std::move(mMaskTexture));
   mMaskTexture = std::make_unique<QOpenGLTexture>(qGlTarget());
   if (!mMaskTexture->create()) {
     SPDLOG_ERROR("Unable to create keying texture");
@@ -513,18 +631,29 @@ void TextureRenderObject::changeMaskSize(QSize size) {
   mMaskTexture->setWrapMode(QOpenGLTexture::WrapMode::ClampToBorder);
 
   updateMaskTextureCoordinates();
+  publishDrawState();
 }
 
 void TextureRenderObject::setFlipVertically(bool flipVertically) {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
   mFlipVertically = flipVertically;
   updateTextureCoordinates();
   updateMaskTextureCoordinates();
+  publishDrawState();
+  QMutexLocker pickingLocker(&mPickingAlphaMutex);
+  mPickingFlipVertically = flipVertically;
 }
 
 void TextureRenderObject::setFlipHorizontally(bool flipHorizontally) {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
   mFlipHorizontally = flipHorizontally;
   updateTextureCoordinates();
   updateMaskTextureCoordinates();
+  publishDrawState();
+  QMutexLocker pickingLocker(&mPickingAlphaMutex);
+  mPickingFlipHorizontally = flipHorizontally;
 }
 
 void TextureRenderObject::setTextureData(const QImage& image) {
@@ -554,14 +683,142 @@ void TextureRenderObject::setTextureData(const QImage& image) {
         mTexture->setData(0, 0, 0, mTextureSourceSize.width(), mTextureSourceSize.height(), 0, 0,
                           qGlSourceFormat(), QOpenGLTexture::UInt8,
                           static_cast<const void*>(texture.bits()));
+        updatePickingAlphaFromTexture(texture.constBits(), texture.bytesPerLine(),
+                                      texture.rect());
       } else {
         // use directly
         mTexture->setData(0, 0, 0, mTextureSourceSize.width(), mTextureSourceSize.height(), 0, 0,
                           qGlSourceFormat(), QOpenGLTexture::UInt8,
                           static_cast<const void*>(image.bits()));
+        updatePickingAlphaFromTexture(image.constBits(), image.bytesPerLine(), image.rect());
       }
     }
+    // the converted pixels of an image without alpha channel have alpha 1
+    const bool sourceAlphaOpaque =
+        !image.hasAlphaChannel() || srcPixelFormat == SourcePixelFormat::RGB;
+    if (sourceAlphaOpaque != mSourceAlphaOpaque) {
+      mSourceAlphaOpaque = sourceAlphaOpaque;
+      publishDrawState();
+    }
+  }
+  markContentChanged();
+}
+
+void TextureRenderObject::setTextureData(const uchar* data, int bytesPerLine) {
+  if (data == nullptr) {
+    SPDLOG_WARN("Set texture data received NULL data!");
+    return;
+  }
+  const int rowBytes = mTextureSourceSize.width() * bytesPerPixel(mSourcePixelFormat);
+  if (bytesPerLine < rowBytes) {
+    SPDLOG_ERROR("Texture data rows are too short: {} < {}", bytesPerLine, rowBytes);
+    return;
+  }
+  int stagingBytesPerLine = 0;
+  uchar* staging = beginTextureUpload(&stagingBytesPerLine);
+  if (staging == nullptr) {
+    return;
+  }
+  if (bytesPerLine == stagingBytesPerLine) {
+    // the one CPU copy, the texture is filled from the buffer by the GPU
+    std::memcpy(staging, data, static_cast<size_t>(bytesPerLine) * mTextureSourceSize.height());
+  } else {
+    for (int row = 0; row < mTextureSourceSize.height(); ++row) {
+      std::memcpy(staging + row * stagingBytesPerLine, data + row * bytesPerLine, rowBytes);
+    }
+  }
+  endTextureUpload();
+  // the staging memory is write only, the alpha copy is sampled from the caller's data
+  QMutexLocker locker(&mAccessMutex);
+  updatePickingAlphaFromTexture(data, bytesPerLine, QRect(QPoint(0, 0), mTextureSourceSize));
+}
+
+uchar* TextureRenderObject::beginTextureUpload(int* bytesPerLine) {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
+  if (!mTexture || !mTexture->isCreated() || !mTexture->isStorageAllocated()) {
+    return nullptr;
+  }
+  // rows are 4 byte aligned (OpenGL's default unpack alignment and QImage's scan line alignment)
+  const int rowBytes = nextMultipleOfFour(mTextureSourceSize.width() *
+                                          bytesPerPixel(mSourcePixelFormat));
+  const int uploadBytes = rowBytes * mTextureSourceSize.height();
+
+  if (!mStreamingBuffer.isCreated()) {
+    mStreamingBuffer = QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer);
+    if (!mStreamingBuffer.create()) {
+      SPDLOG_ERROR("Failed to create PixelUnpackBuffer");
+      return nullptr;
+    }
+    mStreamingBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+  }
+  mStreamingBuffer.bind();
+  // orphan the previous storage: the driver may still read it for the last upload
+  mStreamingBuffer.allocate(uploadBytes);
+  auto* staging = static_cast<uchar*>(mStreamingBuffer.mapRange(
+      0, uploadBytes, QOpenGLBuffer::RangeWrite | QOpenGLBuffer::RangeInvalidateBuffer));
+  // the buffer stays mapped but is unbound such that other uploads are not affected
+  mStreamingBuffer.release();
+  if (staging == nullptr) {
+    SPDLOG_ERROR("Failed to map PixelUnpackBuffer");
+    return nullptr;
+  }
+  *bytesPerLine = rowBytes;
+  // the content written to the staging memory cannot be read back for the alpha copy
+  QMutexLocker pickingLocker(&mPickingAlphaMutex);
+  mPickingAlpha = QImage();
+  return staging;
+}
+
+void TextureRenderObject::endTextureUpload() {
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
+  mStreamingBuffer.bind();
+  if (!mStreamingBuffer.unmap()) {
+    SPDLOG_ERROR("PixelUnpackBuffer content got lost while mapped");
+  } else if (mTexture && mTexture->isCreated() && mTexture->isStorageAllocated()) {
+    // the data pointer is the offset into the bound pixel unpack buffer
+    mTexture->setData(0, 0, 0, mTextureSourceSize.width(), mTextureSourceSize.height(), 0, 0,
+                      qGlSourceFormat(), QOpenGLTexture::UInt8, nullptr);
+  }
+  mStreamingBuffer.release();
+  markContentChanged();
+}
+
+void TextureRenderObject::setTextureRegionData(const QImage& image, const QPoint& offset) {
+  if (image.isNull()) {
+    SPDLOG_WARN("Set texture region data received a NULL image!");
+    return;
+  }
+  // thread critical section
+  QMutexLocker locker(&mAccessMutex);
+  if (image.depth() != bytesPerPixel(mSourcePixelFormat) * 8) {
+    SPDLOG_ERROR("Texture region has {} bits per pixel instead of {}", image.depth(),
+                 bytesPerPixel(mSourcePixelFormat) * 8);
+    return;
+  }
+  if (!QRect(QPoint(0, 0), mTextureSourceSize).contains(QRect(offset, image.size()))) {
+    SPDLOG_ERROR("Texture region {} exceeds the texture", QRectF(QRect(offset, image.size())));
+    return;
+  }
+  // the image may be a view into a larger image: pass its stride as row length. With the default
+  // unpack alignment of 4, OpenGL rounds the row length up to the same 4 byte aligned scan lines.
+  const int pixelBytes = bytesPerPixel(mSourcePixelFormat);
+  const int rowLength = static_cast<int>(image.bytesPerLine() / pixelBytes);
+  if (nextMultipleOfFour(rowLength * pixelBytes) != image.bytesPerLine()) {
+    SPDLOG_ERROR("Texture region scan lines are not 4 byte aligned: {}", image.bytesPerLine());
+    return;
+  }
+  QOpenGLPixelTransferOptions transferOptions;
+  transferOptions.setRowLength(rowLength);
+  if (mTexture->isCreated() && mTexture->isStorageAllocated()) {
+    mTexture->setData(offset.x(), offset.y(), 0, image.width(), image.height(), 0, 0,
+                      qGlSourceFormat(), QOpenGLTexture::UInt8,
+                      static_cast<const void*>(image.constBits()), &transferOptions);
   }
+  updatePickingAlphaFromTexture(image.constBits(), image.bytesPerLine(),
+                                QRect(offset, image.size()));
+  markContentChanged();
 }
 
 void TextureRenderObject::setMaskTextureData(const QImage& image) {
@@ -585,33 +842,22 @@ void TextureRenderObject::setMaskTextureData(const QImage& image) {
                             QOpenGLTexture::Red, QOpenGLTexture::UInt8,
                             static_cast<const void*>(key.bits()));
     }
+    updatePickingAlpha(key.constBits(), key.bytesPerLine(), key.rect(), mMaskSourceSize, 1, 0);
+    // the blurred mask is outdated
+    ++mMaskVersion;
+    publishDrawState();
   }
 }
 
-void TextureRenderObject::setVertexPosition(int vertexId, int index, float value) {
-  if (vertexId >= mVBD.size() || index >= 3) return;
-  mVBD[vertexId].position[index] = value;
-}
-
 void TextureRenderObject::updateTextureCoordinates() {
   // returns left, top, right, bottom, width, height (the latter two for convenience)
-  auto vertexPositions = textureVertexPositions(mTextureSourceSize);
-
-  // vertex data array
-  const float vertices[] = {
-      vertexPositions[2],
-      vertexPositions[1],
-      0.0f,  // top right
-      vertexPositions[2],
-      vertexPositions[3],
-      0.0f,  // bottom right
-      vertexPositions[0],
-      vertexPositions[3],
-      0.0f,  // bottom left
-      vertexPositions[0],
-      vertexPositions[1],
-      0.0f  // top left
-  };
+  const auto vertexPositions = textureVertexPositions(mTextureSourceSize);
+  // the unit quad's origin is the bottom left corner
+  auto& positionRect = mObjectUniforms.positionRect;
+  positionRect[0] = vertexPositions[0];
+  positionRect[1] = vertexPositions[3];
+  positionRect[2] = vertexPositions[4];
+  positionRect[3] = vertexPositions[5];
 
   // the corresponding texture coordinates
   // (initialized for rectangular target with coordinates in [0,w]x[0,h])
@@ -624,55 +870,7 @@ void TextureRenderObject::updateTextureCoordinates() {
     heightValue =
         (mTextureSize.height() > 0) ? heightValue / static_cast<float>(mTextureSize.height()) : 1.f;
   }
-
-  float textureCoords[8] = {0.f};
-  if (mFlipVertically == false && mFlipHorizontally == false) {
-    textureCoords[0] = widthValue;  // top right
-    textureCoords[1] = heightValue;
-    textureCoords[2] = widthValue;  // bottom right
-    textureCoords[3] = 0.f;
-    textureCoords[4] = 0.f;  // bottom left
-    textureCoords[5] = 0.f;
-    textureCoords[6] = 0.f;  // top left
-    textureCoords[7] = heightValue;
-  } else if (mFlipVertically == true && mFlipHorizontally == false) {
-    textureCoords[0] = widthValue;  // top right
-    textureCoords[1] = 0.f;
-    textureCoords[2] = widthValue;  // bottom right
-    textureCoords[3] = heightValue;
-    textureCoords[4] = 0.f;  // bottom left
-    textureCoords[5] = heightValue;
-    textureCoords[6] = 0.f;  // top left
-    textureCoords[7] = 0.f;
-  } else if (mFlipVertically == false && mFlipHorizontally == true) {
-    textureCoords[0] = 0.f;  // top right
-    textureCoords[1] = heightValue;
-    textureCoords[2] = 0.f;  // bottom right
-    textureCoords[3] = 0.f;
-    textureCoords[4] = widthValue;  // bottom left
-    textureCoords[5] = 0.f;
-    textureCoords[6] = widthValue;  // top left
-    textureCoords[7] = heightValue;
-  } else {
-    // vertical: true, horizontal: true
-    textureCoords[0] = 0.f;
-    textureCoords[1] = 0.f;
-    textureCoords[2] = 0.f;
-    textureCoords[3] = heightValue;
-    textureCoords[4] = widthValue;
-    textureCoords[5] = heightValue;
-    textureCoords[6] = widthValue;
-    textureCoords[7] = 0.f;
-  }
-  // update VBD
-  for (int v = 0.f; v < 4; ++v) {
-    for (int p = 0.f; p < 3; ++p) {
-      mVBD[v].position[p] = vertices[v * 3 + p];
-    }
-    mVBD[v].texture[0] = textureCoords[2 * v];
-    mVBD[v].texture[1] = textureCoords[2 * v + 1];
-  }
-  uploadVertexData();
+  updateTextureRect(mObjectUniforms.textureRect, widthValue, heightValue);
 }
 
 void TextureRenderObject::updateMaskTextureCoordinates() {
@@ -683,53 +881,18 @@ void TextureRenderObject::updateMaskTextureCoordinates() {
     heightValue =
         (mMaskSize.height() > 0) ? heightValue / static_cast<float>(mMaskSize.height()) : 1.f;
   }
-
   // Note: Vertex positions are set only for the texture itself, not the mask
-  float maskTextureCoords[8] = {0.f};
-  if (mFlipVertically == false && mFlipHorizontally == false) {
-    maskTextureCoords[0] = widthValue;  // top right
-    maskTextureCoords[1] = heightValue;
-    maskTextureCoords[2] = widthValue;  // bottom right
-    maskTextureCoords[3] = 0.f;
-    maskTextureCoords[4] = 0.f;  // bottom left
-    maskTextureCoords[5] = 0.f;
-    maskTextureCoords[6] = 0.f;  // top left
-    maskTextureCoords[7] = heightValue;
-  } else if (mFlipVertically == true && mFlipHorizontally == false) {
-    maskTextureCoords[0] = widthValue;  // top right
-    maskTextureCoords[1] = 0.f;
-    maskTextureCoords[2] = widthValue;  // bottom right
-    maskTextureCoords[3] = heightValue;
-    maskTextureCoords[4] = 0.f;  // bottom left
-    maskTextureCoords[5] = heightValue;
-    maskTextureCoords[6] = 0.f;  // top left
-    maskTextureCoords[7] = 0.f;
-  } else if (mFlipVertically == false && mFlipHorizontally == true) {
-    maskTextureCoords[0] = 0.f;  // top right
-    maskTextureCoords[1] = heightValue;
-    maskTextureCoords[2] = 0.f;  // bottom right
-    maskTextureCoords[3] = 0.f;
-    maskTextureCoords[4] = widthValue;  // bottom left
-    maskTextureCoords[5] = 0.f;
-    maskTextureCoords[6] = widthValue;  // top left
-    maskTextureCoords[7] = heightValue;
-  } else {
-    // vertical: true, horizontal: true
-    maskTextureCoords[0] = 0.f;
-    maskTextureCoords[1] = 0.f;
-    maskTextureCoords[2] = 0.f;
-    maskTextureCoords[3] = heightValue;
-    maskTextureCoords[4] = widthValue;
-    maskTextureCoords[5] = heightValue;
-    maskTextureCoords[6] = widthValue;
-    maskTextureCoords[7] = 0.f;
-  }
-  // update VBD
-  for (int v = 0; v < 4; ++v) {
-    mVBD[v].maskTexture[0] = maskTextureCoords[2 * v];
-    mVBD[v].maskTexture[1] = maskTextureCoords[2 * v + 1];
-  }
-  uploadVertexData();
+  updateTextureRect(mObjectUniforms.maskTextureRect, widthValue, heightValue);
+}
+
+void TextureRenderObject::updateTextureRect(float (&textureRect)[4], float width,
+                                            float height) const {
+  // origin and extent of the coordinates at the unit quad's bottom left corner, a flip starts at
+  // the opposite side and runs backwards
+  textureRect[0] = mFlipHorizontally ? width : 0.f;
+  textureRect[1] = mFlipVertically ? height : 0.f;
+  textureRect[2] = mFlipHorizontally ? -width : width;
+  textureRect[3] = mFlipVertically ? -height : height;
 }
 
 int TextureRenderObject::nextPowerOfTwo(int input) {
@@ -0,0 +1,215 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/TransformGraph.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Rendering/Simd.h"
+
+namespace nimagna {
+
+QMatrix4x4 TransformGraph::Transform::matrix() const {
+  QMatrix4x4 matrix;
+  matrix.translate(translation + pivot);
+  matrix.rotate(rotation);
+  matrix.scale(scale);
+  matrix.translate(-pivot);
+  return matrix;
+}
+
+TransformGraph::NodeId TransformGraph::addNode(NodeId parent) {
+  if (parent != kNoNode && !isValid(parent)) {
+    SPDLOG_ERROR("Invalid parent transform node {}", parent);
+    parent = kNoNode;
+  }
+  NodeId node;
+  if (!mFreeNodes.empty()) {
+    node = mFreeNodes.back();
+    mFreeNodes.pop_back();
+    mTransforms[node] = {};
+    mChildren[node].clear();
+    mIsAlive[node] = true;
+  } else {
+    node = static_cast<NodeId>(mTransforms.size());
+    mTransforms.emplace_back();
+    mParents.emplace_back();
+    mChildren.emplace_back();
+    mIsAlive.push_back(true);
+    mPositions.push_back(-1);
+  }
+  mParents[node] = parent;
+  if (parent != kNoNode) {
+    mChildren[parent].push_back(node);
+  }
+  mIsOrderDirty = true;
+  return node;
+}
+
+void TransformGraph::removeNode(NodeId node) {
+  if (!isValid(node)) {
+    SPDLOG_ERROR("Remove invalid transform node {}", node);
+    return;
+  }
+  const NodeId parent = mParents[node];
+  for (const NodeId child : mChildren[node]) {
+    mParents[child] = parent;
+    if (parent != kNoNode) {
+      mChildren[parent].push_back(child);
+    }
+  }
+  if (parent != kNoNode) {
+    auto& siblings = mChildren[parent];
+    siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+  }
+  mChildren[node].clear();
+  mIsAlive[node] = false;
+  mPositions[node] = -1;
+  mFreeNodes.push_back(node);
+  mIsOrderDirty = true;
+}
+
+void TransformGraph::setParent(NodeId node, NodeId parent) {
+  if (!isValid(node) || (parent != kNoNode && !isValid(parent))) {
+    SPDLOG_ERROR("Invalid transform nodes {} and parent {}", node, parent);
+    return;
+  }
+  // the new parent must not be in the node's subtree
+  for (NodeId ancestor = parent; ancestor != kNoNode; ancestor = mParents[ancestor]) {
+    if (ancestor == node) {
+      SPDLOG_ERROR("Transform node {} cannot be its own ancestor", node);
+      return;
+    }
+  }
+  if (const NodeId oldParent = mParents[node]; oldParent != kNoNode) {
+    auto& siblings = mChildren[oldParent];
+    siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+  }
+  mParents[node] = parent;
+  if (parent != kNoNode) {
+    mChildren[parent].push_back(node);
+  }
+  mIsOrderDirty = true;
+}
+
+TransformGraph::NodeId TransformGraph::parent(NodeId node) const {
+  return isValid(node) ? mParents[node] : kNoNode;
+}
+
+void TransformGraph::setTransform(NodeId node, const Transform& transform) {
+  if (!isValid(node)) {
+    SPDLOG_ERROR("Set transform of invalid node {}", node);
+    return;
+  }
+  mTransforms[node] = transform;
+  mDirtyNodes.push_back(node);
+}
+
+const TransformGraph::Transform& TransformGraph::transform(NodeId node) const {
+  assert(isValid(node));
+  return mTransforms[node];
+}
+
+const std::vector<TransformGraph::NodeId>& TransformGraph::update() {
+  mChangedNodes.clear();
+  if (mIsOrderDirty) {
+    // everything moved: recompute all
+    rebuildOrder();
+    for (size_t position = 0; position < mOrder.size(); ++position) {
+      const QMatrix4x4 local = mTransforms[mOrder[position]].matrix();
+      std::memcpy(mLocalMatrices[position].m, local.constData(), sizeof(Matrix::m));
+    }
+    updateWorldMatrices(0, static_cast<int>(mOrder.size()));
+    mDirtyNodes.clear();
+    return mChangedNodes;
+  }
+  if (mDirtyNodes.empty()) {
+    return mChangedNodes;
+  }
+
+  // the local matrices of the changed nodes, then the world matrices of their subtrees in order
+  std::vector<int> dirtyPositions;
+  dirtyPositions.reserve(mDirtyNodes.size());
+  for (const NodeId node : mDirtyNodes) {
+    if (!isValid(node)) continue;
+    const int position = mPositions[node];
+    const QMatrix4x4 local = mTransforms[node].matrix();
+    std::memcpy(mLocalMatrices[position].m, local.constData(), sizeof(Matrix::m));
+    dirtyPositions.push_back(position);
+  }
+  mDirtyNodes.clear();
+  std::sort(dirtyPositions.begin(), dirtyPositions.end());
+  int updatedEnd = 0;
+  for (const int position : dirtyPositions) {
+    // subtrees of a subtree updated already are covered
+    if (position < updatedEnd) continue;
+    updatedEnd = mSubtreeEnds[position];
+    updateWorldMatrices(position, updatedEnd);
+  }
+  return mChangedNodes;
+}
+
+QMatrix4x4 TransformGraph::worldMatrix(NodeId node) const {
+  if (!isValid(node) || mPositions[node] < 0) {
+    return {};
+  }
+  // QMatrix4x4 takes rows
+  return QMatrix4x4(mWorldMatrices[mPositions[node]].m).transposed();
+}
+
+bool TransformGraph::isValid(NodeId node) const {
+  return node >= 0 && node < static_cast<NodeId>(mIsAlive.size()) && mIsAlive[node];
+}
+
+void TransformGraph::rebuildOrder() {
+  mOrder.clear();
+  mParentPositions.clear();
+  mSubtreeEnds.clear();
+  // iterative depth first traversal from the nodes without parent
+  std::vector<NodeId> stack;
+  for (NodeId node = static_cast<NodeId>(mIsAlive.size()) - 1; node >= 0; --node) {
+    if (mIsAlive[node] && mParents[node] == kNoNode) {
+      stack.push_back(node);
+    }
+  }
+  std::vector<int> openPositions;
+  while (!stack.empty()) {
+    const NodeId node = stack.back();
+    stack.pop_back();
+    // close the subtrees that ended
+    const NodeId parent = mParents[node];
+    while (!openPositions.empty() && mOrder[openPositions.back()] != parent) {
+      mSubtreeEnds[openPositions.back()] = static_cast<int>(mOrder.size());
+      openPositions.pop_back();
+    }
+    const int position = static_cast<int>(mOrder.size());
+    mPositions[node] = position;
+    mOrder.push_back(node);
+    mParentPositions.push_back(parent == kNoNode ? -1 : mPositions[parent]);
+    mSubtreeEnds.push_back(position + 1);
+    openPositions.push_back(position);
+    const auto& children = mChildren[node];
+    stack.insert(stack.end(), children.rbegin(), children.rend());
+  }
+  for (const int position : openPositions) {
+    mSubtreeEnds[position] = static_cast<int>(mOrder.size());
+  }
+  mLocalMatrices.resize(mOrder.size());
+  mWorldMatrices.resize(mOrder.size());
+  mIsOrderDirty = false;
+}
+
+void TransformGraph::updateWorldMatrices(int begin, int end) {
+  for (int position = begin; position < end; ++position) {
+    const int parentPosition = mParentPositions[position];
+    if (parentPosition < 0) {
+      mWorldMatrices[position] = mLocalMatrices[position];
+    } else {
+      simd::multiplyMatrices4x4(mWorldMatrices[parentPosition].m, mLocalMatrices[position].m,
+                                mWorldMatrices[position].m);
+    }
+    mChangedNodes.push_back(mOrder[position]);
+  }
+}
+
+}  // namespace nimagna
@@ -0,0 +1,192 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/UniformBufferRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Rendering/PerContext.h"
+
+namespace nimagna {
+
+namespace {
+// the ring of each context
+PerContext<UniformBufferRing> rings;
+
+// the offset of the uniform buffer's binding ranges must be a multiple of the alignment
+GLsizeiptr alignedSize(size_t size, GLint alignment) {
+  return static_cast<GLsizeiptr>((size + alignment - 1) / alignment * alignment);
+}
+}  // namespace
+
+UniformBufferRing& UniformBufferRing::forCurrentContext() {
+  return rings.forCurrentContext();
+}
+
+void UniformBufferRing::release(QOpenGLContext* context) {
+  rings.release(context);
+}
+
+void UniformBufferRing::bindBlocks(QOpenGLShaderProgram& program) {
+  auto* f = QOpenGLContext::currentContext()->extraFunctions();
+  const GLuint programId = program.programId();
+  for (const auto& [blockName, binding] : {std::pair{"FrameUniforms", kFrameBlockBinding},
+                                           std::pair{"ObjectUniforms", kObjectBlockBinding}}) {
+    const GLuint blockIndex = f->glGetUniformBlockIndex(programId, blockName);
+    if (blockIndex == GL_INVALID_INDEX) {
+      SPDLOG_WARN("Shader program without uniform block {}", blockName);
+      continue;
+    }
+    f->glUniformBlockBinding(programId, blockIndex, binding);
+  }
+}
+
+UniformBufferRing::UniformBufferRing() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  mFunctions = context->extraFunctions();
+  mIsPersistentMappingSupported =
+      context->format().version() >= qMakePair(4, 4) ||
+      context->hasExtension(QByteArrayLiteral("GL_ARB_buffer_storage"));
+  mFunctions->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mAlignment);
+  mFrameSlotSize = alignedSize(sizeof(FrameUniforms), mAlignment);
+}
+
+UniformBufferRing::~UniformBufferRing() {
+  destroyBuffer();
+}
+
+void UniformBufferRing::beginFrame(const QMatrix4x4& viewProjection, bool useDrawDepth) {
+  if (mBuffer == 0) {
+    allocate(kInitialObjectCapacity);
+  }
+  // wait for the GPU to finish the frame that used the segment before (usually long done)
+  if (GLsync& fence = mFences[mSegment]) {
+    constexpr GLuint64 kTimeoutNs = 1'000'000'000;
+    if (mFunctions->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kTimeoutNs) ==
+        GL_TIMEOUT_EXPIRED) {
+      SPDLOG_WARN("Uniform buffer segment still in use after 1 s");
+    }
+    mFunctions->glDeleteSync(fence);
+    fence = nullptr;
+  }
+  std::memcpy(mFrameUniforms.viewProjection, viewProjection.constData(),
+              sizeof(mFrameUniforms.viewProjection));
+  mFrameUniforms.useDrawDepth = useDrawDepth ? 1 : 0;
+  writeFrameUniforms();
+  mIsInFrame = true;
+}
+
+bool UniformBufferRing::bindObjectUniforms(const ObjectUniforms* uniforms, int count) {
+  if (!mIsInFrame) {
+    SPDLOG_ERROR("Object uniforms outside of a frame");
+    return false;
+  }
+  if (count <= 0 || count > kMaxInstanceCount) {
+    SPDLOG_ERROR("Invalid instance count {}", count);
+    return false;
+  }
+  const GLsizeiptr size = count * static_cast<GLsizeiptr>(sizeof(ObjectUniforms));
+  GLintptr offset = alignedSize(mWriteOffset, mAlignment);
+  if (offset + size > mSegmentSize) {
+    // the draws issued so far keep the old buffer alive until the GPU is done with it
+    SPDLOG_INFO("Growing uniform buffer ring to {} objects per frame", 2 * mObjectCapacity);
+    allocate(std::max(2 * mObjectCapacity, count + mObjectCapacity));
+    writeFrameUniforms();
+    offset = alignedSize(mWriteOffset, mAlignment);
+  }
+  offset += segmentOffset();
+  write(offset, uniforms, size);
+  // the whole block is bound, the instances beyond count are never read
+  mFunctions->glBindBufferRange(GL_UNIFORM_BUFFER, kObjectBlockBinding, mBuffer, offset,
+                                kObjectBlockSize);
+  mWriteOffset = offset - segmentOffset() + size;
+  return true;
+}
+
+void UniformBufferRing::endFrame() {
+  if (!mIsInFrame) {
+    return;
+  }
+  mFences[mSegment] = mFunctions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mSegment = (mSegment + 1) % kFramesInFlight;
+  mIsInFrame = false;
+}
+
+void UniformBufferRing::allocate(int objectCapacity) {
+  destroyBuffer();
+  mObjectCapacity = objectCapacity;
+  // room for the alignment gaps between the draws, too
+  mSegmentSize = alignedSize(
+      mFrameSlotSize + objectCapacity * (sizeof(ObjectUniforms) + mAlignment), mAlignment);
+  // the bound block of the last segment's last draw reaches beyond the segment
+  const GLsizeiptr size = kFramesInFlight * mSegmentSize + kObjectBlockSize;
+
+  mFunctions->glGenBuffers(1, &mBuffer);
+  mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+  if (mIsPersistentMappingSupported) {
+    // not part of the 4.0 core functions
+    using BufferStorage = void(QOPENGLF_APIENTRYP)(GLenum target, GLsizeiptr size,
+                                                   const void* data, GLbitfield flags);
+    const auto bufferStorage = reinterpret_cast<BufferStorage>(
+        QOpenGLContext::currentContext()->getProcAddress("glBufferStorage"));
+    constexpr GLbitfield kMapFlags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    if (bufferStorage) {
+      bufferStorage(GL_UNIFORM_BUFFER, size, nullptr, kMapFlags);
+      mMappedData = static_cast<uchar*>(
+          mFunctions->glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, kMapFlags));
+    }
+    if (!mMappedData) {
+      SPDLOG_WARN("Unable to map the uniform buffer persistently, using glBufferSubData");
+      mIsPersistentMappingSupported = false;
+      mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+      mFunctions->glDeleteBuffers(1, &mBuffer);
+      mFunctions->glGenBuffers(1, &mBuffer);
+      mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    }
+  }
+  if (!mMappedData) {
+    mFunctions->glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  }
+  mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBufferRing::destroyBuffer() {
+  for (GLsync& fence : mFences) {
+    if (fence) {
+      mFunctions->glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (mBuffer == 0) {
+    return;
+  }
+  if (mMappedData) {
+    mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    mFunctions->glUnmapBuffer(GL_UNIFORM_BUFFER);
+    mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    mMappedData = nullptr;
+  }
+  mFunctions->glDeleteBuffers(1, &mBuffer);
+  mBuffer = 0;
+}
+
+void UniformBufferRing::write(GLintptr offset, const void* data, GLsizeiptr size) {
+  if (mMappedData) {
+    // coherent mapping: visible to the draw calls issued afterwards
+    std::memcpy(mMappedData + offset, data, size);
+    return;
+  }
+  mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+  mFunctions->glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+  mFunctions->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBufferRing::writeFrameUniforms() {
+  mWriteOffset = mFrameSlotSize;
+  write(segmentOffset(), &mFrameUniforms, sizeof(mFrameUniforms));
+  mFunctions->glBindBufferRange(GL_UNIFORM_BUFFER, kFrameBlockBinding, mBuffer, segmentOffset(),
+                                sizeof(FrameUniforms));
+}
+
+}  // namespace nimagna
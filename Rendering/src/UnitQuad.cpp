@@ -0,0 +1,61 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/UnitQuad.h"
+
+#include <QtGui/QOpenGLExtraFunctions>
+#include <QtGui/QOpenGLFunctions>
+
+#include "Rendering/PerContext.h"
+
+namespace nimagna {
+
+namespace {
+// the quad of each context
+PerContext<UnitQuad> quads;
+}  // namespace
+
+UnitQuad& UnitQuad::forCurrentContext() {
+  return quads.forCurrentContext();
+}
+
+void UnitQuad::release(QOpenGLContext* context) {
+  quads.release(context);
+}
+
+UnitQuad::UnitQuad() : mVBO(QOpenGLBuffer::VertexBuffer) {
+  // the corners in triangle strip order: bottom left, bottom right, top left, top right
+  const GLfloat unitPositions[] = {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+
+  if (!mVAO.create()) {
+    SPDLOG_ERROR("Failed to create VertexArrayObject");
+  }
+  mVAO.bind();
+  if (!mVBO.create()) {
+    SPDLOG_ERROR("Failed to create VertexBufferObject");
+  }
+  mVBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+  mVBO.bind();
+  mVBO.allocate(unitPositions, sizeof(unitPositions));
+
+  // layout location 0 - vec2 with the unit corner
+  auto* f = QOpenGLContext::currentContext()->functions();
+  f->glEnableVertexAttribArray(kUnitPositionLocation);
+  f->glVertexAttribPointer(kUnitPositionLocation, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat),
+                           nullptr);
+  mVAO.release();
+  mVBO.release();
+}
+
+UnitQuad::~UnitQuad() {
+  mVAO.destroy();
+  mVBO.destroy();
+}
+
+void UnitQuad::draw(int instanceCount) {
+  mVAO.bind();
+  QOpenGLContext::currentContext()->extraFunctions()->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0,
+                                                                            4, instanceCount);
+  mVAO.release();
+}
+
+}  // namespace nimagna
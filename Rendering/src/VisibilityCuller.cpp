@@ -0,0 +1,60 @@
+#include "Rendering/pch.h"
+
+#include "Rendering/VisibilityCuller.h"
+
+#include <algorithm>
+
+#include "Rendering/Simd.h"
+
+namespace nimagna {
+
+void VisibilityCuller::cull(const std::vector<RenderQueue::Entry>& entries,
+                            const QMatrix4x4& viewProjection, std::vector<unsigned char>* visible) {
+  visible->assign(entries.size(), 0);
+  mBoundedEntries.clear();
+  for (auto& elements : mMatrices) elements.clear();
+  for (auto& coordinates : mRects) coordinates.clear();
+
+  // gather the bounds of the candidates, decide the others right away
+  float rect[4];
+  for (size_t index = 0; index < entries.size(); ++index) {
+    const auto& renderObject = *entries[index].renderObject;
+    if (!renderObject.allowUpdates() || renderObject.alpha() <= 0.f) {
+      continue;
+    }
+    if (!renderObject.localBounds(rect)) {
+      (*visible)[index] = 1;
+      continue;
+    }
+    const QMatrix4x4 mvp = viewProjection * renderObject.getModelMatrix();
+    const float* elements = mvp.constData();
+    for (size_t element = 0; element < mMatrices.size(); ++element) {
+      mMatrices[element].push_back(elements[element]);
+    }
+    for (size_t coordinate = 0; coordinate < mRects.size(); ++coordinate) {
+      mRects[coordinate].push_back(rect[coordinate]);
+    }
+    mBoundedEntries.push_back(index);
+  }
+
+  // transform and test the bounds in batches
+  simd::RectangleBatch batch;
+  for (size_t element = 0; element < mMatrices.size(); ++element) {
+    batch.matrix[element] = mMatrices[element].data();
+  }
+  for (size_t coordinate = 0; coordinate < mRects.size(); ++coordinate) {
+    batch.rect[coordinate] = mRects[coordinate].data();
+  }
+  mInside.resize(mBoundedEntries.size());
+  simd::rectanglesInClipVolume(batch, mBoundedEntries.size(), mInside.data());
+  for (size_t bounded = 0; bounded < mBoundedEntries.size(); ++bounded) {
+    (*visible)[mBoundedEntries[bounded]] = mInside[bounded];
+  }
+
+  mLastFrameStatistics.drawnCount =
+      static_cast<int>(std::count(visible->begin(), visible->end(), 1));
+  mLastFrameStatistics.culledCount =
+      static_cast<int>(entries.size()) - mLastFrameStatistics.drawnCount;
+}
+
+}  // namespace nimagna